@@ -64,11 +64,33 @@ class FileStoreTemplate {
 
 		static constexpr InodeId_t ReservedInodeEnd = 100;
 
+		/**
+		 * Reserved inode holding the IndexData. Images without it predate the
+		 * versioned index and are migrated before their first write.
+		 */
+		static constexpr InodeId_t IndexInode = 1;
+		static constexpr uint8_t IndexVersion = 1;
+
+		/**
+		 * The inodes form a scapegoat tree with an alpha of 1/sqrt(2), which
+		 * keeps every item within MaxDepth of the root without storing any
+		 * balance information in the items.
+		 */
+		static constexpr std::size_t MaxDepth = 2 * 8 * sizeof(size_t) + 2;
+
 		struct OX_PACKED FileStoreData {
 			LittleEndian<size_t> rootNode = 0;
 			Random random;
 		};
 
+		struct OX_PACKED IndexData {
+			LittleEndian<uint8_t> version = IndexVersion;
+			// items in the index, including the IndexInode
+			LittleEndian<size_t> nodes = 0;
+			// most items the index has held since its last full rebuild
+			LittleEndian<size_t> maxNodes = 0;
+		};
+
 		size_t m_buffSize = 0;
 		mutable Buffer *m_buffer = nullptr;
 
@@ -140,40 +162,67 @@ class FileStoreTemplate {
 		FileStoreData *fileStoreData() const;
 
 		/**
-		 * Places the given Item at the given ID. If it already exists, the
-		 * existing value will be overwritten.
+		 * @return the index metadata, or nullptr if this image predates it
 		 */
-		Error placeItem(ItemPtr item);
+		IndexData *indexData() const;
+
+		/**
+		 * Migrates images without a versioned index by rebuilding their tree
+		 * balanced and adding the IndexInode.
+		 */
+		Error upgradeIndex();
 
 		/**
 		 * Places the given Item at the given ID. If it already exists, the
 		 * existing value will be overwritten.
 		 */
-		Error placeItem(ItemPtr root, ItemPtr item, int depth = 0);
+		Error placeItem(ItemPtr item);
 
 		/**
-		 * Removes the given Item at the given ID. If it already exists, the
-		 * existing value will be overwritten.
+		 * Removes the given Item from the index.
 		 */
 		Error unplaceItem(ItemPtr item);
 
+		Error remove(ItemPtr item);
+
 		/**
-		 * Removes the given Item at the given ID. If it already exists, the
-		 * existing value will be overwritten.
+		 * Rebuilds the subtree hanging from the given side of parent, or the
+		 * whole tree if parent is null, into a complete tree in place.
+		 * @return the number of items in the subtree
 		 */
-		Error unplaceItem(ItemPtr root, ItemPtr item, int depth = 0);
+		Result<std::size_t> rebalance(ItemPtr parent, bool right);
 
-		Error remove(ItemPtr item);
+		/**
+		 * Rotates every other item of the right leaning vine hanging from the
+		 * given link up over its parent, count times.
+		 */
+		Error compress(ItemPtr parent, bool right, std::size_t count);
+
+		[[nodiscard]]
+		Result<std::size_t> subtreeSize(size_t node) const;
 
 		/**
-		 * Finds the parent an inode by its ID.
+		 * @return offset of the item on the given side of parent, or of the root
+		 * if parent is null
 		 */
-		ItemPtr findParent(ItemPtr item, size_t id, size_t oldAddr) const;
+		[[nodiscard]]
+		size_t childOf(ItemPtr parent, bool right) const;
+
+		void setChild(ItemPtr parent, bool right, size_t node);
 
 		/**
-		 * Finds an inode by its ID.
+		 * @return upper bound of the number of items, which no valid walk of
+		 * the tree can take more steps than
 		 */
-		ItemPtr find(ItemPtr item, InodeId_t id, int depth = 0) const;
+		[[nodiscard]]
+		std::size_t maxItems() const;
+
+		/**
+		 * @return floor(log_sqrt(2)(nodes)), the depth an insertion may reach
+		 * before a subtree gets rebuilt
+		 */
+		[[nodiscard]]
+		static constexpr std::size_t balancedDepth(uint64_t nodes) noexcept;
 
 		/**
 		 * Finds an inode by its ID.
@@ -213,6 +262,22 @@ Error FileStoreTemplate<size_t>::format(void *buffer, size_t bufferSize) {
 		return OxError(1, "Could not read data section of FileStoreData");
 	}
 	new (data) FileStoreData;
+	// new images start with an index holding only the IndexInode
+	auto indexItem = nb->malloc(sizeof(IndexData)).value;
+	if (!indexItem.valid()) {
+		oxTrace("ox::fs::FileStoreTemplate::format::fail", "Could not allocate IndexData");
+		return OxError(1, "Could not allocate IndexData");
+	}
+	indexItem->id = IndexInode;
+	auto index = nb->template dataOf<IndexData>(indexItem);
+	if (!index.valid()) {
+		oxTrace("ox::fs::FileStoreTemplate::format::fail", "Could not read data section of IndexData");
+		return OxError(1, "Could not read data section of IndexData");
+	}
+	new (index) IndexData;
+	index->nodes = 1;
+	index->maxNodes = 1;
+	data->rootNode = indexItem.offset();
 	return OxError(0);
 }
 
@@ -236,7 +301,7 @@ Error FileStoreTemplate<size_t>::decLinks(InodeId_t id) {
 	oxRequireM(item, find(id).validate());
 	item->links--;
 	if (item->links == 0) {
-		oxReturnError(remove(item));
+		oxReturnError(remove(item->id.get()));
 	}
 	return OxError(0);
 }
@@ -244,6 +309,10 @@ Error FileStoreTemplate<size_t>::decLinks(InodeId_t id) {
 template<typename size_t>
 Error FileStoreTemplate<size_t>::write(InodeId_t id, const void *data, FsSize_t dataSize, uint8_t fileType) {
 	oxTracef("ox::fs::FileStoreTemplate::write", "Attempting to write to inode {}", id);
+	if (id == IndexInode) {
+		return OxError(1, "Inode is reserved for the FileStore index");
+	}
+	oxReturnError(upgradeIndex());
 	auto existing = find(id);
 	if (!canWrite(existing, dataSize)) {
 		oxReturnError(compact());
@@ -254,7 +323,7 @@ Error FileStoreTemplate<size_t>::write(InodeId_t id, const void *data, FsSize_t
 		// delete the old node if it exists
 		if (existing.valid()) {
 			oxTracef("ox::fs::FileStoreTemplate::write", "Freeing old version of inode found at offset: {}", existing.offset());
-			auto err = m_buffer->free(existing);
+			auto err = remove(existing);
 			if (err) {
 				oxTrace("ox::fs::FileStoreTemplate::write::fail", "Free of old version of inode failed");
 				return err;
@@ -281,25 +350,8 @@ Error FileStoreTemplate<size_t>::write(InodeId_t id, const void *data, FsSize_t
 					ox_memcpy(destData, data, dest->size());
 					oxTrace("ox::fs::FileStoreTemplate::write", "Data written");
 				}
-				auto fsData = fileStoreData();
-				if (fsData) {
-					oxTracef("ox::fs::FileStoreTemplate::write", "Searching for root node at {}", fsData->rootNode.get());
-					auto root = m_buffer->ptr(fsData->rootNode);
-					if (root.valid()) {
-						oxTracef("ox::fs::FileStoreTemplate::write",
-						         "Placing {} on {} at {}", dest->id.get(), root->id.get(), destData.offset());
-						return placeItem(dest);
-					} else {
-						oxTracef("ox::fs::FileStoreTemplate::write",
-						        "Initializing root inode: {} (offset: {}, data size: {})",
-						        dest->id.get(), dest.offset(), destData.size());
-						fsData->rootNode = dest.offset();
-						oxTracef("ox::fs::FileStoreTemplate::write", "Root inode: {}", dest->id.get());
-						return OxError(0);
-					}
-				} else {
-					oxTrace("ox::fs::FileStoreTemplate::write::fail", "Could not place item due to absence of FileStore header.");
-				}
+				oxTracef("ox::fs::FileStoreTemplate::write", "Placing {} at {}", dest->id.get(), destData.offset());
+				return placeItem(dest);
 			}
 		}
 		oxReturnError(m_buffer->free(dest));
@@ -309,6 +361,10 @@ Error FileStoreTemplate<size_t>::write(InodeId_t id, const void *data, FsSize_t
 
 template<typename size_t>
 Error FileStoreTemplate<size_t>::remove(InodeId_t id) {
+	if (id == IndexInode) {
+		return OxError(1, "Inode is reserved for the FileStore index");
+	}
+	oxReturnError(upgradeIndex());
 	return remove(find(id));
 }
 
@@ -470,30 +526,18 @@ Result<typename FileStoreTemplate<size_t>::InodeId_t> FileStoreTemplate<size_t>:
 template<typename size_t>
 Error FileStoreTemplate<size_t>::compact() {
 	auto isFirstItem = true;
-	return m_buffer->compact([this, &isFirstItem](uint64_t oldAddr, ItemPtr item) -> Error {
+	return m_buffer->compact([this, &isFirstItem](ItemPtr item) -> Error {
 		if (isFirstItem) {
+			// the first item is the FileStoreData, which holds the root
 			isFirstItem = false;
-			return OxError(0);
-		}
-		if (!item.valid()) {
-			return OxError(1);
-		}
-		oxTracef("ox::FileStoreTemplate::compact::moveItem", "Moving Item: {} from {} to {}", item->id.get(), oldAddr, item.offset());
-		// update rootInode if this is it
-		auto fsData = fileStoreData();
-		if (fsData && oldAddr == fsData->rootNode) {
-			fsData->rootNode = item.offset();
-		}
-		auto parent = findParent(rootInode(), item->id, oldAddr);
-		oxAssert(parent.valid() || rootInode() == item.offset(),
-		         "Parent inode not found for item that should have parent.");
-		if (parent.valid()) {
-			if (parent->left == oldAddr) {
-				parent->left = item;
-			} else if (parent->right == oldAddr) {
-				parent->right = item;
+			auto fsData = fileStoreData();
+			if (fsData) {
+				fsData->rootNode = m_buffer->relocated(fsData->rootNode);
 			}
+			return OxError(0);
 		}
+		item->left = m_buffer->relocated(item->left);
+		item->right = m_buffer->relocated(item->right);
 		return OxError(0);
 	});
 }
@@ -511,59 +555,134 @@ typename FileStoreTemplate<size_t>::FileStoreData *FileStoreTemplate<size_t>::fi
 }
 
 template<typename size_t>
-Error FileStoreTemplate<size_t>::placeItem(ItemPtr item) {
-	auto fsData = fileStoreData();
-	if (!fsData) {
-		return OxError(1);
+typename FileStoreTemplate<size_t>::IndexData *FileStoreTemplate<size_t>::indexData() const {
+	auto item = find(IndexInode);
+	if (item.valid()) {
+		auto data = m_buffer->template dataOf<IndexData>(item);
+		if (data.valid()) {
+			return data.get();
+		}
 	}
-	oxRequireM(root, m_buffer->ptr(fsData->rootNode).validate());
-	if (root->id == item->id) {
-		fsData->rootNode = item;
-		item->left = root->left;
-		item->right = root->right;
-		oxTracef("ox::fs::FileStoreTemplate::placeItem", "Overwrote Root Item: {}", item->id.get());
+	return nullptr;
+}
+
+template<typename size_t>
+Error FileStoreTemplate<size_t>::upgradeIndex() {
+	auto index = indexData();
+	if (index) {
+		if (index->version > IndexVersion) {
+			oxTracef("ox::fs::FileStoreTemplate::upgradeIndex::fail", "Unsupported index version: {}", index->version.get());
+			return OxError(1, "FileStore index version is newer than supported");
+		}
 		return OxError(0);
-	} else {
-		return placeItem(root, item);
 	}
+	oxTrace("ox::fs::FileStoreTemplate::upgradeIndex", "Migrating unversioned inode index");
+	oxRequire(nodes, rebalance(nullptr, false));
+	auto item = m_buffer->malloc(sizeof(IndexData)).value;
+	if (!item.valid()) {
+		oxReturnError(compact());
+		item = m_buffer->malloc(sizeof(IndexData)).value;
+	}
+	if (!item.valid()) {
+		oxTrace("ox::fs::FileStoreTemplate::upgradeIndex::fail", "Could not allocate IndexData");
+		return OxError(1, "Insufficient space to migrate FileStore index");
+	}
+	item->id = IndexInode;
+	auto data = m_buffer->template dataOf<IndexData>(item);
+	if (!data.valid()) {
+		oxReturnError(m_buffer->free(item));
+		return OxError(1, "Could not read data section of IndexData");
+	}
+	new (data) IndexData;
+	data->nodes = nodes;
+	data->maxNodes = nodes;
+	return placeItem(item);
 }
 
 template<typename size_t>
-Error FileStoreTemplate<size_t>::placeItem(ItemPtr root, ItemPtr item, int depth) {
-	if (depth > 5000) {
-		oxTrace("ox::fs::FileStoreTemplate::placeItem::fail", "Excessive recursion depth, stopping before stack overflow.");
-		return OxError(2);
+Error FileStoreTemplate<size_t>::placeItem(ItemPtr item) {
+	auto fsData = fileStoreData();
+	if (!fsData) {
+		return OxError(1);
 	}
-	if (item->id > root->id) {
-		auto right = m_buffer->ptr(root->right);
-		if (!right.valid() || right->id == item->id) {
-			root->right = item.offset();
-			if (right.valid()) {
-				item->left = right->left;
-				item->right = right->right;
+	// ancestors of the new item, for finding the scapegoat
+	size_t path[MaxDepth];
+	std::size_t depth = 0;
+	ItemPtr parent = nullptr;
+	auto right = false;
+	auto cur = m_buffer->ptr(fsData->rootNode);
+	while (cur.valid()) {
+		if (depth > maxItems()) {
+			oxTrace("ox::fs::FileStoreTemplate::placeItem::fail", "Cycle in inode index");
+			return OxError(2, "Cycle in inode index");
+		}
+		if (cur->id == item->id) {
+			if (cur.offset() == item.offset()) {
+				oxTrace("ox::fs::FileStoreTemplate::placeItem::fail", "Cannot insert an item on itself.");
+				return OxError(1, "Cannot insert an item on itself.");
 			}
-			oxTracef("ox::fs::FileStoreTemplate::placeItem", "Placed Item: {}", item->id.get());
+			item->left = cur->left;
+			item->right = cur->right;
+			setChild(parent, right, item.offset());
+			oxTracef("ox::fs::FileStoreTemplate::placeItem", "Overwrote Item: {}", item->id.get());
 			return OxError(0);
-		} else {
-			return placeItem(right, item, depth + 1);
 		}
-	} else if (item->id < root->id) {
-		auto left = m_buffer->ptr(root->left);
-		if (!left.valid() || left->id == item->id) {
-			root->left = item.offset();
-			if (left.valid()) {
-				item->left = left->left;
-				item->right = left->right;
+		if (depth < MaxDepth) {
+			path[depth] = cur.offset();
+		}
+		right = item->id > cur->id;
+		parent = cur;
+		cur = m_buffer->ptr(childOf(cur, right));
+		++depth;
+	}
+	item->left = 0;
+	item->right = 0;
+	setChild(parent, right, item.offset());
+	oxTracef("ox::fs::FileStoreTemplate::placeItem", "Placed Item: {}", item->id.get());
+	auto index = indexData();
+	if (!index) {
+		// unversioned images are migrated before they are written to
+		return OxError(0);
+	}
+	++index->nodes;
+	if (index->nodes > index->maxNodes) {
+		index->maxNodes = index->nodes;
+	}
+	if (depth <= balancedDepth(index->nodes)) {
+		return OxError(0);
+	}
+	// too deep, rebuild the lowest ancestor that is out of weight balance
+	if (depth <= MaxDepth) {
+		std::size_t childSize = 1;
+		size_t child = item.offset();
+		for (auto i = depth; i-- > 0;) {
+			auto node = m_buffer->ptr(path[i]);
+			if (!node.valid()) {
+				break;
 			}
-			oxTracef("ox::fs::FileStoreTemplate::placeItem", "Placed Item: {}", item->id.get());
-			return OxError(0);
-		} else {
-			return placeItem(left, item, depth + 1);
+			const auto sibling = node->left == child ? node->right : node->left;
+			auto [siblingSize, err] = subtreeSize(sibling);
+			if (err) {
+				break;
+			}
+			const uint64_t size = childSize + siblingSize + 1;
+			if (2 * uint64_t{childSize} * childSize > size * size) {
+				if (i == 0) {
+					break;
+				}
+				auto goatParent = m_buffer->ptr(path[i - 1]);
+				if (!goatParent.valid()) {
+					break;
+				}
+				return rebalance(goatParent, goatParent->right == path[i]).error;
+			}
+			childSize = static_cast<std::size_t>(size);
+			child = path[i];
 		}
-	} else {
-		oxTrace("ox::fs::FileStoreTemplate::placeItem::fail", "Cannot insert an item on itself.");
-		return OxError(1, "Cannot insert an item on itself.");
 	}
+	oxReturnError(rebalance(nullptr, false));
+	index->maxNodes = index->nodes;
+	return OxError(0);
 }
 
 template<typename size_t>
@@ -572,64 +691,61 @@ Error FileStoreTemplate<size_t>::unplaceItem(ItemPtr item) {
 	if (!fsData) {
 		return OxError(1);
 	}
-	oxRequireM(root, m_buffer->ptr(fsData->rootNode).validate());
-	if (root->id == item->id) {
-		item->left = root->left;
-		item->right = root->right;
-		auto left = m_buffer->ptr(item->left);
-		auto right = m_buffer->ptr(item->right);
-		if (right.valid()) {
-			auto oldRoot = fsData->rootNode;
-			fsData->rootNode = item->right;
-			if (left.valid()) {
-				auto err = placeItem(left);
-				// undo if unable to place the left side of the tree
-				if (err) {
-					fsData->rootNode = oldRoot;
-					return err;
-				}
-			}
-		} else if (left.valid()) {
-			fsData->rootNode = item->left;
-		} else {
-			fsData->rootNode = 0;
+	ItemPtr parent = nullptr;
+	auto right = false;
+	auto cur = m_buffer->ptr(fsData->rootNode);
+	for (std::size_t steps = 0; cur.valid() && cur->id != item->id; ++steps) {
+		if (steps > maxItems()) {
+			oxTrace("ox::fs::FileStoreTemplate::unplaceItem::fail", "Cycle in inode index");
+			return OxError(2, "Cycle in inode index");
 		}
-		return OxError(0);
+		right = item->id > cur->id;
+		parent = cur;
+		cur = m_buffer->ptr(childOf(cur, right));
+	}
+	if (!cur.valid() || cur.offset() != item.offset()) {
+		oxTracef("ox::fs::FileStoreTemplate::unplaceItem::fail", "Item not in index: {}", item->id.get());
+		return OxError(1, "Item not in index");
+	}
+	size_t replacement = 0;
+	if (!item->left) {
+		replacement = item->right;
+	} else if (!item->right) {
+		replacement = item->left;
 	} else {
-		return unplaceItem(root, item);
-	}
-}
-
-template<typename size_t>
-Error FileStoreTemplate<size_t>::unplaceItem(ItemPtr root, ItemPtr item, int depth) {
-	if (depth >= 5000) {
-		oxTrace("ox::fs::FileStoreTemplate::unplaceItem::fail", "Excessive recursion depth, stopping before stack overflow.");
-		return OxError(1, "Excessive recursion depth, stopping before stack overflow.");
-	}
-	if (item->id > root->id) {
-		auto right = m_buffer->ptr(root->right);
-		if (right->id == item->id) {
-			root->right = 0;
-			oxTracef("ox::fs::FileStoreTemplate::unplaceItem", "Unplaced Item: {}", item->id.get());
-		} else {
-			return unplaceItem(right, item, depth + 1);
+		// splice out the in-order successor and put it in the item's place
+		auto succParent = item;
+		auto succ = m_buffer->ptr(item->right);
+		for (std::size_t steps = 0; succ.valid() && succ->left; ++steps) {
+			if (steps > maxItems()) {
+				return OxError(2, "Cycle in inode index");
+			}
+			succParent = succ;
+			succ = m_buffer->ptr(succ->left);
 		}
-	} else if (item->id < root->id) {
-		auto left = m_buffer->ptr(root->left);
-		if (left->id == item->id) {
-			root->left = 0;
-			oxTracef("ox::fs::FileStoreTemplate::unplaceItem", "Unplaced Item: {}", item->id.get());
-		} else {
-			return unplaceItem(left, item, depth + 1);
+		if (!succ.valid()) {
+			return OxError(1, "Invalid item in index");
+		}
+		if (succParent.offset() != item.offset()) {
+			succParent->left = succ->right;
+			succ->right = item->right;
+		}
+		succ->left = item->left;
+		replacement = succ.offset();
+	}
+	setChild(parent, right, replacement);
+	item->left = 0;
+	item->right = 0;
+	oxTracef("ox::fs::FileStoreTemplate::unplaceItem", "Unplaced Item: {}", item->id.get());
+	auto index = indexData();
+	if (index) {
+		--index->nodes;
+		const uint64_t nodes = index->nodes;
+		const uint64_t maxNodes = index->maxNodes;
+		if (2 * nodes * nodes < maxNodes * maxNodes) {
+			oxReturnError(rebalance(nullptr, false));
+			index->maxNodes = index->nodes;
 		}
-	} else {
-		return OxError(1);
-	}
-	if (item->right) {
-		oxReturnError(placeItem(m_buffer->ptr(item->right)));
-	}
-	if (item->left) {
-		oxReturnError(placeItem(m_buffer->ptr(item->left)));
 	}
 	return OxError(0);
 }
@@ -645,70 +761,153 @@ Error FileStoreTemplate<size_t>::remove(ItemPtr item) {
 }
 
 template<typename size_t>
-typename FileStoreTemplate<size_t>::ItemPtr FileStoreTemplate<size_t>::findParent(ItemPtr item, size_t id, size_t oldAddr) const {
-	// This is a little bit confusing. findParent uses the inode ID to find
-	// where the target ID should be, but the actual address of that item is
-	// currently invalid, so we check it against what is known to be the old
-	// address of the item to confirm that we have the right item.
-	if (item.valid()) {
-		if (id > item->id) {
-			if (item->right == oldAddr) {
-				return item;
-			} else {
-				auto right = m_buffer->ptr(item->right);
-				return findParent(right, id, oldAddr);
+Result<std::size_t> FileStoreTemplate<size_t>::rebalance(ItemPtr parent, bool right) {
+	// Day-Stout-Warren: rotate the subtree into a vine of right children,
+	// then fold the vine into a complete tree, using no extra space
+	const auto maxSteps = 2 * maxItems();
+	std::size_t nodes = 0;
+	auto tail = parent;
+	auto tailRight = right;
+	size_t rest = childOf(parent, right);
+	for (std::size_t steps = 0; rest; ++steps) {
+		auto node = m_buffer->ptr(rest);
+		if (steps > maxSteps || !node.valid()) {
+			oxTrace("ox::fs::FileStoreTemplate::rebalance::fail", "Invalid inode index");
+			return OxError(2, "Invalid inode index");
+		}
+		if (node->left) {
+			auto left = m_buffer->ptr(node->left);
+			if (!left.valid()) {
+				return OxError(2, "Invalid inode index");
 			}
-		} else if (id < item->id) {
-			if (item->left == oldAddr) {
-				return item;
-			} else {
-				auto left = m_buffer->ptr(item->left);
-				return findParent(left, id, oldAddr);
+			node->left = left->right;
+			left->right = rest;
+			rest = left.offset();
+			setChild(tail, tailRight, rest);
+		} else {
+			tail = node;
+			tailRight = true;
+			rest = node->right;
+			++nodes;
+		}
+	}
+	std::size_t full = 1;
+	while (full * 2 <= nodes + 1) {
+		full *= 2;
+	}
+	oxReturnError(compress(parent, right, nodes + 1 - full));
+	for (auto size = full - 1; size > 1; size /= 2) {
+		oxReturnError(compress(parent, right, size / 2));
+	}
+	oxTracef("ox::fs::FileStoreTemplate::rebalance", "Rebuilt {} items", nodes);
+	return nodes;
+}
+
+template<typename size_t>
+Error FileStoreTemplate<size_t>::compress(ItemPtr parent, bool right, std::size_t count) {
+	for (std::size_t i = 0; i < count; ++i) {
+		auto child = m_buffer->ptr(childOf(parent, right));
+		if (!child.valid()) {
+			return OxError(2, "Invalid inode index");
+		}
+		auto grandchild = m_buffer->ptr(child->right);
+		if (!grandchild.valid()) {
+			return OxError(2, "Invalid inode index");
+		}
+		setChild(parent, right, grandchild.offset());
+		child->right = grandchild->left;
+		grandchild->left = child.offset();
+		parent = grandchild;
+		right = true;
+	}
+	return OxError(0);
+}
+
+template<typename size_t>
+Result<std::size_t> FileStoreTemplate<size_t>::subtreeSize(size_t node) const {
+	// the stack never holds more than one item per level
+	size_t stack[MaxDepth];
+	std::size_t stackSize = 0;
+	std::size_t out = 0;
+	if (node) {
+		stack[stackSize++] = node;
+	}
+	while (stackSize) {
+		auto item = m_buffer->ptr(stack[--stackSize]);
+		if (!item.valid() || ++out > maxItems()) {
+			return OxError(2, "Invalid inode index");
+		}
+		for (size_t child : {item->left.get(), item->right.get()}) {
+			if (child) {
+				if (stackSize == MaxDepth) {
+					return OxError(1, "Inode index subtree too deep");
+				}
+				stack[stackSize++] = child;
 			}
 		}
 	}
-	return nullptr;
+	return out;
 }
 
 template<typename size_t>
-typename FileStoreTemplate<size_t>::ItemPtr FileStoreTemplate<size_t>::find(ItemPtr item, InodeId_t id, int depth) const {
-	if (depth > 5000) {
-		oxTracef("ox::fs::FileStoreTemplate::find::fail", "Excessive recursion depth, stopping before stack overflow. Search for: {}", id);
-		return nullptr;
+size_t FileStoreTemplate<size_t>::childOf(ItemPtr parent, bool right) const {
+	if (!parent.valid()) {
+		auto fsData = fileStoreData();
+		return fsData ? fsData->rootNode.get() : 0;
 	}
-	if (!item.valid()) {
-		oxTrace("ox::fs::FileStoreTemplate::find::fail", "item invalid");
-		return nullptr;
+	return right ? parent->right.get() : parent->left.get();
+}
+
+template<typename size_t>
+void FileStoreTemplate<size_t>::setChild(ItemPtr parent, bool right, size_t node) {
+	if (!parent.valid()) {
+		auto fsData = fileStoreData();
+		if (fsData) {
+			fsData->rootNode = node;
+		}
+	} else if (right) {
+		parent->right = node;
+	} else {
+		parent->left = node;
 	}
-	// do search
-	if (id > item->id) {
-		oxTracef("ox::fs::FileStoreTemplate::find", "Not a match, searching on {}", item->right.get());
-		return find(m_buffer->ptr(item->right), id, depth + 1);
-	} else if (id < item->id) {
-		oxTracef("ox::fs::FileStoreTemplate::find", "Not a match, searching on {}", item->left.get());
-		return find(m_buffer->ptr(item->left), id, depth + 1);
-	} else if (id == item->id) {
-		oxTracef("ox::fs::FileStoreTemplate::find", "Found {} at {}", id, item.offset());
-		return item;
+}
+
+template<typename size_t>
+std::size_t FileStoreTemplate<size_t>::maxItems() const {
+	return m_buffer->size() / sizeof(Item) + 1;
+}
+
+template<typename size_t>
+constexpr std::size_t FileStoreTemplate<size_t>::balancedDepth(uint64_t nodes) noexcept {
+	std::size_t out = 0;
+	for (auto sq = nodes * nodes; sq > 1; sq >>= 1) {
+		++out;
 	}
-	return nullptr;
+	return out;
 }
 
 template<typename size_t>
 typename FileStoreTemplate<size_t>::ItemPtr FileStoreTemplate<size_t>::find(InodeId_t id) const {
 	oxTracef("ox::fs::FileStoreTemplate::find", "Searching for inode: {}", id);
 	auto fsData = fileStoreData();
-	if (fsData) {
-		auto root = m_buffer->ptr(fsData->rootNode);
-		if (root.valid()) {
-			auto item = find(root, id);
-			return item;
+	if (!fsData) {
+		oxTrace("ox::fs::FileStoreTemplate::find::fail", "No FileStore Data");
+		return nullptr;
+	}
+	// unversioned images may still be unbalanced, so the walk is only bounded
+	// by the number of items that fit in the buffer
+	auto item = m_buffer->ptr(fsData->rootNode);
+	for (auto steps = maxItems(); item.valid() && steps; --steps) {
+		if (id > item->id) {
+			item = m_buffer->ptr(item->right);
+		} else if (id < item->id) {
+			item = m_buffer->ptr(item->left);
 		} else {
-			oxTrace("ox::fs::FileStoreTemplate::find::fail", "No root node");
+			oxTracef("ox::fs::FileStoreTemplate::find", "Found {} at {}", id, item.offset());
+			return item;
 		}
-	} else {
-		oxTrace("ox::fs::FileStoreTemplate::find::fail", "No FileStore Data");
 	}
+	oxTracef("ox::fs::FileStoreTemplate::find::fail", "Could not find inode: {}", id);
 	return nullptr;
 }
 
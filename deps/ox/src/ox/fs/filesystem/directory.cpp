@@ -16,4 +16,7 @@ template class Directory<FileStore32, uint32_t>;
 template struct DirectoryEntry<uint16_t>;
 template struct DirectoryEntry<uint32_t>;
 
+template struct DirectoryIndex<uint16_t>;
+template struct DirectoryIndex<uint32_t>;
+
 }
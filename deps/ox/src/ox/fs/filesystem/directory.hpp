@@ -12,6 +12,8 @@
 #include <ox/fs/filestore/filestoretemplate.hpp>
 #include <ox/fs/ptrarith/nodebuffer.hpp>
 #include <ox/std/byteswap.hpp>
+#include <ox/std/hash.hpp>
+#include <ox/std/strops.hpp>
 
 #include "types.hpp"
 
@@ -82,12 +84,54 @@ struct OX_PACKED DirectoryEntry {
 
 };
 
+/**
+ * Open addressing hash table of the entries of a directory, stored in the
+ * data section of its first entry. The inode of 0 and empty name, which no
+ * real entry has, mark that entry as the index. Directories without one
+ * predate it and are searched linearly until their next write.
+ */
+template<typename InodeId_t>
+struct OX_PACKED DirectoryIndex {
+
+	public:
+		static constexpr uint8_t Version = 1;
+		static constexpr std::size_t MinSlots = 8;
+
+		struct OX_PACKED Slot {
+			// offset of the entry in the directory buffer, 0 if empty
+			LittleEndian<InodeId_t> entry = 0;
+		};
+
+		// DirectoryEntryData fields
+		LittleEndian<InodeId_t> inode = 0;
+		char name = 0;
+
+		LittleEndian<uint8_t> version = Version;
+		// power of 2, kept at least twice the entry count
+		LittleEndian<InodeId_t> slotCount = 0;
+		LittleEndian<InodeId_t> entries = 0;
+
+		Slot *slots() noexcept {
+			return reinterpret_cast<Slot*>(reinterpret_cast<uint8_t*>(this) + sizeof(*this));
+		}
+
+		static constexpr std::size_t spaceNeeded(std::size_t slots) noexcept {
+			return sizeof(DirectoryIndex) + slots * sizeof(Slot);
+		}
+
+		static constexpr uint32_t hash(const char *name) noexcept {
+			return fnv1a32(name, ox_strnlen(name, MaxFileNameLength));
+		}
+
+};
+
 
 template<typename FileStore, typename InodeId_t>
 class Directory {
 
 	private:
 		using Buffer = ptrarith::NodeBuffer<InodeId_t, DirectoryEntry<InodeId_t>>;
+		using Index = DirectoryIndex<InodeId_t>;
 
 		InodeId_t m_inodeId = 0;
 		std::size_t m_size = 0;
@@ -119,6 +163,45 @@ class Directory {
 
 		Result<typename FileStore::InodeId_t> find(PathIterator name, FileName *nameBuff = nullptr) const noexcept;
 
+	private:
+		/**
+		 * @return the index of the given directory buffer, or nullptr if it has
+		 * none
+		 */
+		static Index *indexOf(Buffer *buff) noexcept;
+
+		/**
+		 * @return the data of the given entry, or null if it is the index
+		 */
+		static ptrarith::Ptr<typename DirectoryEntry<InodeId_t>::DirectoryEntryData, InodeId_t>
+		entryData(typename Buffer::ItemPtr entry) noexcept;
+
+		/**
+		 * @return the slot holding the entry with the given name, or the empty
+		 * slot it would go in, or the slot count if the table is full
+		 */
+		static std::size_t findSlot(Buffer *buff, Index *index, const char *name) noexcept;
+
+		static Error indexEntry(Buffer *buff, Index *index, typename Buffer::ItemPtr entry) noexcept;
+
+		/**
+		 * Points the indexed entry with the given name at the given inode.
+		 * @return whether the directory has an entry with that name
+		 */
+		static Result<bool> updateEntry(Buffer *buff, Index *index, const char *name, InodeId_t inode) noexcept;
+
+		/**
+		 * Empties the given slot, moving later entries of its probe sequence back
+		 * so that no lookup stops short of them.
+		 */
+		static void unindexSlot(Buffer *buff, Index *index, std::size_t slot) noexcept;
+
+		/**
+		 * Writes a copy of the entries of src to dest, with a new index of the
+		 * given number of slots as its first entry.
+		 */
+		static Error rebuild(Buffer *dest, Buffer *src, std::size_t slots) noexcept;
+
 };
 
 template<typename FileStore, typename InodeId_t>
@@ -231,17 +314,52 @@ Error Directory<FileStore, InodeId_t>::write(PathIterator path, InodeId_t inode,
 			return OxError(1, "Could not read existing version of Directory");
 		}
 
+		auto oldIndex = indexOf(old);
+		if (oldIndex) {
+			// if the entry exists, point it at the new inode in place
+			oxRequire(updated, updateEntry(old, oldIndex, name->c_str(), inode));
+			if (updated) {
+				return OxError(0);
+			}
+		}
+
 		const auto pathSize = name->len() + 1;
 		const auto entryDataSize = DirectoryEntry<InodeId_t>::DirectoryEntryData::spaceNeeded(pathSize);
-		const auto newSize = oldStat.size + Buffer::spaceNeeded(entryDataSize);
-		auto cpy = ox_malloca(newSize, Buffer, *old, oldStat.size);
+		auto newSize = oldStat.size + Buffer::spaceNeeded(entryDataSize);
+		// directories without an index get one, full indexes are rebuilt larger
+		std::size_t slots = 0;
+		if (!oldIndex || (oldIndex->entries + 1) * 2 > oldIndex->slotCount) {
+			std::size_t entries = 1;
+			std::size_t used = sizeof(Buffer) + Buffer::spaceNeeded(entryDataSize);
+			for (auto i = old->iterator(); i.valid(); i.next()) {
+				if (entryData(i.ptr()).valid()) {
+					++entries;
+					used += Buffer::spaceNeeded(i->size());
+				}
+			}
+			slots = Index::MinSlots;
+			while (slots < entries * 4) {
+				slots *= 2;
+			}
+			newSize = used + Buffer::spaceNeeded(Index::spaceNeeded(slots));
+			oxTracef("ox::fs::Directory::write", "Rebuilding directory index with {} slots", slots);
+		}
+		auto cpy = slots ? ox_malloca(newSize, Buffer, newSize) : ox_malloca(newSize, Buffer, *old, oldStat.size);
 		if (cpy == nullptr) {
 			oxTrace("ox::fs::Directory::write::fail", "Could not allocate memory for copy of Directory");
 			return OxError(1, "Could not allocate memory for copy of Directory");
 		}
 
-		// TODO: look for old version of this entry and delete it
-		oxReturnError(cpy->setSize(newSize));
+		if (slots) {
+			oxReturnError(rebuild(cpy, old, slots));
+			// a directory that had no index may already hold the name
+			oxRequire(updated, updateEntry(cpy, indexOf(cpy), name->c_str(), inode));
+			if (updated) {
+				return m_fs.write(m_inodeId, cpy, cpy->size(), static_cast<uint8_t>(FileType::Directory));
+			}
+		} else {
+			oxReturnError(cpy->setSize(newSize));
+		}
 		auto val = cpy->malloc(entryDataSize).value;
 		if (!val.valid()) {
 			oxTrace("ox::fs::Directory::write::fail", "Could not allocate memory for new directory entry");
@@ -250,6 +368,7 @@ Error Directory<FileStore, InodeId_t>::write(PathIterator path, InodeId_t inode,
 
 		oxTracef("ox::fs::Directory::write", "Attempting to write Directory entry: {}", name->data());
 		oxReturnError(val->init(inode, name->data(), val.size()));
+		oxReturnError(indexEntry(cpy, indexOf(cpy), val));
 		return m_fs.write(m_inodeId, cpy, cpy->size(), static_cast<uint8_t>(FileType::Directory));
 	}
 }
@@ -263,14 +382,31 @@ Error Directory<FileStore, InodeId_t>::remove(PathIterator path, FileName *nameB
 	auto &name = *nameBuff;
 	oxReturnError(path.get(&name));
 
+	if (path.next().hasNext()) { // not yet at target directory, recurse to next one
+		oxRequire(nextChild, findEntry(name));
+		return Directory(m_fs, nextChild).remove(path.next(), nameBuff);
+	}
+
 	oxTrace("ox::fs::Directory::remove", name.c_str());
 	auto buff = m_fs.read(m_inodeId).template to<Buffer>();
 	if (buff.valid()) {
 		oxTrace("ox::fs::Directory::remove", "Found directory buffer.");
+		if (auto index = indexOf(buff); index) {
+			const auto slot = findSlot(buff, index, name.c_str());
+			if (slot < index->slotCount && index->slots()[slot].entry) {
+				auto entry = buff->ptr(index->slots()[slot].entry);
+				if (!entry.valid()) {
+					return OxError(1, "Invalid directory index");
+				}
+				unindexSlot(buff, index, slot);
+				oxReturnError(buff->free(entry));
+			}
+			return OxError(0);
+		}
 		for (auto i = buff->iterator(); i.valid(); i.next()) {
 			auto data = i->data();
 			if (data.valid()) {
-				if (ox_strncmp(data->name, name.c_str(), name.len()) == 0) {
+				if (ox_strncmp(data->name, name.c_str(), MaxFileNameLength) == 0) {
 					oxReturnError(buff->free(i));
 				}
 			} else {
@@ -296,11 +432,9 @@ Error Directory<FileStore, InodeId_t>::ls(F cb) noexcept {
 
 	oxTrace("ox::fs::Directory::ls", "Found directory buffer.");
 	for (auto i = buff->iterator(); i.valid(); i.next()) {
-		auto data = i->data();
+		auto data = entryData(i.ptr());
 		if (data.valid()) {
 			oxReturnError(cb(data->name, data->inode));
-		} else {
-			oxTrace("ox::fs::Directory::ls", "INVALID DIRECTORY ENTRY");
 		}
 	}
 
@@ -316,6 +450,22 @@ Result<typename FileStore::InodeId_t> Directory<FileStore, InodeId_t>::findEntry
 		return OxError(2, "Could not findEntry directory buffer");
 	}
 	oxTracef("ox::fs::Directory::findEntry", "Found directory buffer, size: {}", buff.size());
+	if (auto index = indexOf(buff); index) {
+		const auto slot = findSlot(buff, index, name.c_str());
+		if (slot < index->slotCount && index->slots()[slot].entry) {
+			auto entry = buff->ptr(index->slots()[slot].entry);
+			if (entry.valid()) {
+				auto data = entry->data();
+				if (data.valid()) {
+					oxTracef("ox::fs::Directory::findEntry", "\"{}\" match found.", name.c_str());
+					return static_cast<InodeId_t>(data->inode);
+				}
+			}
+		}
+		oxTrace("ox::fs::Directory::findEntry::fail", "Entry not present");
+		return OxError(1, "Entry not present");
+	}
+	// directories from before the index are searched linearly
 	for (auto i = buff->iterator(); i.valid(); i.next()) {
 		auto data = i->data();
 		if (data.valid()) {
@@ -354,12 +504,167 @@ Result<typename FileStore::InodeId_t> Directory<FileStore, InodeId_t>::find(Path
 }
 
 
+template<typename FileStore, typename InodeId_t>
+typename Directory<FileStore, InodeId_t>::Index *Directory<FileStore, InodeId_t>::indexOf(Buffer *buff) noexcept {
+	auto first = buff->firstItem();
+	if (!first.valid()) {
+		return nullptr;
+	}
+	auto data = first->data();
+	if (!data.valid() || data.size() < sizeof(Index)) {
+		return nullptr;
+	}
+	auto index = reinterpret_cast<Index*>(data.get());
+	const InodeId_t slotCount = index->slotCount;
+	if (index->inode != 0 || index->name != 0 || index->version != Index::Version ||
+	    !slotCount || (slotCount & (slotCount - 1)) || data.size() < Index::spaceNeeded(slotCount)) {
+		return nullptr;
+	}
+	return index;
+}
+
+template<typename FileStore, typename InodeId_t>
+ptrarith::Ptr<typename DirectoryEntry<InodeId_t>::DirectoryEntryData, InodeId_t>
+Directory<FileStore, InodeId_t>::entryData(typename Buffer::ItemPtr entry) noexcept {
+	auto data = entry->data();
+	if (data.valid() && (data->inode != 0 || data->name[0] != 0)) {
+		return data;
+	}
+	return nullptr;
+}
+
+template<typename FileStore, typename InodeId_t>
+Result<bool> Directory<FileStore, InodeId_t>::updateEntry(Buffer *buff, Index *index, const char *name, InodeId_t inode) noexcept {
+	const auto slot = findSlot(buff, index, name);
+	if (slot >= index->slotCount || !index->slots()[slot].entry) {
+		return false;
+	}
+	auto entry = buff->ptr(index->slots()[slot].entry);
+	if (!entry.valid()) {
+		return OxError(1, "Invalid directory index");
+	}
+	auto data = entry->data();
+	if (!data.valid()) {
+		return OxError(1, "Invalid directory entry");
+	}
+	data->inode = inode;
+	return true;
+}
+
+template<typename FileStore, typename InodeId_t>
+std::size_t Directory<FileStore, InodeId_t>::findSlot(Buffer *buff, Index *index, const char *name) noexcept {
+	const std::size_t slotCount = index->slotCount;
+	const auto mask = slotCount - 1;
+	auto slots = index->slots();
+	auto slot = Index::hash(name) & mask;
+	for (std::size_t i = 0; i < slotCount; ++i, slot = (slot + 1) & mask) {
+		if (!slots[slot].entry) {
+			return slot;
+		}
+		auto entry = buff->ptr(slots[slot].entry);
+		if (entry.valid()) {
+			auto data = entry->data();
+			if (data.valid() && ox_strncmp(data->name, name, MaxFileNameLength) == 0) {
+				return slot;
+			}
+		}
+	}
+	return slotCount;
+}
+
+template<typename FileStore, typename InodeId_t>
+Error Directory<FileStore, InodeId_t>::indexEntry(Buffer *buff, Index *index, typename Buffer::ItemPtr entry) noexcept {
+	if (!index) {
+		return OxError(1, "Directory has no index");
+	}
+	auto data = entry->data();
+	if (!data.valid()) {
+		return OxError(1, "Invalid directory entry");
+	}
+	const auto slot = findSlot(buff, index, data->name);
+	if (slot >= index->slotCount) {
+		return OxError(1, "Directory index is full");
+	}
+	if (index->slots()[slot].entry) {
+		return OxError(1, "Directory entry already indexed");
+	}
+	index->slots()[slot].entry = entry.offset();
+	++index->entries;
+	return OxError(0);
+}
+
+template<typename FileStore, typename InodeId_t>
+void Directory<FileStore, InodeId_t>::unindexSlot(Buffer *buff, Index *index, std::size_t slot) noexcept {
+	const std::size_t slotCount = index->slotCount;
+	const auto mask = slotCount - 1;
+	auto slots = index->slots();
+	auto hole = slot;
+	auto next = (hole + 1) & mask;
+	for (std::size_t i = 1; i < slotCount && slots[next].entry; ++i, next = (next + 1) & mask) {
+		auto entry = buff->ptr(slots[next].entry);
+		if (!entry.valid()) {
+			continue;
+		}
+		auto data = entry->data();
+		if (!data.valid()) {
+			continue;
+		}
+		// the entry must stay if its home slot is cyclically in (hole, next]
+		const auto home = Index::hash(data->name) & mask;
+		const auto stays = hole <= next ? hole < home && home <= next : hole < home || home <= next;
+		if (!stays) {
+			slots[hole].entry = slots[next].entry;
+			hole = next;
+		}
+	}
+	slots[hole].entry = 0;
+	--index->entries;
+}
+
+template<typename FileStore, typename InodeId_t>
+Error Directory<FileStore, InodeId_t>::rebuild(Buffer *dest, Buffer *src, std::size_t slots) noexcept {
+	auto indexItem = dest->malloc(Index::spaceNeeded(slots)).value;
+	if (!indexItem.valid()) {
+		return OxError(1, "Could not allocate directory index");
+	}
+	oxReturnError(indexItem->init(0, "", indexItem.size()));
+	auto indexData = indexItem->data();
+	if (!indexData.valid()) {
+		return OxError(1, "Could not allocate directory index");
+	}
+	auto index = new (indexData.get()) Index;
+	index->slotCount = slots;
+	for (auto i = src->iterator(); i.valid(); i.next()) {
+		auto data = entryData(i.ptr());
+		if (!data.valid()) {
+			continue;
+		}
+		// directories from before the index could hold duplicates, keep the
+		// first, which is the one that lookups found
+		const auto slot = findSlot(dest, index, data->name);
+		if (slot < slots && index->slots()[slot].entry) {
+			continue;
+		}
+		auto entry = dest->malloc(i->size()).value;
+		if (!entry.valid()) {
+			return OxError(1, "Could not allocate directory entry");
+		}
+		oxReturnError(entry->init(data->inode, data->name, entry.size()));
+		oxReturnError(indexEntry(dest, index, entry));
+	}
+	return OxError(0);
+}
+
+
 extern template class Directory<FileStore16, uint16_t>;
 extern template class Directory<FileStore32, uint32_t>;
 
 extern template struct DirectoryEntry<uint16_t>;
 extern template struct DirectoryEntry<uint32_t>;
 
+extern template struct DirectoryIndex<uint16_t>;
+extern template struct DirectoryIndex<uint32_t>;
+
 using Directory16 = Directory<FileStore16, uint16_t>;
 using Directory32 = Directory<FileStore32, uint32_t>;
 
@@ -15,6 +15,7 @@
 #include <ox/fs/filesystem/types.hpp>
 
 #include "directory.hpp"
+#include "pathcache.hpp"
 
 namespace ox {
 
@@ -107,6 +108,7 @@ class FileSystemTemplate: public FileSystem {
 
 		FileStore m_fs;
 		void(*m_freeBuffer)(char*) = nullptr;
+		mutable PathCache m_pathCache;
 
 	public:
 		FileSystemTemplate() noexcept = default;
@@ -168,6 +170,20 @@ class FileSystemTemplate: public FileSystem {
 		[[nodiscard]]
 		bool valid() const noexcept override;
 
+		/**
+		 * Bounds the cache of resolved paths to the given number of paths,
+		 * 0 disables it. The cache is off by default.
+		 * Paths changed through write, move, remove and mkdir are dropped from
+		 * the cache along with everything below them. Writing a directory by
+		 * inode clears the whole cache.
+		 */
+		void setPathCacheSize(std::size_t paths) noexcept;
+
+		[[nodiscard]]
+		const PathCacheStats &pathCacheStats() const noexcept;
+
+		void resetPathCacheStats() noexcept;
+
 	private:
 		Result<FileSystemData> fileSystemData() const noexcept;
 
@@ -176,6 +192,11 @@ class FileSystemTemplate: public FileSystem {
 		 */
 		Result<uint64_t> find(const char *path) const noexcept;
 
+		/**
+		 * Drops the given path and everything below it from the path cache.
+		 */
+		void invalidatePath(const char *path) noexcept;
+
 		Result<Directory> rootDir() const noexcept;
 
 };
@@ -224,32 +245,31 @@ template<typename FileStore, typename Directory>
 Error FileSystemTemplate<FileStore, Directory>::mkdir(const char *path, bool recursive) noexcept {
 	oxTracef("ox::fs::FileSystemTemplate::mkdir", "path: {}, recursive: {}", path, recursive);
 	oxRequireM(rootDir, this->rootDir());
-	return rootDir.mkdir(path, recursive);
+	oxReturnError(rootDir.mkdir(path, recursive));
+	invalidatePath(path);
+	return OxError(0);
 }
 
 template<typename FileStore, typename Directory>
 Error FileSystemTemplate<FileStore, Directory>::move(const char *src, const char *dest) noexcept {
-	oxRequire(fd, fileSystemData());
-	Directory rootDir(m_fs, fd.rootDirInode);
-	oxRequireM(inode, rootDir.find(src));
+	oxRequire(inode, find(src));
+	oxRequireM(rootDir, this->rootDir());
 	oxReturnError(rootDir.write(dest, inode));
+	invalidatePath(dest);
 	oxReturnError(rootDir.remove(src));
+	invalidatePath(src);
 	return OxError(0);
 }
 
 template<typename FileStore, typename Directory>
 Error FileSystemTemplate<FileStore, Directory>::read(const char *path, void *buffer, std::size_t buffSize) noexcept {
-	oxRequire(fd, fileSystemData());
-	Directory rootDir(m_fs, fd.rootDirInode);
-	oxRequire(inode, rootDir.find(path));
+	oxRequire(inode, find(path));
 	return read(inode, buffer, buffSize);
 }
 
 template<typename FileStore, typename Directory>
 Result<const char*> FileSystemTemplate<FileStore, Directory>::directAccess(const char *path) noexcept {
-	oxRequire(fd, fileSystemData());
-	Directory rootDir(m_fs, fd.rootDirInode);
-	oxRequire(inode, rootDir.find(path));
+	oxRequire(inode, find(path));
 	return directAccess(inode);
 }
 
@@ -293,12 +313,13 @@ Error FileSystemTemplate<FileStore, Directory>::ls(const char *path, F cb) {
 
 template<typename FileStore, typename Directory>
 Error FileSystemTemplate<FileStore, Directory>::remove(const char *path, bool recursive) noexcept {
-	oxRequire(fd, fileSystemData());
-	Directory rootDir(m_fs, fd.rootDirInode);
-	oxRequire(inode, rootDir.find(path));
+	oxRequire(inode, find(path));
 	oxRequire(st, stat(inode));
+	oxRequireM(rootDir, this->rootDir());
 	if (st.fileType == FileType::NormalFile || recursive) {
-		if (auto err = rootDir.remove(path)) {
+		const auto err = rootDir.remove(path);
+		invalidatePath(path);
+		if (err) {
 			// removal failed, try putting the index back
 			oxLogError(rootDir.write(path, inode));
 			return err;
@@ -330,12 +351,21 @@ Error FileSystemTemplate<FileStore, Directory>::write(const char *path, const vo
 	}
 	oxRequireM(rootDir, this->rootDir());
 	oxReturnError(rootDir.write(path, inode));
-	oxReturnError(write(inode, buffer, size, fileType));
+	oxReturnError(m_fs.write(inode, buffer, size, static_cast<uint8_t>(fileType)));
+	invalidatePath(path);
 	return OxError(0);
 }
 
 template<typename FileStore, typename Directory>
 Error FileSystemTemplate<FileStore, Directory>::write(uint64_t inode, const void *buffer, uint64_t size, FileType fileType) noexcept {
+	// without a path there is no telling which cached paths pass through a
+	// rewritten directory
+	if (m_pathCache.size()) {
+		const auto wasDir = m_fs.stat(inode).value.fileType == static_cast<uint8_t>(FileType::Directory);
+		if (wasDir || fileType == FileType::Directory) {
+			m_pathCache.clear();
+		}
+	}
 	return m_fs.write(inode, buffer, size, static_cast<uint8_t>(fileType));
 }
 
@@ -386,6 +416,21 @@ bool FileSystemTemplate<FileStore, Directory>::valid() const noexcept {
 	return m_fs.valid();
 }
 
+template<typename FileStore, typename Directory>
+void FileSystemTemplate<FileStore, Directory>::setPathCacheSize(std::size_t paths) noexcept {
+	m_pathCache.setCapacity(paths);
+}
+
+template<typename FileStore, typename Directory>
+const PathCacheStats &FileSystemTemplate<FileStore, Directory>::pathCacheStats() const noexcept {
+	return m_pathCache.stats();
+}
+
+template<typename FileStore, typename Directory>
+void FileSystemTemplate<FileStore, Directory>::resetPathCacheStats() noexcept {
+	m_pathCache.resetStats();
+}
+
 template<typename FileStore, typename Directory>
 Result<typename FileSystemTemplate<FileStore, Directory>::FileSystemData> FileSystemTemplate<FileStore, Directory>::fileSystemData() const noexcept {
 	FileSystemData fd;
@@ -395,14 +440,61 @@ Result<typename FileSystemTemplate<FileStore, Directory>::FileSystemData> FileSy
 
 template<typename FileStore, typename Directory>
 Result<uint64_t> FileSystemTemplate<FileStore, Directory>::find(const char *path) const noexcept {
+	if (!m_pathCache.enabled()) {
+		oxRequire(fd, fileSystemData());
+		// return root as a special case
+		if (ox_strcmp(path, "/") == 0) {
+			return static_cast<uint64_t>(fd.rootDirInode);
+		}
+		Directory rootDir(m_fs, fd.rootDirInode);
+		oxRequire(out, rootDir.find(path));
+		return static_cast<uint64_t>(out);
+	}
+	oxRequire(key, PathCache::normalize(path));
+	if (auto [inode, err] = m_pathCache.get(key); !err) {
+		return inode;
+	}
 	oxRequire(fd, fileSystemData());
-	// return root as a special case
-	if (ox_strcmp(path, "/") == 0) {
-		return static_cast<uint64_t>(fd.rootDirInode);
+	uint64_t inode = fd.rootDirInode;
+	// walk the path a name at a time, skipping the directory reads of cached
+	// prefixes and caching the ones that had to be read
+	const auto keyStr = key.c_str();
+	const auto keyLen = ox_strlen(keyStr);
+	auto name = new (ox_alloca(sizeof(FileName))) FileName;
+	for (std::size_t start = 1; start < keyLen;) {
+		auto end = start;
+		while (end < keyLen && keyStr[end] != '/') {
+			++end;
+		}
+		const String prefix(keyStr, end);
+		if (auto [cached, err] = m_pathCache.peek(prefix); !err) {
+			inode = cached;
+		} else {
+			*name = "";
+			oxReturnError(name->append(&keyStr[start], end - start));
+			Directory dir(m_fs, static_cast<typename FileStore::InodeId_t>(inode));
+			oxRequire(child, dir.findEntry(*name));
+			inode = child;
+			m_pathCache.insert(prefix, inode);
+		}
+		start = end + 1;
+	}
+	if (keyLen == 1) {
+		m_pathCache.insert(key, inode);
+	}
+	return inode;
+}
+
+template<typename FileStore, typename Directory>
+void FileSystemTemplate<FileStore, Directory>::invalidatePath(const char *path) noexcept {
+	if (!m_pathCache.size()) {
+		return;
+	}
+	if (auto [key, err] = PathCache::normalize(path); !err) {
+		m_pathCache.invalidate(key);
+	} else {
+		m_pathCache.clear();
 	}
-	Directory rootDir(m_fs, fd.rootDirInode);
-	oxRequire(out, rootDir.find(path));
-	return static_cast<uint64_t>(out);
 }
 
 template<typename FileStore, typename Directory>
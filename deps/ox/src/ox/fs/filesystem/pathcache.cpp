@@ -0,0 +1,200 @@
+/*
+ * Copyright 2015 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "pathcache.hpp"
+
+namespace ox {
+
+static uint64_t hashPath(const String &path, std::size_t len) noexcept {
+	return fnv1a64(path.c_str(), len);
+}
+
+void PathCache::setCapacity(std::size_t maxEntries) noexcept {
+	m_maxEntries = maxEntries;
+	m_entries = 0;
+	if (!maxEntries) {
+		m_slots = Vector<Slot>();
+		return;
+	}
+	// keep the table at most half full so probe sequences stay short
+	std::size_t slots = 1;
+	while (slots < maxEntries * 2) {
+		slots <<= 1;
+	}
+	m_slots = Vector<Slot>(slots);
+}
+
+std::size_t PathCache::capacity() const noexcept {
+	return m_maxEntries;
+}
+
+bool PathCache::enabled() const noexcept {
+	return m_maxEntries != 0;
+}
+
+Result<uint64_t> PathCache::get(const String &path) noexcept {
+	auto out = peek(path);
+	if (out.error) {
+		++m_stats.misses;
+	} else {
+		++m_stats.hits;
+	}
+	return out;
+}
+
+Result<uint64_t> PathCache::peek(const String &path) const noexcept {
+	if (!enabled()) {
+		return OxError(1, "Path cache is disabled");
+	}
+	const auto slot = findSlot(path, hashPath(path, ox_strlen(path.c_str())));
+	const auto &s = m_slots[slot];
+	if (!s.pathLen) {
+		return OxError(1, "Path not cached");
+	}
+	return s.inode;
+}
+
+void PathCache::insert(const String &path, uint64_t inode) noexcept {
+	if (!enabled()) {
+		return;
+	}
+	const auto len = ox_strlen(path.c_str());
+	const auto hash = hashPath(path, len);
+	auto slot = findSlot(path, hash);
+	if (m_slots[slot].pathLen) {
+		m_slots[slot].inode = inode;
+		return;
+	}
+	if (m_entries >= m_maxEntries) {
+		// evict the first entry at or after the home slot, then probe again as
+		// the erase may have shifted entries around
+		const auto mask = m_slots.size() - 1;
+		auto victim = hash & mask;
+		while (!m_slots[victim].pathLen) {
+			victim = (victim + 1) & mask;
+		}
+		erase(victim);
+		slot = findSlot(path, hash);
+	}
+	auto &s = m_slots[slot];
+	s.hash = hash;
+	s.inode = inode;
+	s.path = path;
+	s.pathLen = len;
+	++m_entries;
+}
+
+void PathCache::invalidate(const String &path) noexcept {
+	if (!enabled() || !m_entries) {
+		return;
+	}
+	const auto len = ox_strlen(path.c_str());
+	// the root is a prefix of everything
+	if (len <= 1) {
+		clear();
+		return;
+	}
+	for (std::size_t i = 0; i < m_slots.size();) {
+		const auto &s = m_slots[i];
+		const auto below = s.pathLen >= len &&
+		                   (s.pathLen == len || s.path[len] == '/') &&
+		                   ox_strncmp(s.path.c_str(), path.c_str(), len) == 0;
+		if (below) {
+			// erasing shifts a later entry into this slot, so check it again
+			erase(i);
+		} else {
+			++i;
+		}
+	}
+}
+
+void PathCache::clear() noexcept {
+	for (auto &s : m_slots) {
+		s = {};
+	}
+	m_entries = 0;
+}
+
+std::size_t PathCache::size() const noexcept {
+	return m_entries;
+}
+
+const PathCacheStats &PathCache::stats() const noexcept {
+	return m_stats;
+}
+
+void PathCache::resetStats() noexcept {
+	m_stats = {};
+}
+
+Result<String> PathCache::normalize(const char *path) noexcept {
+	const auto len = ox_strlen(path);
+	if (!len) {
+		return OxError(1, "Empty path");
+	}
+	// the normalized path is never longer than the path plus a leading /
+	String out(len + 1);
+	auto dst = out.data();
+	std::size_t outLen = 0;
+	std::size_t start = path[0] == '/' ? 1 : 0;
+	while (start < len) {
+		auto end = start;
+		while (end < len && path[end] != '/') {
+			++end;
+		}
+		if (end == start) {
+			return OxError(1, "Empty name in path");
+		}
+		dst[outLen++] = '/';
+		ox_memcpy(&dst[outLen], &path[start], end - start);
+		outLen += end - start;
+		start = end + 1;
+	}
+	if (!outLen) {
+		dst[outLen++] = '/';
+	}
+	dst[outLen] = 0;
+	return out;
+}
+
+std::size_t PathCache::findSlot(const String &path, uint64_t hash) const noexcept {
+	const auto mask = m_slots.size() - 1;
+	const auto len = ox_strlen(path.c_str());
+	auto slot = hash & mask;
+	while (true) {
+		const auto &s = m_slots[slot];
+		if (!s.pathLen || (s.hash == hash && s.pathLen == len && ox_strcmp(s.path.c_str(), path.c_str()) == 0)) {
+			return slot;
+		}
+		slot = (slot + 1) & mask;
+	}
+}
+
+void PathCache::erase(std::size_t slot) noexcept {
+	if (!m_slots[slot].pathLen) {
+		return;
+	}
+	// backward shift deletion, pull later entries of the probe sequence into
+	// the hole so lookups never stop early
+	const auto mask = m_slots.size() - 1;
+	auto hole = slot;
+	auto next = (hole + 1) & mask;
+	while (m_slots[next].pathLen) {
+		const auto home = m_slots[next].hash & mask;
+		// move the entry if the hole lies between its home slot and its slot
+		if (((next - home) & mask) >= ((next - hole) & mask)) {
+			m_slots[hole] = move(m_slots[next]);
+			hole = next;
+		}
+		next = (next + 1) & mask;
+	}
+	m_slots[hole] = {};
+	--m_entries;
+}
+
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2015 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <ox/std/std.hpp>
+
+namespace ox {
+
+struct PathCacheStats {
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+};
+
+/**
+ * Bounded map of paths to inodes, used by FileSystemTemplate to resolve
+ * paths it has already walked with a single probe.
+ * Keys are normalized paths, see PathCache::normalize. Once full, inserting
+ * a new path evicts an entry near its home slot.
+ */
+class PathCache {
+
+	private:
+		struct Slot {
+			uint64_t hash = 0;
+			uint64_t inode = 0;
+			// an empty path marks an unused slot
+			String path;
+			std::size_t pathLen = 0;
+		};
+
+		Vector<Slot> m_slots;
+		std::size_t m_maxEntries = 0;
+		std::size_t m_entries = 0;
+		PathCacheStats m_stats;
+
+	public:
+		/**
+		 * Drops all entries and bounds the cache to the given number of entries,
+		 * 0 disables the cache.
+		 */
+		void setCapacity(std::size_t maxEntries) noexcept;
+
+		[[nodiscard]]
+		std::size_t capacity() const noexcept;
+
+		[[nodiscard]]
+		bool enabled() const noexcept;
+
+		/**
+		 * Looks up a normalized path, counting the lookup as a hit or miss.
+		 */
+		Result<uint64_t> get(const String &path) noexcept;
+
+		/**
+		 * Looks up a normalized path without touching the stats.
+		 */
+		Result<uint64_t> peek(const String &path) const noexcept;
+
+		void insert(const String &path, uint64_t inode) noexcept;
+
+		/**
+		 * Drops the given normalized path and every path below it.
+		 */
+		void invalidate(const String &path) noexcept;
+
+		void clear() noexcept;
+
+		[[nodiscard]]
+		std::size_t size() const noexcept;
+
+		[[nodiscard]]
+		const PathCacheStats &stats() const noexcept;
+
+		void resetStats() noexcept;
+
+		/**
+		 * Converts a path to the form used as a key, a / before each name, with
+		 * no trailing /. The root directory is /.
+		 * Fails on empty names between two /, which no directory can contain.
+		 */
+		static Result<String> normalize(const char *path) noexcept;
+
+	private:
+		[[nodiscard]]
+		std::size_t findSlot(const String &path, uint64_t hash) const noexcept;
+
+		void erase(std::size_t slot) noexcept;
+
+};
+
+}
@@ -161,8 +161,23 @@ class OX_PACKED NodeBuffer {
 		[[nodiscard]]
 		static size_t spaceNeeded(size_t size) noexcept;
 
+		/**
+		 * Slides every item to the front of the buffer in three linear passes.
+		 * The first records the new offset of each item in its prev field, the
+		 * second calls cb(ItemPtr) on every item while they are all still in
+		 * place, so the owner can rewrite the item offsets it keeps with
+		 * relocated, and the third moves the items.
+		 */
 		template<typename F>
-		Error compact(F cb = [](uint64_t, ItemPtr) {}) noexcept;
+		Error compact(F cb = [](ItemPtr) { return OxError(0); }) noexcept;
+
+		/**
+		 * Maps the offset of an item to where compaction is moving it. Only
+		 * valid inside of a compact callback.
+		 * @return the new offset, or 0 if there is no item at the given offset
+		 */
+		[[nodiscard]]
+		size_t relocated(size_t itemOffset) noexcept;
 
 	private:
 		[[nodiscard]]
@@ -396,34 +411,67 @@ size_t NodeBuffer<size_t, Item>::spaceNeeded(size_t size) noexcept {
 template<typename size_t, typename Item>
 template<typename F>
 Error NodeBuffer<size_t, Item>::compact(F cb) noexcept {
-	auto src = firstItem();
-	auto dest = ptr(sizeof(*this));
-	while (dest.offset() <= src.offset()) {
-		if (!src.valid()) {
-			return OxError(1);
+	auto first = firstItem();
+	if (!first.valid()) {
+		return OxError(0);
+	}
+	const size_t firstOffset = first.offset();
+	// items are linked in address order, so no walk of the list can take more
+	// steps than the number of items that fit in the buffer
+	const std::size_t maxItems = m_header.size / sizeof(Item) + 1;
+	// record where each item is going in its prev field, which the move
+	// rebuilds anyway
+	size_t dest = sizeof(*this);
+	size_t lastDest = dest;
+	std::size_t items = 0;
+	for (auto item = first; items == 0 || item.offset() != firstOffset; item = ptr(item->next)) {
+		if (!item.valid() || ++items > maxItems) {
+			oxTrace("ox::ptrarith::NodeBuffer::compact::fail", "Invalid item list");
+			return OxError(1, "NodeBuffer::compact: invalid item list");
 		}
-		if (!dest.valid()) {
-			return OxError(2);
+		item->prev = dest;
+		lastDest = dest;
+		dest += item->fullSize();
+	}
+	for (auto item = first; items--; item = ptr(item->next)) {
+		if (!item.valid()) {
+			return OxError(1, "NodeBuffer::compact: invalid item list");
 		}
-		// move node
-		ox_memcpy(dest, src, src->fullSize());
-		oxReturnError(cb(src, dest));
-		// update surrounding nodes
-		auto prev = ptr(dest->prev);
-		if (prev.valid()) {
-			prev->next = dest;
+		oxReturnError(cb(item));
+	}
+	// slide the items down in address order, each move only overwrites items
+	// that have already been moved
+	auto buff = reinterpret_cast<uint8_t*>(this);
+	auto prevDest = lastDest;
+	auto src = firstOffset;
+	do {
+		auto item = ptr(src);
+		if (!item.valid()) {
+			return OxError(2, "NodeBuffer::compact: invalid item");
 		}
-		auto next = ptr(dest->next);
-		if (next.valid()) {
-			next->prev = dest;
+		const size_t next = item->next;
+		const size_t itemDest = item->prev;
+		const size_t nextDest = next == firstOffset ? sizeof(*this) : relocated(next);
+		ox_memmove(buff + itemDest, buff + src, item->fullSize());
+		auto moved = ptr(itemDest);
+		if (!moved.valid()) {
+			return OxError(2, "NodeBuffer::compact: invalid item after move");
 		}
-		// update iterators
-		src = ptr(dest->next);
-		dest = uninitializedPtr(dest.offset() + dest->fullSize());
-	}
+		moved->prev = prevDest;
+		moved->next = nextDest;
+		prevDest = itemDest;
+		src = next;
+	} while (src != firstOffset);
+	m_header.firstItem = sizeof(*this);
 	return OxError(0);
 }
 
+template<typename size_t, typename Item>
+size_t NodeBuffer<size_t, Item>::relocated(size_t itemOffset) noexcept {
+	auto item = ptr(itemOffset);
+	return item.valid() ? item->prev.get() : 0;
+}
+
 template<typename size_t, typename Item>
 uint8_t *NodeBuffer<size_t, Item>::data() noexcept {
 	return reinterpret_cast<uint8_t*>(ptr(sizeof(*this)).get());
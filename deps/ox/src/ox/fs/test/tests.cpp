@@ -9,8 +9,10 @@
 // make sure asserts are enabled for the test file
 #undef NDEBUG
 
+#include <chrono>
 #include <functional>
 #include <map>
+#include <string>
 #include <string_view>
 #include <ox/std/std.hpp>
 #include <ox/fs/ptrarith/nodebuffer.hpp>
@@ -187,6 +189,134 @@ const std::map<std::string_view, std::function<ox::Error(std::string_view)>> tes
 				return OxError(0);
 			}
 		},
+		{
+			"FileStore::balancedIndex",
+			[](std::string_view) {
+				// sequential ids are the worst case for an unbalanced tree
+				constexpr uint32_t itemCount = 10000;
+				constexpr uint32_t firstId = 1000;
+				ox::Vector<uint8_t> fsBuff(1024 * 1024);
+				oxAssert(ox::FileStore32::format(fsBuff.data(), fsBuff.size()), "FileStore::format failed.");
+				ox::FileStore32 fileStore(fsBuff.data(), fsBuff.size());
+				for (auto id = firstId; id < firstId + itemCount; ++id) {
+					oxAssert(fileStore.write(id, &id, sizeof(id)), "FileStore::write failed.");
+				}
+				for (auto id = firstId; id < firstId + itemCount; id += 2) {
+					oxAssert(fileStore.remove(id), "FileStore::remove failed.");
+				}
+				// overwrite some of the remaining items
+				for (auto id = firstId + 1; id < firstId + itemCount; id += 6) {
+					const auto val = id * 2;
+					oxAssert(fileStore.write(id, &val, sizeof(val)), "FileStore::write of existing item failed.");
+				}
+				for (auto id = firstId; id < firstId + itemCount; ++id) {
+					uint32_t val = 0;
+					const auto err = fileStore.read(id, &val, sizeof(val));
+					if (id % 2 == firstId % 2) {
+						oxAssert(err != 0, "Removed item still readable.");
+					} else {
+						oxAssert(err, "FileStore::read failed.");
+						const auto expected = (id - firstId - 1) % 6 ? id : id * 2;
+						oxAssert(val == expected, "Read wrong value.");
+					}
+				}
+				oxAssert(fileStore.write(1, &itemCount, sizeof(itemCount)) != 0, "Index inode should not be writable.");
+				return OxError(0);
+			}
+		},
+		{
+			"FileStore::migrateIndex",
+			[](std::string_view) {
+				struct OX_PACKED LegacyFileStoreData {
+					ox::LittleEndian<uint32_t> rootNode = 0;
+					ox::Random random;
+				};
+				// a degenerate tree, deeper than the old recursive lookups could walk
+				constexpr uint32_t itemCount = 6000;
+				constexpr uint32_t firstId = 1000;
+				ox::Vector<uint8_t> fsBuff(512 * 1024);
+				auto nb = new (fsBuff.data()) ox::ptrarith::NodeBuffer<uint32_t, ox::FileStoreItem<uint32_t>>(fsBuff.size());
+				auto fsDataItem = nb->malloc(sizeof(LegacyFileStoreData)).value;
+				auto fsData = nb->dataOf<LegacyFileStoreData>(fsDataItem);
+				oxAssert(fsData.valid(), "Could not access LegacyFileStoreData.");
+				new (fsData) LegacyFileStoreData;
+				uint32_t prev = 0;
+				for (auto id = firstId; id < firstId + itemCount; ++id) {
+					auto item = nb->malloc(sizeof(id)).value;
+					oxAssert(item.valid(), "NodeBuffer::malloc failed.");
+					item->id = id;
+					auto itemData = item->data();
+					oxAssert(itemData.valid(), "Could not access item data.");
+					ox_memcpy(itemData, &id, sizeof(id));
+					if (auto prevItem = nb->ptr(prev); prevItem.valid()) {
+						prevItem->right = item.offset();
+					} else {
+						fsData->rootNode = item.offset();
+					}
+					prev = item.offset();
+				}
+				ox::FileStore32 fileStore(fsBuff.data(), fsBuff.size());
+				uint32_t val = 0;
+				oxAssert(fileStore.read(firstId + itemCount - 1, &val, sizeof(val)), "Read from unversioned image failed.");
+				oxAssert(val == firstId + itemCount - 1, "Read wrong value from unversioned image.");
+				// the first write migrates the index
+				constexpr uint32_t newId = firstId + itemCount;
+				oxAssert(fileStore.write(newId, &newId, sizeof(newId)), "FileStore::write failed.");
+				oxAssert(fileStore.remove(firstId), "FileStore::remove failed.");
+				for (auto id = firstId + 1; id <= newId; ++id) {
+					oxAssert(fileStore.read(id, &val, sizeof(val)), "FileStore::read failed.");
+					oxAssert(val == id, "Read wrong value.");
+				}
+				oxAssert(fileStore.read(firstId, &val, sizeof(val)) != 0, "Removed item still readable.");
+				return OxError(0);
+			}
+		},
+		{
+			"FileStore::compact",
+			[](std::string_view arg) {
+				// doubles as a benchmark, takes the inode count as an optional argument
+				uint32_t itemCount = 20000;
+				if (!arg.empty()) {
+					oxRequire(count, ox_atoi(arg.data()));
+					itemCount = static_cast<uint32_t>(count);
+				}
+				constexpr uint32_t firstId = 1000;
+				constexpr auto maxWords = 8;
+				const auto words = [](uint32_t id) { return id % maxWords + 1; };
+				ox::Vector<uint8_t> fsBuff(itemCount * 80 + 1024);
+				oxAssert(ox::FileStore32::format(fsBuff.data(), fsBuff.size()), "FileStore::format failed.");
+				ox::FileStore32 fileStore(fsBuff.data(), fsBuff.size());
+				uint32_t data[maxWords];
+				for (auto id = firstId; id < firstId + itemCount; ++id) {
+					for (auto &d : data) {
+						d = id;
+					}
+					oxAssert(fileStore.write(id, data, words(id) * sizeof(uint32_t)), "FileStore::write failed.");
+				}
+				// punch holes throughout the buffer
+				for (auto id = firstId; id < firstId + itemCount; id += 2) {
+					oxAssert(fileStore.remove(id), "FileStore::remove failed.");
+				}
+				const auto available = fileStore.available();
+				const auto start = std::chrono::steady_clock::now();
+				oxAssert(fileStore.compact(), "FileStore::compact failed.");
+				const auto time = std::chrono::steady_clock::now() - start;
+				oxOutf("compacted {} inodes in {} us\n", itemCount / 2,
+				       static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(time).count()));
+				oxAssert(fileStore.available() == available, "Compaction changed the space in use.");
+				for (auto id = firstId + 1; id < firstId + itemCount; id += 2) {
+					oxAssert(fileStore.stat(id).value.size == words(id) * sizeof(uint32_t), "Stat gave wrong size.");
+					oxAssert(fileStore.read(id, data, sizeof(data)), "FileStore::read failed.");
+					for (auto i = 0u; i < words(id); ++i) {
+						oxAssert(data[i] == id, "Read wrong value.");
+					}
+				}
+				// all free space should now be at the end of the buffer
+				const auto bigSize = available - fileStore.spaceNeeded(0);
+				oxAssert(fileStore.write(firstId, nullptr, bigSize), "Write into compacted space failed.");
+				return OxError(0);
+			}
+		},
 		{
 			"Directory",
 			[](std::string_view) {
@@ -214,6 +344,133 @@ const std::map<std::string_view, std::function<ox::Error(std::string_view)>> tes
 				return OxError(0);
 			}
 		},
+		{
+			"Directory::index",
+			[](std::string_view) {
+				constexpr uint32_t entryCount = 2000;
+				constexpr uint32_t firstInode = 1000;
+				ox::Vector<uint8_t> fsBuff(1024 * 1024);
+				oxAssert(ox::FileStore32::format(fsBuff.data(), fsBuff.size()), "FS format failed");
+				ox::FileStore32 fileStore(fsBuff.data(), fsBuff.size());
+				ox::Directory32 dir(fileStore, 105);
+				oxAssert(dir.init(), "Init failed");
+				for (auto i = 0u; i < entryCount; ++i) {
+					const auto path = "/file" + std::to_string(i);
+					oxAssert(dir.write(path.c_str(), firstInode + i), "Directory write failed");
+				}
+				// rewriting an entry points it at the new inode rather than adding another
+				oxAssert(dir.write("/file7", 7), "Directory rewrite failed");
+				for (auto i = 0u; i < entryCount; i += 3) {
+					const auto name = "file" + std::to_string(i);
+					oxAssert(dir.remove(name.c_str()), "Directory remove failed");
+				}
+				for (auto i = 0u; i < entryCount; ++i) {
+					const auto name = "file" + std::to_string(i);
+					auto [inode, err] = dir.find(name.c_str());
+					if (i % 3 == 0) {
+						oxAssert(err != 0, "Removed entry still found");
+					} else {
+						oxAssert(err, "Could not find entry");
+						oxAssert(inode == (i == 7 ? 7 : firstInode + i), "Entry has the wrong inode");
+					}
+				}
+				uint32_t listed = 0;
+				oxAssert(dir.ls([&listed](const char*, uint32_t) {
+					++listed;
+					return OxError(0);
+				}), "Directory ls failed");
+				oxAssert(listed == entryCount - (entryCount + 2) / 3, "Directory ls listed the wrong number of entries");
+				return OxError(0);
+			}
+		},
+		{
+			"Directory::legacy",
+			[](std::string_view) {
+				// build a directory the way it was written before it had an index
+				using DirBuffer = ox::ptrarith::NodeBuffer<uint32_t, ox::DirectoryEntry<uint32_t>>;
+				using EntryData = ox::DirectoryEntry<uint32_t>::DirectoryEntryData;
+				constexpr uint32_t entryCount = 200;
+				constexpr uint32_t firstInode = 1000;
+				ox::Vector<uint8_t> dirBuff(16 * 1024);
+				auto legacy = new (dirBuff.data()) DirBuffer(dirBuff.size());
+				for (auto i = 0u; i < entryCount; ++i) {
+					const auto name = "file" + std::to_string(i);
+					auto entry = legacy->malloc(EntryData::spaceNeeded(name.size() + 1)).value;
+					oxAssert(entry.valid(), "NodeBuffer::malloc failed.");
+					oxAssert(entry->init(firstInode + i, name.c_str(), entry.size()), "DirectoryEntry::init failed.");
+				}
+				ox::Vector<uint8_t> fsBuff(256 * 1024);
+				oxAssert(ox::FileStore32::format(fsBuff.data(), fsBuff.size()), "FS format failed");
+				ox::FileStore32 fileStore(fsBuff.data(), fsBuff.size());
+				oxAssert(fileStore.write(105, legacy, legacy->size(), static_cast<uint8_t>(ox::FileType::Directory)), "FileStore::write failed.");
+				ox::Directory32 dir(fileStore, 105);
+				oxAssert(dir.find("file150").value == firstInode + 150, "Could not find entry of unindexed directory");
+				// the first write adds the index
+				oxAssert(dir.write("/new", 7), "Directory write failed");
+				oxAssert(dir.remove("file3"), "Directory remove failed");
+				for (auto i = 0u; i < entryCount; ++i) {
+					const auto name = "file" + std::to_string(i);
+					auto [inode, err] = dir.find(name.c_str());
+					if (i == 3) {
+						oxAssert(err != 0, "Removed entry still found");
+					} else {
+						oxAssert(err, "Could not find entry");
+						oxAssert(inode == firstInode + i, "Entry has the wrong inode");
+					}
+				}
+				oxAssert(dir.find("new").value == 7, "Could not find new entry");
+				return OxError(0);
+			}
+		},
+		{
+			"Directory::legacyOverwrite",
+			[](std::string_view) {
+				// rewriting a name the unindexed directory already holds
+				using DirBuffer = ox::ptrarith::NodeBuffer<uint32_t, ox::DirectoryEntry<uint32_t>>;
+				using EntryData = ox::DirectoryEntry<uint32_t>::DirectoryEntryData;
+				ox::Vector<uint8_t> dirBuff(1024);
+				auto legacy = new (dirBuff.data()) DirBuffer(dirBuff.size());
+				for (const auto name : {"a", "b", "c"}) {
+					auto entry = legacy->malloc(EntryData::spaceNeeded(ox_strlen(name) + 1)).value;
+					oxAssert(entry.valid(), "NodeBuffer::malloc failed.");
+					oxAssert(entry->init(1000, name, entry.size()), "DirectoryEntry::init failed.");
+				}
+				ox::Vector<uint8_t> fsBuff(64 * 1024);
+				oxAssert(ox::FileStore32::format(fsBuff.data(), fsBuff.size()), "FS format failed");
+				ox::FileStore32 fileStore(fsBuff.data(), fsBuff.size());
+				oxAssert(fileStore.write(105, legacy, legacy->size(), static_cast<uint8_t>(ox::FileType::Directory)), "FileStore::write failed.");
+				ox::Directory32 dir(fileStore, 105);
+				oxAssert(dir.write("/b", 7), "Overwriting an entry of an unindexed directory failed");
+				oxAssert(dir.find("b").value == 7, "Overwritten entry has the wrong inode");
+				oxAssert(dir.find("a").value == 1000 && dir.find("c").value == 1000, "Other entries lost");
+				uint32_t listed = 0;
+				oxAssert(dir.ls([&listed](const char*, uint32_t) {
+					++listed;
+					return OxError(0);
+				}), "Directory ls failed");
+				oxAssert(listed == 3, "Overwriting added a second entry");
+				return OxError(0);
+			}
+		},
+		{
+			"Directory::removeNested",
+			[](std::string_view) {
+				ox::Vector<uint8_t> fsBuff(64 * 1024);
+				oxAssert(ox::FileStore32::format(fsBuff.data(), fsBuff.size()), "FS format failed");
+				ox::FileStore32 fileStore(fsBuff.data(), fsBuff.size());
+				ox::Directory32 dir(fileStore, 105);
+				oxAssert(dir.init(), "Init failed");
+				oxAssert(dir.mkdir("/a/b", true), "mkdir failed");
+				oxAssert(dir.write("/a/b/file", 1000), "Directory write failed");
+				oxAssert(dir.write("/a/b/other", 1001), "Directory write failed");
+				oxAssert(dir.remove("/a/b/file"), "Directory remove failed");
+				oxAssert(dir.find("/a/b/file").error != 0, "Removed entry still found");
+				oxAssert(dir.find("/a/b/other").value == 1001, "Sibling of removed entry lost");
+				oxAssert(dir.find("/a/b").error, "Parent of removed entry lost");
+				oxAssert(dir.find("/a").error, "Top level directory of removed entry lost");
+				return OxError(0);
+			}
+		},
 		{
 			"FileSystem",
 			[](std::string_view) {
@@ -233,6 +490,57 @@ const std::map<std::string_view, std::function<ox::Error(std::string_view)>> tes
 				return OxError(0);
 			}
 		},
+		{
+			"FileSystem::pathCache",
+			[](std::string_view) {
+				ox::Vector<uint8_t> fsBuff(64 * 1024);
+				oxAssert(ox::FileSystem32::format(fsBuff.data(), fsBuff.size()), "FileSystem format failed");
+				ox::FileSystem32 fs(ox::FileStore32(fsBuff.data(), fsBuff.size()));
+				fs.setPathCacheSize(64);
+				const char data[] = "charset";
+				oxAssert(fs.mkdir("/TileSheets", true), "mkdir failed");
+				oxAssert(fs.mkdir("/Zones/a", true), "mkdir failed");
+				oxAssert(fs.write("/TileSheets/Charset.ng", data, sizeof(data), ox::FileType::NormalFile), "write failed");
+				oxAssert(fs.write("/Zones/a/map", data, sizeof(data), ox::FileType::NormalFile), "write failed");
+
+				// repeated lookups, however the path is spelled, hit the cache
+				fs.resetPathCacheStats();
+				oxRequire(st, fs.stat("/TileSheets/Charset.ng"));
+				oxAssert(fs.stat("TileSheets/Charset.ng/").value.inode == st.inode, "Normalized path resolved to the wrong inode");
+				char buff[sizeof(data)] = {};
+				oxAssert(fs.read("/TileSheets/Charset.ng", buff, sizeof(buff)), "read failed");
+				oxAssert(ox_strcmp(buff, data) == 0, "read returned the wrong data");
+				oxAssert(fs.pathCacheStats().misses == 1 && fs.pathCacheStats().hits == 2, "Unexpected path cache stats");
+				oxAssert(fs.stat("/TileSheets//Charset.ng").error != 0, "Path with an empty name resolved");
+
+				// changed paths and everything below them are dropped
+				oxAssert(fs.move("/TileSheets/Charset.ng", "/Zones/a/Charset.ng"), "move failed");
+				oxAssert(fs.stat("/TileSheets/Charset.ng").error != 0, "Moved file still found at old path");
+				oxAssert(fs.stat("/Zones/a/Charset.ng").value.inode == st.inode, "Moved file not found at new path");
+				oxAssert(fs.remove("/Zones/a/Charset.ng", false), "remove failed");
+				oxAssert(fs.stat("/Zones/a/Charset.ng").error != 0, "Removed file still found");
+				oxAssert(fs.stat("/Zones/a/map").error, "stat failed");
+				oxAssert(fs.remove("/Zones", true), "remove failed");
+				oxAssert(fs.stat("/Zones/a/map").error != 0, "File under removed directory still found");
+				oxAssert(fs.stat("/Zones/a").error != 0, "Directory under removed directory still found");
+				oxAssert(fs.mkdir("/Zones/a", true), "mkdir failed");
+				oxAssert(fs.stat("/Zones/a/map").error != 0, "File found in recreated directory");
+
+				// more paths than the cache holds still resolve
+				fs.setPathCacheSize(4);
+				for (auto i = 0; i < 20; ++i) {
+					const auto path = "/Zones/a/f" + std::to_string(i);
+					oxAssert(fs.write(path.c_str(), data, sizeof(data), ox::FileType::NormalFile), "write failed");
+				}
+				for (auto pass = 0; pass < 2; ++pass) {
+					for (auto i = 0; i < 20; ++i) {
+						const auto path = "/Zones/a/f" + std::to_string(i);
+						oxAssert(fs.stat(path.c_str()).error, "stat failed");
+					}
+				}
+				return OxError(0);
+			}
+		},
 	},
 };
 
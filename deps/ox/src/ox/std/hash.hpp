@@ -0,0 +1,46 @@
+/*
+ * Copyright 2015 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "types.hpp"
+
+namespace ox {
+
+constexpr uint32_t Fnv1a32Basis = 2166136261u;
+constexpr uint64_t Fnv1a64Basis = 14695981039346656037ull;
+
+/**
+ * 32 bit FNV-1a hash of len bytes.
+ * @param h hash of the preceding data, to hash data in pieces
+ */
+template<typename T>
+[[nodiscard]]
+constexpr uint32_t fnv1a32(const T *data, std::size_t len, uint32_t h = Fnv1a32Basis) noexcept {
+	static_assert(sizeof(T) == 1, "FNV-1a hashes bytes");
+	for (std::size_t i = 0; i < len; ++i) {
+		h = (h ^ static_cast<uint8_t>(data[i])) * 16777619u;
+	}
+	return h;
+}
+
+/**
+ * 64 bit FNV-1a hash of len bytes.
+ * @param h hash of the preceding data, to hash data in pieces
+ */
+template<typename T>
+[[nodiscard]]
+constexpr uint64_t fnv1a64(const T *data, std::size_t len, uint64_t h = Fnv1a64Basis) noexcept {
+	static_assert(sizeof(T) == 1, "FNV-1a hashes bytes");
+	for (std::size_t i = 0; i < len; ++i) {
+		h = (h ^ static_cast<uint8_t>(data[i])) * 1099511628211ull;
+	}
+	return h;
+}
+
+}
@@ -17,6 +17,7 @@
 #include "error.hpp"
 #include "fmt.hpp"
 #include "hardware.hpp"
+#include "hash.hpp"
 #include "hashmap.hpp"
 #include "heapmgr.hpp"
 #include "iterator.hpp"
@@ -101,6 +101,27 @@ std::map<std::string, std::function<ox::Error()>> tests = {
 			return OxError(0);
 		}
 	},
+	{
+		"Vector::nested",
+		[] {
+			// elements that own memory must be constructed in place, not assigned over raw storage
+			ox::Vector<ox::Vector<int>> v(2);
+			v[0].push_back(1);
+			v.resize(300);
+			v[299].push_back(2);
+			const auto first = v[0];
+			v.insert(1, first);
+			oxAssert(v.size() == 301, "Vector size incorrect");
+			oxAssert(v[0][0] == 1 && v[1][0] == 1 && v[300][0] == 2, "Vector value wrong");
+			auto copy = v;
+			oxReturnError(copy.erase(0));
+			oxReturnError(copy.unordered_erase(copy.size() - 1));
+			oxAssert(copy.size() == 299 && copy[0][0] == 1, "Vector erase failed");
+			copy = v;
+			oxAssert(copy == v, "Vector copy differs");
+			return OxError(0);
+		}
+	},
 	{
 		"HashMap",
 		[] {
@@ -112,6 +133,20 @@ std::map<std::string, std::function<ox::Error()>> tests = {
 			return OxError(0);
 		}
 	},
+	{
+		"fnv1a",
+		[] {
+			static_assert(ox::fnv1a32("", 0) == ox::Fnv1a32Basis);
+			static_assert(ox::fnv1a32("a", 1) == 0xe40c292c);
+			static_assert(ox::fnv1a64("", 0) == ox::Fnv1a64Basis);
+			static_assert(ox::fnv1a64("a", 1) == 0xaf63dc4c8601ec8c);
+			oxAssert(ox::fnv1a32("foobar", 6) == 0xbf9cf968, "fnv1a32 is broken");
+			oxAssert(ox::fnv1a64("foobar", 6) == 0x85944171f73967e8, "fnv1a64 is broken");
+			oxAssert(ox::fnv1a64("bar", 3, ox::fnv1a64("foo", 3)) == ox::fnv1a64("foobar", 6),
+			         "fnv1a64 of pieces differs from the whole");
+			return OxError(0);
+		}
+	},
 };
 
 int main(int argc, const char **args) {
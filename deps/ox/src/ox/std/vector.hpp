@@ -38,7 +38,8 @@ struct SmallVector {
 				const auto dstItems = bit_cast<T*>(m_data);
 				const auto srcItems = bit_cast<T*>(src.m_data);
 				for (auto i = 0u; i < count; ++i) {
-					dstItems[i] = move(srcItems[i]);
+					new (&dstItems[i]) T(move(srcItems[i]));
+					srcItems[i].~T();
 				}
 				*items = bit_cast<T*>(m_data);
 			}
@@ -291,7 +292,7 @@ Vector<T, SmallVectorSize>::Vector(std::size_t size) noexcept {
 	m_cap = m_size;
 	this->initItems(&m_items, m_cap);
 	for (std::size_t i = 0; i < size; ++i) {
-		m_items[i] = {};
+		new (&m_items[i]) T();
 	}
 }
 
@@ -301,7 +302,7 @@ Vector<T, SmallVectorSize>::Vector(const Vector &other) {
 	m_cap = other.m_cap;
 	this->initItems(&m_items, other.m_cap);
 	for (std::size_t i = 0; i < m_size; ++i) {
-		m_items[i] = other.m_items[i];
+		new (&m_items[i]) T(other.m_items[i]);
 	}
 }
 
@@ -346,7 +347,7 @@ constexpr Vector<T, SmallVectorSize> &Vector<T, SmallVectorSize>::operator=(cons
 		m_cap = other.m_cap;
 		this->initItems(&m_items, other.m_cap);
 		for (std::size_t i = 0; i < m_size; i++) {
-			m_items[i] = other.m_items[i];
+			new (&m_items[i]) T(other.m_items[i]);
 		}
 	}
 	return *this;
@@ -441,7 +442,7 @@ constexpr void Vector<T, SmallVectorSize>::resize(std::size_t size) {
 	}
 	if (m_size < size) {
 		for (std::size_t i = m_size; i < size; i++) {
-			m_items[i] = {};
+			new (&m_items[i]) T();
 		}
 	} else {
 		for (std::size_t i = size; i < m_size; i++) {
@@ -467,10 +468,15 @@ void Vector<T, SmallVectorSize>::insert(std::size_t pos, const T &val) {
 	if (m_size == m_cap) {
 		expandCap(m_cap ? m_cap * 2 : 100);
 	}
-	for (auto i = m_size; i > pos; --i) {
-		m_items[i] = move(m_items[i - 1]);
+	if (pos == m_size) {
+		new (&m_items[m_size]) T(val);
+	} else {
+		new (&m_items[m_size]) T(move(m_items[m_size - 1]));
+		for (auto i = m_size - 1; i > pos; --i) {
+			m_items[i] = move(m_items[i - 1]);
+		}
+		m_items[pos] = val;
 	}
-	m_items[pos] = val;
 	++m_size;
 }
 
@@ -480,7 +486,7 @@ void Vector<T, SmallVectorSize>::emplace_back(Args&&... args) {
 	if (m_size == m_cap) {
 		expandCap(m_cap ? m_cap * 2 : 100);
 	}
-	new (&m_items[m_size]) T{args...};
+	new (&m_items[m_size]) T{static_cast<Args&&>(args)...};
 	++m_size;
 }
 
@@ -508,6 +514,7 @@ Error Vector<T, SmallVectorSize>::erase(std::size_t pos) {
 	for (auto i = pos; i < m_size; ++i) {
 		m_items[i] = move(m_items[i + 1]);
 	}
+	m_items[m_size].~T();
 	return OxError(0);
 }
 
@@ -517,7 +524,10 @@ Error Vector<T, SmallVectorSize>::unordered_erase(std::size_t pos) {
 		return OxError(1);
 	}
 	--m_size;
-	m_items[pos] = move(m_items[m_size]);
+	if (pos != m_size) {
+		m_items[pos] = move(m_items[m_size]);
+	}
+	m_items[m_size].~T();
 	return OxError(0);
 }
 
@@ -529,10 +539,8 @@ void Vector<T, SmallVectorSize>::expandCap(std::size_t cap) {
 	if (oldItems) { // move over old items
 		const auto itRange = cap > m_size ? m_size : cap;
 		for (std::size_t i = 0; i < itRange; i++) {
-			m_items[i] = move(oldItems[i]);
-		}
-		for (std::size_t i = itRange; i < m_cap; i++) {
-			new (&m_items[i]) T;
+			new (&m_items[i]) T(move(oldItems[i]));
+			oldItems[i].~T();
 		}
 		this->clearItems(bit_cast<AllocAlias<T>*>(oldItems));
 	}
@@ -10,6 +10,8 @@
 
 #include <ox/fs/fs.hpp>
 
+#include "framearena.hpp"
+
 namespace nostalgia::core {
 
 // User Input Output
@@ -19,6 +21,7 @@ class Context {
 	private:
 		void *m_windowerData = nullptr;
 		void *m_rendererData = nullptr;
+		FrameArena m_frameArena;
 
 	public:
 		constexpr void setWindowerData(void *windowerData) noexcept {
@@ -41,6 +44,15 @@ class Context {
 			return static_cast<T*>(m_rendererData);
 		}
 
+		/**
+		 * @return allocator for memory that is only needed until the end of
+		 *         the current frame
+		 */
+		[[nodiscard]]
+		constexpr FrameArena *frameArena() noexcept {
+			return &m_frameArena;
+		}
+
 };
 
 }
@@ -27,6 +27,80 @@ ox::Error run(Context *ctx) noexcept;
 // sleep time is a minimum of ~16 milliseconds.
 void setEventHandler(Context *ctx, event_handler) noexcept;
 
+/**
+ * Switches run to a fixed timestep. The event handler is called once per tick
+ * of tickUs microseconds, catching up with at most maxCatchUpTicks calls per
+ * frame, and its return value only matters if negative, which stops further
+ * calls. Frames are drawn at most once per frameCapUs microseconds, or once
+ * per tick if frameCapUs is 0, and run sleeps until the next deadline between
+ * them.
+ * Passing a tickUs of 0 returns to the sleep based scheduling described for
+ * setEventHandler.
+ */
+void setFixedStep(Context *ctx, uint64_t tickUs, int maxCatchUpTicks = 4, uint64_t frameCapUs = 0) noexcept;
+
+/**
+ * @return progress into the next fixed step tick, in [0, 1), for
+ *         interpolating rendered state, 0 if fixed stepping is disabled
+ */
+[[nodiscard]]
+float tickInterpolation(Context *ctx) noexcept;
+
+enum class VsyncMode {
+	// tear on late frames instead of waiting for the next refresh, where supported
+	Adaptive = -1,
+	Off = 0,
+	On = 1,
+};
+
+struct FramePacing {
+	VsyncMode vsync = VsyncMode::On;
+	// frames per second to pace to by sleeping, 0 leaves pacing to vsync
+	uint64_t targetFps = 0;
+	// delays polling input and running the event handler to just before the
+	// frame must be presented, going by how long recent frames took, instead
+	// of starting right after the previous present
+	bool lowLatency = false;
+};
+
+/**
+ * Sets how frames are paced. Applies to both the event driven and the fixed
+ * step scheduling, targetFps combines with the frameCapUs of setFixedStep
+ * by taking the longer frame time.
+ */
+void setFramePacing(Context *ctx, const FramePacing &pacing) noexcept;
+
+[[nodiscard]]
+FramePacing framePacing(Context *ctx) noexcept;
+
+/**
+ * Time from an input event to the end of the swap of the first frame drawn
+ * after the event handler saw it, over recent frames that had input.
+ */
+struct InputLatency {
+	uint64_t p50Us = 0;
+	uint64_t p95Us = 0;
+	uint64_t p99Us = 0;
+	// number of frames measured
+	uint64_t frames = 0;
+};
+
+[[nodiscard]]
+InputLatency inputLatency(Context *ctx) noexcept;
+
+/**
+ * Moves drawing and buffer swaps to a thread of their own, so that the event
+ * handler can run for the next frame while the GPU driver work of the
+ * current one is done. Renderer state set through the core API is double
+ * buffered and handed to the render thread between frames, so callers need
+ * no changes. Only supported by the GLFW windower, and to be called from
+ * the thread that calls run.
+ */
+ox::Error setRenderThread(Context *ctx, bool enabled) noexcept;
+
+[[nodiscard]]
+bool renderThread(Context *ctx) noexcept;
+
 // Returns the number of milliseconds that have passed since the start of the
 //  program.
 [[nodiscard]]
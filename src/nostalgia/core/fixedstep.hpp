@@ -0,0 +1,101 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <ox/std/types.hpp>
+
+namespace nostalgia::core {
+
+/**
+ * Accumulates elapsed time into fixed length simulation ticks. Platform run
+ * loops feed it the current time and run the event handler once per tick it
+ * returns.
+ */
+class FixedStep {
+
+	private:
+		uint64_t m_tickUs = 0;
+		uint64_t m_maxCatchUpTicks = 0;
+		uint64_t m_prevUs = 0;
+		uint64_t m_accumUs = 0;
+		uint64_t m_droppedTicks = 0;
+		bool m_started = false;
+
+	public:
+		constexpr FixedStep() noexcept = default;
+
+		/**
+		 * @param tickUs length of a tick in microseconds, 0 disables fixed stepping
+		 * @param maxCatchUpTicks most ticks returned by a single advance, time
+		 *                        beyond that is dropped, so an overloaded
+		 *                        machine slows the game down instead of
+		 *                        falling further and further behind
+		 */
+		constexpr FixedStep(uint64_t tickUs, uint64_t maxCatchUpTicks) noexcept:
+			m_tickUs(tickUs), m_maxCatchUpTicks(maxCatchUpTicks ? maxCatchUpTicks : 1) {
+		}
+
+		[[nodiscard]]
+		constexpr bool enabled() const noexcept {
+			return m_tickUs != 0;
+		}
+
+		[[nodiscard]]
+		constexpr uint64_t tickUs() const noexcept {
+			return m_tickUs;
+		}
+
+		/**
+		 * Adds the time since the last call to the accumulator.
+		 * @return number of ticks to run now
+		 */
+		constexpr uint64_t advance(uint64_t nowUs) noexcept {
+			if (!m_started) {
+				m_prevUs = nowUs;
+				m_started = true;
+			}
+			m_accumUs += nowUs - m_prevUs;
+			m_prevUs = nowUs;
+			auto ticks = m_accumUs / m_tickUs;
+			m_accumUs -= ticks * m_tickUs;
+			if (ticks > m_maxCatchUpTicks) {
+				m_droppedTicks += ticks - m_maxCatchUpTicks;
+				ticks = m_maxCatchUpTicks;
+			}
+			return ticks;
+		}
+
+		/**
+		 * @return time at which the next tick is due
+		 */
+		[[nodiscard]]
+		constexpr uint64_t nextTickUs() const noexcept {
+			return m_prevUs + (m_tickUs - m_accumUs);
+		}
+
+		/**
+		 * @return progress into the next tick, in [0, 1), for interpolating
+		 *         rendered state between the last two ticks
+		 */
+		[[nodiscard]]
+		constexpr float alpha() const noexcept {
+			return m_tickUs ? static_cast<float>(m_accumUs) / static_cast<float>(m_tickUs) : 0;
+		}
+
+		/**
+		 * @return number of ticks dropped for exceeding the catch up limit
+		 */
+		[[nodiscard]]
+		constexpr uint64_t droppedTicks() const noexcept {
+			return m_droppedTicks;
+		}
+
+};
+
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "framearena.hpp"
+
+namespace nostalgia::core {
+
+// overflow blocks start with their header, padded to keep the data aligned
+constexpr std::size_t OverflowHeaderSize = 64;
+
+static constexpr std::size_t alignUp(std::size_t v, std::size_t align) noexcept {
+	return (v + align - 1) & ~(align - 1);
+}
+
+FrameArena::FrameArena(std::size_t capacity) noexcept: m_capacity(capacity) {
+}
+
+FrameArena::~FrameArena() noexcept {
+	reset();
+	delete[] m_buff;
+}
+
+void *FrameArena::alloc(std::size_t size, std::size_t align) noexcept {
+	m_frameBytes += size + align;
+	if (m_frameBytes > m_peak) {
+		m_peak = m_frameBytes;
+	}
+	if (!m_buff && m_capacity) {
+		// on failure everything goes to the overflow path
+		m_buff = new uint8_t[m_capacity];
+	}
+	// align the address, as operator new[] only guarantees fundamental alignment
+	const auto base = reinterpret_cast<std::size_t>(m_buff);
+	const auto offset = alignUp(base + m_used, align) - base;
+	if (m_buff && offset + size <= m_capacity) {
+		m_used = offset + size;
+		return m_buff + offset;
+	}
+	++m_overflows;
+	const auto block = new uint8_t[OverflowHeaderSize + size + align];
+	if (!block) {
+		return nullptr;
+	}
+	const auto overflow = new (block) Overflow{m_overflow};
+	m_overflow = overflow;
+	const auto data = reinterpret_cast<std::size_t>(block + OverflowHeaderSize);
+	return block + OverflowHeaderSize + (alignUp(data, align) - data);
+}
+
+void FrameArena::reset() noexcept {
+	const auto overflowed = m_overflow != nullptr;
+	while (m_overflow) {
+		const auto next = m_overflow->next;
+		delete[] reinterpret_cast<uint8_t*>(m_overflow);
+		m_overflow = next;
+	}
+	if (overflowed && m_peak > m_capacity) {
+		delete[] m_buff;
+		// leave some headroom so a slowly growing frame doesn't reallocate every time
+		const auto capacity = alignUp(m_peak + m_peak / 4, 4096);
+		m_buff = new uint8_t[capacity];
+		m_capacity = m_buff ? capacity : 0;
+	}
+	m_used = 0;
+	m_frameBytes = 0;
+}
+
+}
@@ -0,0 +1,274 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <ox/std/defines.hpp>
+#include <ox/std/new.hpp>
+#include <ox/std/types.hpp>
+#include <ox/std/utility.hpp>
+
+namespace nostalgia::core {
+
+/**
+ * Bump allocator for memory that lives no longer than a frame. The platform
+ * run loop resets it at the end of every iteration.
+ * Allocations that do not fit fall back to the heap until the next reset,
+ * which then grows the arena to the frame's peak usage, so after a warm up
+ * frame or two a steady state frame does no heap allocations at all.
+ * Not thread safe, use it only from the thread running the event handler.
+ */
+class FrameArena {
+
+	public:
+		// the GBA heap is only 128 KiB, reset grows the arena if a frame needs more
+		static constexpr std::size_t DefaultCapacity =
+			ox::defines::OS == ox::defines::OS::BareMetal ? 4 * 1024 : 64 * 1024;
+		// matches the alignment malloc guarantees on common platforms
+		static constexpr std::size_t DefaultAlignment = 2 * sizeof(void*);
+
+	private:
+		struct Overflow {
+			Overflow *next = nullptr;
+		};
+
+		uint8_t *m_buff = nullptr;
+		std::size_t m_capacity = 0;
+		std::size_t m_used = 0;
+		// bytes requested since the last reset, including overflow allocations
+		std::size_t m_frameBytes = 0;
+		std::size_t m_peak = 0;
+		Overflow *m_overflow = nullptr;
+		uint64_t m_overflows = 0;
+
+	public:
+		/**
+		 * @param capacity initial capacity, allocated on first use
+		 */
+		explicit FrameArena(std::size_t capacity = DefaultCapacity) noexcept;
+
+		~FrameArena() noexcept;
+
+		FrameArena(const FrameArena&) = delete;
+
+		FrameArena &operator=(const FrameArena&) = delete;
+
+		/**
+		 * @return size bytes aligned to align, which must be a power of 2,
+		 *         valid until the next reset or rewind past it, or null if
+		 *         the heap is out of memory
+		 */
+		[[nodiscard]]
+		void *alloc(std::size_t size, std::size_t align = DefaultAlignment) noexcept;
+
+		template<typename T>
+		[[nodiscard]]
+		T *alloc(std::size_t count) noexcept {
+			return static_cast<T*>(alloc(sizeof(T) * count, alignof(T)));
+		}
+
+		/**
+		 * @return the current fill position, for rewind
+		 */
+		[[nodiscard]]
+		constexpr std::size_t mark() const noexcept {
+			return m_used;
+		}
+
+		/**
+		 * Frees everything allocated from the arena since mark was taken.
+		 * Overflow allocations are kept until the next reset.
+		 */
+		constexpr void rewind(std::size_t mark) noexcept {
+			if (mark < m_used) {
+				m_used = mark;
+			}
+		}
+
+		/**
+		 * Frees all allocations, growing the arena if the last frame overflowed.
+		 */
+		void reset() noexcept;
+
+		[[nodiscard]]
+		constexpr std::size_t capacity() const noexcept {
+			return m_capacity;
+		}
+
+		[[nodiscard]]
+		constexpr std::size_t used() const noexcept {
+			return m_used;
+		}
+
+		/**
+		 * @return most bytes requested in a single frame
+		 */
+		[[nodiscard]]
+		constexpr std::size_t peak() const noexcept {
+			return m_peak;
+		}
+
+		/**
+		 * @return number of allocations that did not fit and went to the heap
+		 */
+		[[nodiscard]]
+		constexpr uint64_t overflows() const noexcept {
+			return m_overflows;
+		}
+
+};
+
+/**
+ * Rewinds the arena to where it was at construction once it goes out of
+ * scope, for temporaries that are done with before the end of the frame.
+ */
+class ArenaScope {
+
+	private:
+		FrameArena *m_arena = nullptr;
+		std::size_t m_mark = 0;
+
+	public:
+		explicit ArenaScope(FrameArena *arena) noexcept: m_arena(arena), m_mark(arena->mark()) {
+		}
+
+		~ArenaScope() noexcept {
+			m_arena->rewind(m_mark);
+		}
+
+		ArenaScope(const ArenaScope&) = delete;
+
+		ArenaScope &operator=(const ArenaScope&) = delete;
+
+};
+
+/**
+ * Growable array in a FrameArena. Growing leaves the old items' memory
+ * unused until the arena is reset, so reserve up front where the size is
+ * known. The vector must not outlive the frame it was created in.
+ * If the arena runs out of memory, the vector stops growing.
+ */
+template<typename T>
+class ArenaVector {
+
+	private:
+		FrameArena *m_arena = nullptr;
+		T *m_items = nullptr;
+		std::size_t m_size = 0;
+		std::size_t m_cap = 0;
+
+	public:
+		explicit ArenaVector(FrameArena *arena, std::size_t size = 0) noexcept: m_arena(arena) {
+			resize(size);
+		}
+
+		ArenaVector(const ArenaVector&) = delete;
+
+		ArenaVector &operator=(const ArenaVector&) = delete;
+
+		ArenaVector(ArenaVector &&other) noexcept:
+			m_arena(other.m_arena), m_items(other.m_items), m_size(other.m_size), m_cap(other.m_cap) {
+			other.m_items = nullptr;
+			other.m_size = 0;
+			other.m_cap = 0;
+		}
+
+		~ArenaVector() noexcept {
+			clear();
+		}
+
+		void reserve(std::size_t cap) noexcept {
+			if (cap <= m_cap) {
+				return;
+			}
+			const auto items = m_arena->alloc<T>(cap);
+			if (!items) {
+				return;
+			}
+			for (std::size_t i = 0; i < m_size; ++i) {
+				new (&items[i]) T(ox::move(m_items[i]));
+				m_items[i].~T();
+			}
+			m_items = items;
+			m_cap = cap;
+		}
+
+		void resize(std::size_t size) noexcept {
+			reserve(size);
+			if (size > m_cap) {
+				return;
+			}
+			for (auto i = m_size; i < size; ++i) {
+				new (&m_items[i]) T();
+			}
+			for (auto i = size; i < m_size; ++i) {
+				m_items[i].~T();
+			}
+			m_size = size;
+		}
+
+		void push_back(const T &item) noexcept {
+			if (m_size == m_cap) {
+				reserve(m_cap ? m_cap * 2 : 16);
+				if (m_size == m_cap) {
+					return;
+				}
+			}
+			new (&m_items[m_size]) T(item);
+			++m_size;
+		}
+
+		void clear() noexcept {
+			for (std::size_t i = 0; i < m_size; ++i) {
+				m_items[i].~T();
+			}
+			m_size = 0;
+		}
+
+		[[nodiscard]]
+		constexpr std::size_t size() const noexcept {
+			return m_size;
+		}
+
+		[[nodiscard]]
+		constexpr T *data() noexcept {
+			return m_items;
+		}
+
+		[[nodiscard]]
+		constexpr const T *data() const noexcept {
+			return m_items;
+		}
+
+		constexpr T &operator[](std::size_t i) noexcept {
+			return m_items[i];
+		}
+
+		constexpr const T &operator[](std::size_t i) const noexcept {
+			return m_items[i];
+		}
+
+		constexpr T *begin() noexcept {
+			return m_items;
+		}
+
+		constexpr T *end() noexcept {
+			return m_items + m_size;
+		}
+
+		constexpr const T *begin() const noexcept {
+			return m_items;
+		}
+
+		constexpr const T *end() const noexcept {
+			return m_items + m_size;
+		}
+
+};
+
+}
@@ -8,6 +8,8 @@
 
 #include <nostalgia/core/config.hpp>
 #include <nostalgia/core/core.hpp>
+#include <nostalgia/core/fixedstep.hpp>
+#include <nostalgia/core/input.hpp>
 
 #include "addresses.hpp"
 #include "bios.hpp"
@@ -20,11 +22,38 @@ namespace nostalgia::core {
 extern volatile gba_timer_t g_timerMs;
 gba_timer_t g_wakeupTime;
 event_handler g_eventHandler = nullptr;
+FixedStep g_fixedStep;
+ButtonState g_buttons;
+
+/**
+ * Snapshots the gamepad register for the coming tick, the register reads
+ * 0 for pressed buttons.
+ */
+static void pollButtons() noexcept {
+	const auto held = static_cast<uint16_t>(~REG_GAMEPAD & 0x3ff);
+	g_buttons.pressed = static_cast<uint16_t>(held & ~g_buttons.held);
+	g_buttons.released = static_cast<uint16_t>(g_buttons.held & ~held);
+	g_buttons.held = held;
+}
+
+static void runFixedStepTicks(Context *ctx) noexcept {
+	// the ms timer is the finest clock available
+	const auto ticks = g_fixedStep.advance(static_cast<uint64_t>(g_timerMs) * 1000);
+	for (auto i = 0u; i < ticks && g_eventHandler && g_wakeupTime != ~gba_timer_t(0); ++i) {
+		pollButtons();
+		if (g_eventHandler(ctx) < 0) {
+			g_wakeupTime = ~gba_timer_t(0);
+		}
+	}
+}
 
 ox::Error run(Context *ctx) noexcept {
 	g_wakeupTime = 0;
 	while (1) {
-		if (g_wakeupTime <= g_timerMs && g_eventHandler) {
+		if (g_fixedStep.enabled()) {
+			runFixedStepTicks(ctx);
+		} else if (g_wakeupTime <= g_timerMs && g_eventHandler) {
+			pollButtons();
 			auto sleepTime = g_eventHandler(ctx);
 			if (sleepTime >= 0) {
 				g_wakeupTime = g_timerMs + static_cast<unsigned>(sleepTime);
@@ -32,6 +61,7 @@ ox::Error run(Context *ctx) noexcept {
 				g_wakeupTime = ~gba_timer_t(0);
 			}
 		}
+		ctx->frameArena()->reset();
 		if constexpr(config::GbaEventLoopTimerBased) {
 			// wait for timer interrupt
 			nostalgia_core_intrwait(0, Int_timer0 | Int_timer1 | Int_timer2 | Int_timer3);
@@ -8,6 +8,7 @@
 
 #include <nostalgia/core/config.hpp>
 #include <nostalgia/core/core.hpp>
+#include <nostalgia/core/fixedstep.hpp>
 #include <nostalgia/core/input.hpp>
 
 #include "addresses.hpp"
@@ -24,6 +25,8 @@ constexpr int MilliSecond = 1000;
 constexpr int TicksMs59ns = 65535 - (NanoSecond / MilliSecond) / 59.59;
 
 extern event_handler g_eventHandler;
+extern FixedStep g_fixedStep;
+extern ButtonState g_buttons;
 
 extern volatile gba_timer_t g_timerMs;
 
@@ -51,12 +54,45 @@ void setEventHandler(Context*, event_handler h) noexcept {
 	g_eventHandler = h;
 }
 
+void setFixedStep(Context*, uint64_t tickUs, int maxCatchUpTicks, uint64_t) noexcept {
+	// frames are scanned out by the hardware, so there is no frame cap to apply
+	g_fixedStep = FixedStep(tickUs, static_cast<uint64_t>(maxCatchUpTicks > 1 ? maxCatchUpTicks : 1));
+}
+
+void setFramePacing(Context*, const FramePacing&) noexcept {
+	// the LCD refreshes at a fixed ~59.73 Hz and frames are always in sync with it
+}
+
+FramePacing framePacing(Context*) noexcept {
+	return {};
+}
+
+InputLatency inputLatency(Context*) noexcept {
+	// the gamepad register is polled without timestamps, so there is nothing to measure
+	return {};
+}
+
+ox::Error setRenderThread(Context*, bool enabled) noexcept {
+	if (enabled) {
+		return OxError(1, "Render thread not supported on GBA");
+	}
+	return OxError(0);
+}
+
+bool renderThread(Context*) noexcept {
+	return false;
+}
+
+float tickInterpolation(Context*) noexcept {
+	return g_fixedStep.alpha();
+}
+
 uint64_t ticksMs(Context*) noexcept {
 	return g_timerMs;
 }
 
-bool buttonDown(Key k) noexcept {
-	return !(REG_GAMEPAD & k);
+ButtonState buttonState(Context*) noexcept {
+	return g_buttons;
 }
 
 }
@@ -8,6 +8,7 @@
 
 #include <ox/fs/fs.hpp>
 #include <ox/mc/mc.hpp>
+#include <ox/std/math.hpp>
 
 #include <nostalgia/core/media.hpp>
 #include <nostalgia/core/gfx.hpp>
@@ -148,6 +149,29 @@ constexpr volatile uint16_t &bgCtl(int bg) noexcept {
 	}
 }
 
+/**
+ * HOFS and VOFS are adjacent halfwords, so a word written to HOFS sets both.
+ */
+[[nodiscard]]
+constexpr volatile uint32_t &bgOffset(int bg) noexcept {
+	switch (bg) {
+		case 0:
+			return REG_BG0HOFS;
+		case 1:
+			return REG_BG1HOFS;
+		case 2:
+			return REG_BG2HOFS;
+		case 3:
+			return REG_BG3HOFS;
+		default:
+			oxPanic(OxError(1), "Looking up non-existent register");
+			return REG_BG0HOFS;
+	}
+}
+
+// the scroll registers are write only
+static BgTransform g_bgTransforms[4];
+
 // Do NOT rely on Context in the GBA version of this function.
 ox::Error initConsole(Context *ctx) noexcept {
 	constexpr auto TilesheetAddr = "/TileSheets/Charset.ng";
@@ -203,6 +227,65 @@ ox::Error loadSpriteTileSheet(Context *ctx,
 	return OxError(0);
 }
 
+// The GBA reads tile sheets straight out of ROM, so there is nothing to gain
+// from loading them in the background. Loads complete immediately, except for
+// deferred loads, which are held here until committed.
+struct DeferredTileSheetLoad {
+	TileSheetLoadId id = 0;
+	int section = 0;
+	ox::FileAddress tilesheetAddr;
+	ox::FileAddress paletteAddr;
+};
+
+static DeferredTileSheetLoad g_deferredLoads[4];
+static TileSheetLoadId g_nextTileSheetLoadId = 1;
+
+ox::Result<TileSheetLoadId> loadBgTileSheetAsync(Context *ctx,
+                                                 int section,
+                                                 const ox::FileAddress &tilesheetAddr,
+                                                 const ox::FileAddress &paletteAddr,
+                                                 bool commit) noexcept {
+	const auto id = g_nextTileSheetLoadId++;
+	if (commit) {
+		oxReturnError(loadBgTileSheet(ctx, section, tilesheetAddr, paletteAddr));
+		return id;
+	}
+	for (auto &d : g_deferredLoads) {
+		if (!d.id) {
+			d.id = id;
+			d.section = section;
+			d.tilesheetAddr = tilesheetAddr;
+			d.paletteAddr = paletteAddr;
+			return id;
+		}
+	}
+	return OxError(1, "Too many deferred tile sheet loads");
+}
+
+TileSheetLoadStatus tileSheetLoadStatus(Context*, TileSheetLoadId id) noexcept {
+	for (const auto &d : g_deferredLoads) {
+		if (d.id == id) {
+			return TileSheetLoadStatus::Decoded;
+		}
+	}
+	return TileSheetLoadStatus::Done;
+}
+
+ox::Error tileSheetLoadError(Context*, TileSheetLoadId) noexcept {
+	// failed loads are reported by loadBgTileSheetAsync or commitTileSheetLoad
+	return OxError(0);
+}
+
+ox::Error commitTileSheetLoad(Context *ctx, TileSheetLoadId id) noexcept {
+	for (auto &d : g_deferredLoads) {
+		if (d.id == id) {
+			d.id = 0;
+			return loadBgTileSheet(ctx, d.section, d.tilesheetAddr, d.paletteAddr);
+		}
+	}
+	return OxError(0);
+}
+
 ox::Error loadBgPalette(Context *ctx, int section, const ox::FileAddress &paletteAddr) noexcept {
 	GbaPaletteTarget target;
 	target.palette = &MEM_BG_PALETTE[section];
@@ -221,15 +304,71 @@ ox::Error loadSpritePalette(Context *ctx, int section, const ox::FileAddress &pa
 	return OxError(0);
 }
 
-// Do NOT use Context in the GBA version of this function.
-void puts(Context *ctx, int column, int row, const char *str) noexcept {
-	for (int i = 0; str[i]; i++) {
-		setTile(ctx, 0, column + i, row, static_cast<uint8_t>(charMap[static_cast<int>(str[i])]));
+void setTile(Context*, int layer, int column, int row, uint8_t tile) noexcept {
+	MEM_BG_MAP[layer][row * GbaTileColumns + column] = tile;
+}
+
+/**
+ * Clips a rectangle to the tile map.
+ * @return false if nothing is left
+ */
+static bool clipTileRect(int *column, int *row, int *width, int *height, int *srcX, int *srcY) noexcept {
+	*srcX = ox::max(0, -*column);
+	*srcY = ox::max(0, -*row);
+	*width = ox::min(*column + *width, GbaTileColumns) - (*column + *srcX);
+	*height = ox::min(*row + *height, GbaTileRows) - (*row + *srcY);
+	*column += *srcX;
+	*row += *srcY;
+	return *width > 0 && *height > 0;
+}
+
+// Map entries are halfwords and VRAM takes no byte writes. Tile indices
+// have to be widened on the way, which rules out DMA, so rows are written
+// two entries per word store instead.
+void blitTileRect(Context*, int layer, int column, int row, int width, int height,
+                  const uint8_t *tiles, int stride) noexcept {
+	int srcX, srcY;
+	if (!clipTileRect(&column, &row, &width, &height, &srcX, &srcY)) {
+		return;
+	}
+	for (auto y = 0; y < height; ++y) {
+		const auto src = tiles + (srcY + y) * stride + srcX;
+		auto dst = &MEM_BG_MAP[layer][(row + y) * GbaTileColumns + column];
+		auto x = 0;
+		if (column & 1) {
+			*dst++ = src[x++];
+		}
+		auto words = reinterpret_cast<volatile uint32_t*>(dst);
+		for (; x + 1 < width; x += 2) {
+			*words++ = static_cast<uint32_t>(src[x]) | static_cast<uint32_t>(src[x + 1]) << 16;
+		}
+		if (x < width) {
+			MEM_BG_MAP[layer][(row + y) * GbaTileColumns + column + x] = src[x];
+		}
 	}
 }
 
-void setTile(Context*, int layer, int column, int row, uint8_t tile) noexcept {
-	MEM_BG_MAP[layer][row * GbaTileColumns + column] = tile;
+void fillTileRect(Context*, int layer, int column, int row, int width, int height, uint8_t tile) noexcept {
+	int srcX, srcY;
+	if (!clipTileRect(&column, &row, &width, &height, &srcX, &srcY)) {
+		return;
+	}
+	const auto word = static_cast<uint32_t>(tile) | static_cast<uint32_t>(tile) << 16;
+	for (auto y = 0; y < height; ++y) {
+		auto dst = &MEM_BG_MAP[layer][(row + y) * GbaTileColumns + column];
+		auto x = 0;
+		if (column & 1) {
+			*dst++ = tile;
+			++x;
+		}
+		auto words = reinterpret_cast<volatile uint32_t*>(dst);
+		for (; x + 1 < width; x += 2) {
+			*words++ = word;
+		}
+		if (x < width) {
+			MEM_BG_MAP[layer][(row + y) * GbaTileColumns + column + x] = tile;
+		}
+	}
 }
 
 // Do NOT use Context in the GBA version of this function.
@@ -237,6 +376,30 @@ void clearTileLayer(Context*, int layer) noexcept {
 	memset(&MEM_BG_MAP[layer], 0, GbaTileRows * GbaTileColumns);
 }
 
+void setBgScroll(Context *ctx, int layer, int x, int y) noexcept {
+	auto t = g_bgTransforms[layer];
+	t.x = x * BgTransform::One;
+	t.y = y * BgTransform::One;
+	setBgTransform(ctx, layer, t);
+}
+
+void setBgTransform(Context*, int layer, const BgTransform &transform) noexcept {
+	// the matrix needs an affine background, only the translation applies to
+	// the text backgrounds used here
+	g_bgTransforms[layer] = transform;
+	const auto x = static_cast<uint32_t>(transform.x >> 8) & 0x1ff;
+	const auto y = static_cast<uint32_t>(transform.y >> 8) & 0x1ff;
+	bgOffset(layer) = (y << 16) | x;
+}
+
+BgTransform bgTransform(Context*, int layer) noexcept {
+	return g_bgTransforms[layer];
+}
+
+void setBgWrap(Context*, int, bool) noexcept {
+	// text backgrounds always wrap
+}
+
 [[maybe_unused]]
 void hideSprite(Context*, unsigned idx) noexcept {
 	oxAssert(g_spriteUpdates < config::GbaSpriteBufferLen, "Sprite update buffer overflow");
@@ -14,7 +14,7 @@
 
 namespace nostalgia::core {
 
-ox::Result<char*> loadRom(const char*) noexcept {
+ox::Result<char*> loadRom(const char*, std::size_t *size, RomAccess) noexcept {
 	// put the header in the wrong order to prevent mistaking this code for the
 	// media section
 	constexpr auto headerP2 = "_HEADER_________";
@@ -23,10 +23,16 @@ ox::Result<char*> loadRom(const char*) noexcept {
 	constexpr auto headerP2Len = 16;
 	constexpr auto headerLen = headerP1Len + headerP2Len + 1;
 
-	for (auto current = MEM_ROM; current < reinterpret_cast<char*>(0x0a000000); current += headerLen) {
+	// the cartridge ROM ends 32 MB after it starts
+	const auto romEnd = reinterpret_cast<char*>(0x0a000000);
+	for (auto current = MEM_ROM; current < romEnd; current += headerLen) {
 		if (ox_memcmp(current, headerP1, headerP1Len) == 0 &&
 		    ox_memcmp(current + headerP1Len, headerP2, headerP2Len) == 0) {
-			return current + headerLen;
+			const auto rom = current + headerLen;
+			if (size) {
+				*size = static_cast<std::size_t>(romEnd - rom);
+			}
+			return rom;
 		}
 	}
 	return OxError(1);
@@ -141,6 +141,26 @@ char charMap[128] = {
 	0,  // ~
 };
 
+// Do NOT use Context in this function, the GBA console writes through it
+// before there is one.
+void puts(Context *ctx, int column, int row, const char *str) noexcept {
+	// converted to tiles a chunk at a time, so long strings need no allocation
+	constexpr auto ChunkLen = 32;
+	uint8_t tiles[ChunkLen];
+	for (auto i = 0; str[i];) {
+		auto len = 0;
+		for (; str[i + len] && len < ChunkLen; ++len) {
+			tiles[len] = static_cast<uint8_t>(charMap[static_cast<uint8_t>(str[i + len])]);
+		}
+		setTiles(ctx, 0, column + i, row, tiles, len);
+		i += len;
+	}
+}
+
+void setTiles(Context *ctx, int layer, int column, int row, const uint8_t *tiles, int count) noexcept {
+	blitTileRect(ctx, layer, column, row, count, 1, tiles, count);
+}
+
 void setSprite(Context *c, const Sprite &s) noexcept {
 	setSprite(c, s.idx, s.x, s.y, s.tileIdx, s.spriteShape, s.spriteSize, s.flipX);
 }
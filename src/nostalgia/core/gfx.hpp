@@ -23,6 +23,15 @@ enum class TileSheetSpace {
 	Sprite
 };
 
+enum class TileSheetLoadStatus {
+	Pending, // being read and decoded
+	Decoded, // decoded, waiting for a commit or the next frame to upload
+	Done,
+	Failed,
+};
+
+using TileSheetLoadId = uint64_t;
+
 struct NostalgiaPalette {
 	static constexpr auto TypeName = "net.drinkingtea.nostalgia.core.NostalgiaPalette";
 	static constexpr auto Fields = 1;
@@ -62,6 +71,36 @@ constexpr ox::Error model(T *io, NostalgiaGraphic *ng) noexcept {
 	return OxError(0);
 }
 
+/**
+ * Maps screen pixels to tile map pixels, like the BGxPA-PD and BGxX/Y
+ * registers of GBA modes 1 and 2: the map pixel shown at screen pixel
+ * (sx, sy) is (pa * sx + pb * sy + x, pc * sx + pd * sy + y).
+ */
+struct BgTransform {
+	static constexpr int16_t One = 1 << 8;
+	// 8.8 fixed point
+	int16_t pa = One;
+	int16_t pb = 0;
+	int16_t pc = 0;
+	int16_t pd = One;
+	// map position of the screen's top left pixel, 24.8 fixed point
+	int32_t x = 0;
+	int32_t y = 0;
+
+	[[nodiscard]]
+	constexpr bool identityMatrix() const noexcept {
+		return pa == One && pb == 0 && pc == 0 && pd == One;
+	}
+
+	constexpr bool operator==(const BgTransform &o) const noexcept {
+		return pa == o.pa && pb == o.pb && pc == o.pc && pd == o.pd && x == o.x && y == o.y;
+	}
+
+	constexpr bool operator!=(const BgTransform &o) const noexcept {
+		return !operator==(o);
+	}
+};
+
 struct Sprite {
 	unsigned idx = 0;
 	unsigned x = 0;
@@ -101,17 +140,98 @@ ox::Error initConsole(Context *ctx) noexcept;
  */
 ox::Error loadBgTileSheet(Context *ctx, int section, const ox::FileAddress &tilesheet, const ox::FileAddress &palette = nullptr) noexcept;
 
+/**
+ * Starts loading a background tile sheet without blocking. The tile sheet
+ * is read and decoded off of the render thread, and is uploaded to the given
+ * section at the start of the first frame after it is decoded.
+ * @param commit if false, the tile sheet is decoded but not uploaded until
+ *               commitTileSheetLoad is called, allowing for prefetching
+ * @return ID to query the status of the load with
+ */
+ox::Result<TileSheetLoadId> loadBgTileSheetAsync(Context *ctx,
+                                                 int section,
+                                                 const ox::FileAddress &tilesheet,
+                                                 const ox::FileAddress &palette = nullptr,
+                                                 bool commit = true) noexcept;
+
+[[nodiscard]]
+TileSheetLoadStatus tileSheetLoadStatus(Context *ctx, TileSheetLoadId id) noexcept;
+
+/**
+ * @return the error of a failed load, or 0 if the load has not failed.
+ *         A failed load's error is only returned once, after which the load
+ *         is forgotten and its status is Done.
+ */
+ox::Error tileSheetLoadError(Context *ctx, TileSheetLoadId id) noexcept;
+
+/**
+ * Uploads a load started with commit set to false once it is decoded.
+ */
+ox::Error commitTileSheetLoad(Context *ctx, TileSheetLoadId id) noexcept;
+
 ox::Error loadSpriteTileSheet(Context *ctx,
                               int section,
                               const ox::FileAddress &tilesheetAddr,
                               const ox::FileAddress &paletteAddr) noexcept;
 
+/**
+ * Loads a palette into the given section without reloading its tile sheet,
+ * allowing for cheap palette swaps, animation, and fades.
+ */
+ox::Error loadBgPalette(Context *ctx, int section, const ox::FileAddress &paletteAddr) noexcept;
+
+ox::Error loadSpritePalette(Context *ctx, int section, const ox::FileAddress &paletteAddr) noexcept;
+
 void puts(Context *ctx, int column, int row, const char *str) noexcept;
 
 void setTile(Context *ctx, int layer, int column, int row, uint8_t tile) noexcept;
 
+/**
+ * Sets count tiles of a row, starting at column.
+ */
+void setTiles(Context *ctx, int layer, int column, int row, const uint8_t *tiles, int count) noexcept;
+
+/**
+ * Copies a width x height rectangle of tiles to the layer, with its top left
+ * at (column, row). Cells that fall outside the layer's map are skipped.
+ * @param tiles source tile indices, row by row
+ * @param stride distance between the starts of the source rows
+ */
+void blitTileRect(Context *ctx, int layer, int column, int row, int width, int height,
+                  const uint8_t *tiles, int stride) noexcept;
+
+/**
+ * Sets every tile of a width x height rectangle to the given tile.
+ * Cells that fall outside the layer's map are skipped.
+ */
+void fillTileRect(Context *ctx, int layer, int column, int row, int width, int height, uint8_t tile) noexcept;
+
 void clearTileLayer(Context *ctx, int layer) noexcept;
 
+/**
+ * Scrolls the layer so that map pixel (x, y) is at the top left of the
+ * screen, keeping the layer's matrix. Unlike rewriting the tile map, this
+ * costs no tile map upload.
+ */
+void setBgScroll(Context *ctx, int layer, int x, int y) noexcept;
+
+/**
+ * Sets the layer's scroll and its rotation and scaling matrix.
+ * The GBA only applies the translation, as its tile maps are in the text
+ * background format, which the hardware can't transform.
+ */
+void setBgTransform(Context *ctx, int layer, const BgTransform &transform) noexcept;
+
+[[nodiscard]]
+BgTransform bgTransform(Context *ctx, int layer) noexcept;
+
+/**
+ * With wrapping on, the layer's tile map repeats in every direction,
+ * otherwise the layers below show outside of it. Off by default. GBA
+ * backgrounds always wrap.
+ */
+void setBgWrap(Context *ctx, int layer, bool wrap) noexcept;
+
 void hideSprite(Context *ctx, unsigned) noexcept;
 
 void setSprite(Context *ctx, unsigned idx, unsigned x, unsigned y, unsigned tileIdx, unsigned spriteShape = 0, unsigned spriteSize = 0, unsigned flipX = 0) noexcept;
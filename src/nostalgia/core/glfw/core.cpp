@@ -6,17 +6,59 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/.
  */
 
+#include <thread>
+
 #include <GLFW/glfw3.h>
+#include <imgui_impl_glfw.h>
+
+#include <ox/std/math.hpp>
 
-#include <nostalgia/core/config.hpp>
 #include <nostalgia/core/gfx.hpp>
 #include <nostalgia/core/input.hpp>
+#include <nostalgia/core/userland/gfx.hpp>
 
 #include "core.hpp"
 
 namespace nostalgia::core {
 
-void draw(Context *ctx) noexcept;
+static uint64_t elapsedUs(std::chrono::steady_clock::time_point since) noexcept {
+	using namespace std::chrono;
+	return static_cast<uint64_t>(duration_cast<microseconds>(steady_clock::now() - since).count());
+}
+
+static uint64_t ticksUs(GlfwImplData *id) noexcept {
+	return elapsedUs(id->startTime);
+}
+
+/**
+ * @return the gamepad button the keyboard key maps to, or 0
+ */
+static uint16_t toButton(int key) noexcept {
+	switch (key) {
+		case GLFW_KEY_X:
+			return GamePad_A;
+		case GLFW_KEY_Z:
+			return GamePad_B;
+		case GLFW_KEY_BACKSPACE:
+			return GamePad_Select;
+		case GLFW_KEY_ENTER:
+			return GamePad_Start;
+		case GLFW_KEY_RIGHT:
+			return GamePad_Right;
+		case GLFW_KEY_LEFT:
+			return GamePad_Left;
+		case GLFW_KEY_UP:
+			return GamePad_Up;
+		case GLFW_KEY_DOWN:
+			return GamePad_Down;
+		case GLFW_KEY_S:
+			return GamePad_R;
+		case GLFW_KEY_A:
+			return GamePad_L;
+		default:
+			return 0;
+	}
+}
 
 static void handleKeyPress(Context *ctx, int key) {
 	const auto id = ctx->windowerData<GlfwImplData>();
@@ -25,6 +67,9 @@ static void handleKeyPress(Context *ctx, int key) {
 		case GLFW_KEY_Q:
 			id->running = false;
 			break;
+		case GLFW_KEY_F3:
+			renderer::setFrameStatsOverlay(ctx, !renderer::frameStatsOverlay(ctx));
+			break;
 		default:
 			break;
 	}
@@ -32,44 +77,295 @@ static void handleKeyPress(Context *ctx, int key) {
 
 static void handleGlfwKeyEvent(GLFWwindow *window, int key, int, int action, int) {
 	const auto ctx = static_cast<Context*>(glfwGetWindowUserPointer(window));
+	const auto id = ctx->windowerData<GlfwImplData>();
 	if (action == GLFW_PRESS) {
 		handleKeyPress(ctx, key);
 	}
+	const auto button = toButton(key);
+	// repeats carry no new information for a button snapshot
+	if (button && action != GLFW_REPEAT) {
+		if (!id->inputQueue.push({ticksUs(id), button, action == GLFW_PRESS})) {
+			oxTrace("nostalgia::core::glfw::input", "Input queue full, event dropped");
+		}
+	}
+}
+
+/**
+ * Applies a swap interval left by applyFramePacing. To be called on the
+ * thread that has the GL context current, with renderMtx held if the render
+ * thread runs.
+ */
+static void applySwapInterval(GlfwImplData *id) noexcept {
+	if (id->swapIntervalChanged) {
+		glfwSwapInterval(id->swapInterval);
+		id->swapIntervalChanged = false;
+	}
+}
+
+/**
+ * Sets the swap interval for the pacing's vsync mode, and picks up the
+ * refresh rate of the monitor.
+ */
+static void applyFramePacing(GlfwImplData *id) noexcept {
+	auto interval = static_cast<int>(id->pacing.vsync);
+	if (interval < 0 && !id->adaptiveVsync) {
+		oxTrace("nostalgia::core::glfw", "Adaptive vsync not supported, falling back on vsync");
+		interval = 1;
+	}
+	{
+		std::lock_guard lk(id->renderMtx);
+		id->swapInterval = interval;
+		id->swapIntervalChanged = true;
+		if (!id->renderThread.joinable()) {
+			applySwapInterval(id);
+		}
+	}
+	auto monitor = glfwGetWindowMonitor(id->window);
+	if (!monitor) {
+		monitor = glfwGetPrimaryMonitor();
+	}
+	const auto mode = monitor ? glfwGetVideoMode(monitor) : nullptr;
+	id->refreshUs = mode && mode->refreshRate > 0 ? 1000000 / static_cast<uint64_t>(mode->refreshRate) : 0;
+	id->nextPresentUs = 0;
+	id->nextFrameUs = 0;
 }
 
 ox::Error init(Context *ctx) noexcept {
 	const auto id = new GlfwImplData;
 	ctx->setWindowerData(id);
-	using namespace std::chrono;
-	id->startTime = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+	id->startTime = std::chrono::steady_clock::now();
 	glfwInit();
 	oxReturnError(initGfx(ctx));
+	// extensions can only be queried with the context current
+	id->adaptiveVsync = glfwExtensionSupported("WGL_EXT_swap_control_tear")
+	                    || glfwExtensionSupported("GLX_EXT_swap_control_tear");
+	applyFramePacing(id);
 	glfwSetKeyCallback(id->window, handleGlfwKeyEvent);
 	return OxError(0);
 }
 
+/**
+ * @return frame time the target frame rate asks for, 0 if none is set
+ */
+static uint64_t targetFrameUs(const GlfwImplData *id) noexcept {
+	return id->pacing.targetFps ? 1000000 / id->pacing.targetFps : 0;
+}
+
+/**
+ * @return time between presents, 0 if frames are not paced
+ */
+static uint64_t presentPeriodUs(const GlfwImplData *id) noexcept {
+	if (const auto target = targetFrameUs(id)) {
+		return target;
+	}
+	return id->pacing.vsync != VsyncMode::Off ? id->refreshUs : 0;
+}
+
+/**
+ * @return how long before a frame is due to start working on it in low
+ *         latency mode, 0 otherwise
+ */
+static uint64_t lowLatencyLeadUs(const GlfwImplData *id, uint64_t periodUs) noexcept {
+	// covers the wake up jitter left after sleepUntil
+	constexpr uint64_t MarginUs = 1000;
+	if (!id->pacing.lowLatency) {
+		return 0;
+	}
+	return ox::min(id->frameWorkUs + MarginUs, periodUs);
+}
+
+/**
+ * Main thread half of a frame, picks up the window state drawing needs and
+ * publishes the renderer state set since the last frame.
+ */
+static void publishFrame(Context *ctx, GlfwImplData *id) noexcept {
+	glfwGetFramebufferSize(id->window, &id->fbWidth, &id->fbHeight);
+	ImGui_ImplGlfw_NewFrame();
+	renderer::publishFrame(ctx);
+}
+
+/**
+ * Draws and presents the published frame, on the render thread if it runs.
+ */
+static void drawFrame(Context *ctx, GlfwImplData *id, const FrameTimes &frame) noexcept {
+	renderer::drawPublished(ctx);
+	const auto swapStartUs = ticksUs(id);
+	glfwSwapBuffers(id->window);
+	const auto presentUs = ticksUs(id);
+	const auto latencyUs = frame.inputUs != InputTracker::NoEvent ? presentUs - frame.inputUs : 0;
+	renderer::recordFrameTimes(ctx, frame.eventUs, presentUs - swapStartUs, latencyUs);
+	// rises at once and decays slowly, so a slow frame moves the start of
+	// the following ones earlier right away
+	const auto workUs = swapStartUs - frame.startUs;
+	const auto prevWorkUs = id->frameWorkUs.load();
+	if (workUs > prevWorkUs) {
+		id->frameWorkUs = workUs;
+	} else {
+		id->frameWorkUs = prevWorkUs - (prevWorkUs - workUs) / 16;
+	}
+}
+
+/**
+ * Waits for the render thread to finish the frame it was handed, if any.
+ */
+static std::unique_lock<std::mutex> waitForRenderThread(GlfwImplData *id) noexcept {
+	std::unique_lock lk(id->renderMtx);
+	id->renderCond.wait(lk, [id] { return !id->framePending; });
+	return lk;
+}
+
+/**
+ * Publishes the frame and draws it, or hands it to the render thread. With
+ * the render thread this only waits for the previous frame to be drawn.
+ */
+static void presentFrame(Context *ctx, GlfwImplData *id, uint64_t frameStartUs, uint64_t eventUs) noexcept {
+	const FrameTimes frame{frameStartUs, eventUs, id->input.takeOldestEventUs()};
+	if (!id->renderThread.joinable()) {
+		publishFrame(ctx, id);
+		drawFrame(ctx, id, frame);
+		return;
+	}
+	auto lk = waitForRenderThread(id);
+	publishFrame(ctx, id);
+	id->pendingFrame = frame;
+	id->framePending = true;
+	id->renderCond.notify_all();
+}
+
+static void runRenderThread(Context *ctx, GlfwImplData *id) noexcept {
+	glfwMakeContextCurrent(id->window);
+	std::unique_lock lk(id->renderMtx);
+	id->swapIntervalChanged = true;
+	while (true) {
+		id->renderCond.wait(lk, [id] { return id->framePending || !id->renderRunning; });
+		// a frame handed over before stopping still gets drawn
+		if (!id->framePending) {
+			break;
+		}
+		applySwapInterval(id);
+		const auto frame = id->pendingFrame;
+		lk.unlock();
+		drawFrame(ctx, id, frame);
+		lk.lock();
+		id->framePending = false;
+		id->renderCond.notify_all();
+	}
+	glfwMakeContextCurrent(nullptr);
+}
+
+static void stopRenderThread(GlfwImplData *id) noexcept {
+	if (!id->renderThread.joinable()) {
+		return;
+	}
+	{
+		std::lock_guard lk(id->renderMtx);
+		id->renderRunning = false;
+		id->renderCond.notify_all();
+	}
+	id->renderThread.join();
+	glfwMakeContextCurrent(id->window);
+}
+
+/**
+ * Waits for events until deadlineUs. The OS is only trusted to wake up within
+ * SleepSlackUs of the requested time, so the remainder is spent yielding.
+ */
+static void sleepUntil(GlfwImplData *id, uint64_t deadlineUs) noexcept {
+	constexpr uint64_t SleepSlackUs = 1500;
+	auto now = ticksUs(id);
+	while (id->running && now + SleepSlackUs < deadlineUs) {
+		glfwWaitEventsTimeout(static_cast<double>(deadlineUs - now - SleepSlackUs) / 1000000.0);
+		now = ticksUs(id);
+	}
+	while (id->running && now < deadlineUs) {
+		std::this_thread::yield();
+		now = ticksUs(id);
+	}
+}
+
+static void runEventDrivenFrame(Context *ctx, GlfwImplData *id) noexcept {
+	const auto periodUs = presentPeriodUs(id);
+	if (periodUs && id->nextPresentUs) {
+		// frames start a period before they are due, or just in time to make
+		// it in low latency mode
+		const auto leadUs = id->pacing.lowLatency ? lowLatencyLeadUs(id, periodUs) : periodUs;
+		sleepUntil(id, id->nextPresentUs - ox::min(leadUs, id->nextPresentUs));
+	}
+	const auto frameStartUs = ticksUs(id);
+	glfwPollEvents();
+	const auto ticks = ticksMs(ctx);
+	const auto eventStart = std::chrono::steady_clock::now();
+	if (id->wakeupTime <= ticks && id->eventHandler) {
+		id->input.tick(&id->inputQueue, ticksUs(id));
+		auto sleepTime = id->eventHandler(ctx);
+		if (sleepTime >= 0) {
+			id->wakeupTime = ticks + static_cast<unsigned>(sleepTime);
+		} else {
+			id->wakeupTime = ~uint64_t(0);
+		}
+	}
+	presentFrame(ctx, id, frameStartUs, elapsedUs(eventStart));
+	const auto presentUs = ticksUs(id);
+	if (!targetFrameUs(id)) {
+		// the swap blocks until the refresh with vsync, so follow it
+		id->nextPresentUs = periodUs ? presentUs + periodUs : 0;
+	} else {
+		id->nextPresentUs += periodUs;
+		if (id->nextPresentUs <= presentUs) {
+			// fell behind, start over from now instead of rushing to catch up
+			id->nextPresentUs = presentUs + periodUs;
+		}
+	}
+}
+
+static void runFixedStepFrame(Context *ctx, GlfwImplData *id) noexcept {
+	// low latency mode needs a frame time to schedule against
+	const auto frameCapUs = ox::max(id->frameCapUs,
+	                                id->pacing.lowLatency ? presentPeriodUs(id) : targetFrameUs(id));
+	const auto leadUs = lowLatencyLeadUs(id, frameCapUs);
+	glfwPollEvents();
+	const auto now = ticksUs(id);
+	const auto eventStart = std::chrono::steady_clock::now();
+	const auto ticks = id->fixedStep.advance(now);
+	// each tick sees the input events stamped up to its own end
+	const auto tickUs = id->fixedStep.tickUs();
+	const auto lastTickEndUs = id->fixedStep.nextTickUs() - tickUs;
+	for (auto i = 0u; i < ticks && id->eventHandler && id->wakeupTime != ~uint64_t(0); ++i) {
+		id->input.tick(&id->inputQueue, lastTickEndUs - (ticks - 1 - i) * tickUs);
+		if (id->eventHandler(ctx) < 0) {
+			id->wakeupTime = ~uint64_t(0);
+		}
+	}
+	const auto eventUs = elapsedUs(eventStart);
+	if (frameCapUs ? now + leadUs >= id->nextFrameUs : ticks > 0) {
+		presentFrame(ctx, id, now, eventUs);
+		id->nextFrameUs += frameCapUs;
+		if (id->nextFrameUs <= now) {
+			id->nextFrameUs = now + frameCapUs;
+		}
+	}
+	auto deadline = id->fixedStep.nextTickUs();
+	if (leadUs) {
+		// run the ticks due by then in one go right before the frame
+		deadline = id->nextFrameUs - ox::min(leadUs, id->nextFrameUs);
+	} else if (frameCapUs) {
+		deadline = ox::min(deadline, id->nextFrameUs);
+	}
+	sleepUntil(id, deadline);
+}
+
 ox::Error run(Context *ctx) noexcept {
 	const auto id = ctx->windowerData<GlfwImplData>();
 	id->running = true;
-	// try adaptive vsync
-	//if (SDL_GL_SetSwapInterval(config::SdlVsyncOption) < 0) {
-	//	oxTrace("nostalgia::core::sdl", "Could not enable adaptive vsync, falling back on vsync");
-	//	SDL_GL_SetSwapInterval(1); // fallback on normal vsync
-	//}
 	while (id->running && !glfwWindowShouldClose(id->window)) {
-		glfwPollEvents();
-		const auto ticks = ticksMs(ctx);
-		if (id->wakeupTime <= ticks && id->eventHandler) {
-			auto sleepTime = id->eventHandler(ctx);
-			if (sleepTime >= 0) {
-				id->wakeupTime = ticks + static_cast<unsigned>(sleepTime);
-			} else {
-				id->wakeupTime = ~uint64_t(0);
-			}
+		if (id->fixedStep.enabled()) {
+			runFixedStepFrame(ctx, id);
+		} else {
+			runEventDrivenFrame(ctx, id);
 		}
-		draw(ctx);
-		glfwSwapBuffers(id->window);
+		ctx->frameArena()->reset();
 	}
+	stopRenderThread(id);
 	return OxError(0);
 }
 
@@ -78,15 +374,63 @@ void setEventHandler(Context *ctx, event_handler h) noexcept {
 	id->eventHandler = h;
 }
 
+void setFixedStep(Context *ctx, uint64_t tickUs, int maxCatchUpTicks, uint64_t frameCapUs) noexcept {
+	const auto id = ctx->windowerData<GlfwImplData>();
+	id->fixedStep = FixedStep(tickUs, static_cast<uint64_t>(ox::max(maxCatchUpTicks, 1)));
+	id->frameCapUs = frameCapUs;
+	id->nextFrameUs = 0;
+}
+
+void setFramePacing(Context *ctx, const FramePacing &pacing) noexcept {
+	const auto id = ctx->windowerData<GlfwImplData>();
+	id->pacing = pacing;
+	applyFramePacing(id);
+}
+
+FramePacing framePacing(Context *ctx) noexcept {
+	return ctx->windowerData<GlfwImplData>()->pacing;
+}
+
+InputLatency inputLatency(Context *ctx) noexcept {
+	// the render thread records the stats as it presents
+	const auto lk = waitForRenderThread(ctx->windowerData<GlfwImplData>());
+	const auto l = renderer::frameStats(ctx).percentiles(&FrameSample::inputLatencyUs, true);
+	return {l.p50, l.p95, l.p99, l.samples};
+}
+
+ox::Error setRenderThread(Context *ctx, bool enabled) noexcept {
+	const auto id = ctx->windowerData<GlfwImplData>();
+	if (enabled == id->renderThread.joinable()) {
+		return OxError(0);
+	}
+	if (!enabled) {
+		stopRenderThread(id);
+		return OxError(0);
+	}
+	// the context can only be current on one thread at a time
+	glfwMakeContextCurrent(nullptr);
+	id->renderRunning = true;
+	id->renderThread = std::thread([ctx, id] { runRenderThread(ctx, id); });
+	return OxError(0);
+}
+
+bool renderThread(Context *ctx) noexcept {
+	return ctx->windowerData<GlfwImplData>()->renderThread.joinable();
+}
+
+float tickInterpolation(Context *ctx) noexcept {
+	const auto id = ctx->windowerData<GlfwImplData>();
+	return id->fixedStep.alpha();
+}
+
 uint64_t ticksMs(Context *ctx) noexcept {
-	using namespace std::chrono;
 	const auto id = ctx->windowerData<GlfwImplData>();
-	const auto now = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
-	return static_cast<uint64_t>(now - id->startTime);
+	return ticksUs(id) / 1000;
 }
 
-bool buttonDown(Key) noexcept {
-	return false;
+ButtonState buttonState(Context *ctx) noexcept {
+	const auto id = ctx->windowerData<GlfwImplData>();
+	return id->input.state();
 }
 
 }
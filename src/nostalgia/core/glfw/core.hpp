@@ -8,16 +8,67 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #include <nostalgia/core/core.hpp>
+#include <nostalgia/core/fixedstep.hpp>
+#include <nostalgia/core/inputqueue.hpp>
 
 namespace nostalgia::core {
 
+/**
+ * Times of a frame handed to drawFrame.
+ */
+struct FrameTimes {
+	uint64_t startUs = 0;
+	uint64_t eventUs = 0;
+	// oldest input event the frame's event handler calls saw, or InputTracker::NoEvent
+	uint64_t inputUs = 0;
+};
+
 struct GlfwImplData {
 	struct GLFWwindow *window = nullptr;
-	int64_t startTime = 0;
+	std::chrono::steady_clock::time_point startTime;
 	bool running = false;
 	event_handler eventHandler = nullptr;
 	uint64_t wakeupTime = 0;
+	// fixed step scheduling, see setFixedStep
+	FixedStep fixedStep;
+	uint64_t frameCapUs = 0;
+	uint64_t nextFrameUs = 0;
+	// see setFramePacing
+	FramePacing pacing;
+	// refresh period of the window's monitor, 0 if unknown
+	uint64_t refreshUs = 0;
+	// when the frame being worked on is due, for event driven scheduling
+	uint64_t nextPresentUs = 0;
+	// estimate of the time from polling input to starting the swap, written
+	// by the render thread while it runs
+	std::atomic<uint64_t> frameWorkUs = 0;
+	bool adaptiveVsync = false;
+	// framebuffer size as of the last published frame, as GLFW only allows
+	// querying it on the main thread
+	int fbWidth = 0;
+	int fbHeight = 0;
+	// see setRenderThread, the fields below are guarded by renderMtx
+	std::thread renderThread;
+	std::mutex renderMtx;
+	std::condition_variable renderCond;
+	bool renderRunning = false;
+	// a published frame is waiting for or being drawn by the render thread
+	bool framePending = false;
+	FrameTimes pendingFrame;
+	// swap interval for the pacing's vsync mode, left for the thread that has
+	// the GL context current to apply
+	int swapInterval = 1;
+	bool swapIntervalChanged = false;
+	// filled by the key callback, drained into input before each event handler call
+	InputQueue<> inputQueue;
+	InputTracker input;
 };
 
 }
@@ -8,6 +8,7 @@
 
 #include <GLFW/glfw3.h>
 #include <imgui.h>
+#include <imgui_impl_glfw.h>
 
 #include <nostalgia/core/userland/gfx.hpp>
 
@@ -25,7 +26,7 @@ ox::Error initGfx(Context *ctx) noexcept {
 	auto id = ctx->windowerData<GlfwImplData>();
 	glfwSetErrorCallback(handleGlfwError);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 	if constexpr(ox::defines::OS == ox::defines::OS::Darwin) {
 		glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
@@ -37,15 +38,23 @@ ox::Error initGfx(Context *ctx) noexcept {
 	}
 	glfwSetWindowUserPointer(id->window, ctx);
 	glfwMakeContextCurrent(id->window);
+	glfwGetFramebufferSize(id->window, &id->fbWidth, &id->fbHeight);
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
 	ImGui::GetIO().ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
-	oxReturnError(renderer::init(ctx));
+	// input callbacks are installed by core.cpp, ImGui only needs the window
+	// size and time from the GLFW backend
+	ImGui_ImplGlfw_InitForOpenGL(id->window, false);
+	oxReturnError(renderer::init(ctx, glfwGetProcAddress));
 	return OxError(0);
 }
 
 ox::Error shutdownGfx(Context *ctx) noexcept {
+	// the renderer's GL objects are deleted on this thread
+	oxReturnError(setRenderThread(ctx, false));
 	oxReturnError(renderer::shutdown(ctx));
+	ImGui_ImplGlfw_Shutdown();
+	ImGui::DestroyContext();
 	auto id = ctx->windowerData<GlfwImplData>();
 	glfwDestroyWindow(id->window);
 	ctx->setWindowerData(nullptr);
@@ -54,24 +63,16 @@ ox::Error shutdownGfx(Context *ctx) noexcept {
 }
 
 int getScreenWidth(Context *ctx) noexcept {
-	auto id = ctx->windowerData<GlfwImplData>();
-	int w = 0, h = 0;
-	glfwGetFramebufferSize(id->window, &w, &h);
-	return w;
+	return ctx->windowerData<GlfwImplData>()->fbWidth;
 }
 
 int getScreenHeight(Context *ctx) noexcept {
-	auto id = ctx->windowerData<GlfwImplData>();
-	int w = 0, h = 0;
-	glfwGetFramebufferSize(id->window, &w, &h);
-	return h;
+	return ctx->windowerData<GlfwImplData>()->fbHeight;
 }
 
 common::Size getScreenSize(Context *ctx) noexcept {
-	auto id = ctx->windowerData<GlfwImplData>();
-	int w = 0, h = 0;
-	glfwGetFramebufferSize(id->window, &w, &h);
-	return {w, h};
+	const auto id = ctx->windowerData<GlfwImplData>();
+	return {id->fbWidth, id->fbHeight};
 }
 
 }
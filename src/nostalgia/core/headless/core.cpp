@@ -0,0 +1,229 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+
+#include <ox/std/fmt.hpp>
+
+#include <nostalgia/core/gfx.hpp>
+#include <nostalgia/core/input.hpp>
+#include <nostalgia/core/userland/compositor.hpp>
+#include <nostalgia/core/userland/gfx.hpp>
+#include <nostalgia/core/userland/gfx_software.hpp>
+#include <nostalgia/core/userland/heapcounter.hpp>
+
+#include "core.hpp"
+
+namespace nostalgia::core {
+
+void draw(Context *ctx) noexcept;
+
+static uint64_t envUint(const char *name, uint64_t fallback) noexcept {
+	const auto val = std::getenv(name);
+	return val ? std::strtoull(val, nullptr, 10) : fallback;
+}
+
+static headless::Options optionsFromEnv() noexcept {
+	headless::Options opts;
+	opts.frames = envUint("NOSTALGIA_HEADLESS_FRAMES", opts.frames);
+	opts.frameUs = envUint("NOSTALGIA_HEADLESS_FRAME_US", opts.frameUs);
+	opts.printFrameHashes = envUint("NOSTALGIA_HEADLESS_HASHES", 0) != 0;
+	if (const auto dir = std::getenv("NOSTALGIA_HEADLESS_DUMP_DIR")) {
+		opts.dumpDir = dir;
+	}
+	return opts;
+}
+
+/**
+ * ox's formatting does not cover the full uint64_t range, so hashes are
+ * printed as hex.
+ */
+static ox::BString<17> hex(uint64_t v) noexcept {
+	constexpr auto digits = "0123456789abcdef";
+	char out[17] = {};
+	for (auto i = 0; i < 16; ++i) {
+		out[i] = digits[(v >> (60 - 4 * i)) & 0xf];
+	}
+	return out;
+}
+
+static ox::Error dumpFrame(const char *dir, uint64_t frame, const Color32 *pixels, int w, int h) noexcept {
+	const auto path = ox::sfmt("{}/frame_{}.ppm", dir, frame);
+	std::ofstream file(path.c_str(), std::ios::binary);
+	if (!file.good()) {
+		oxErrorf("Could not open frame dump file: {}", path);
+		return OxError(1, "Could not open frame dump file");
+	}
+	const auto header = ox::sfmt("P6\n{} {}\n255\n", w, h);
+	file.write(header.c_str(), static_cast<std::streamsize>(header.len()));
+	for (auto i = 0; i < w * h; ++i) {
+		const auto c = pixels[i];
+		const char rgb[] = {static_cast<char>(red32(c)), static_cast<char>(green32(c)), static_cast<char>(blue32(c))};
+		file.write(rgb, sizeof(rgb));
+	}
+	return OxError(0);
+}
+
+ox::Error init(Context *ctx) noexcept {
+	const auto id = new HeadlessImplData;
+	id->options = optionsFromEnv();
+	ctx->setWindowerData(id);
+	oxReturnError(initGfx(ctx));
+	return OxError(0);
+}
+
+static void runEventHandler(Context *ctx, HeadlessImplData *id) noexcept {
+	if (id->fixedStep.enabled()) {
+		const auto ticks = id->fixedStep.advance(id->timeUs);
+		const auto tickUs = id->fixedStep.tickUs();
+		const auto lastTickEndUs = id->fixedStep.nextTickUs() - tickUs;
+		for (auto i = 0u; i < ticks && id->eventHandler && id->wakeupTime != ~uint64_t(0); ++i) {
+			id->input.tick(&id->inputQueue, lastTickEndUs - (ticks - 1 - i) * tickUs);
+			if (id->eventHandler(ctx) < 0) {
+				id->wakeupTime = ~uint64_t(0);
+			}
+		}
+		return;
+	}
+	const auto ticks = ticksMs(ctx);
+	if (id->wakeupTime <= ticks && id->eventHandler) {
+		id->input.tick(&id->inputQueue, id->timeUs);
+		auto sleepTime = id->eventHandler(ctx);
+		if (sleepTime >= 0) {
+			id->wakeupTime = ticks + static_cast<unsigned>(sleepTime);
+		} else {
+			id->wakeupTime = ~uint64_t(0);
+		}
+	}
+}
+
+ox::Error run(Context *ctx) noexcept {
+	using namespace std::chrono;
+	const auto id = ctx->windowerData<HeadlessImplData>();
+	const auto &opts = id->options;
+	id->running = true;
+	const auto start = steady_clock::now();
+	uint64_t frame = 0;
+	for (; id->running && (!opts.frames || frame < opts.frames); ++frame) {
+		const auto eventStart = steady_clock::now();
+		runEventHandler(ctx, id);
+		const auto eventUs = static_cast<uint64_t>(duration_cast<microseconds>(steady_clock::now() - eventStart).count());
+		draw(ctx);
+		// the frame is presented at the end of its virtual frame time
+		const auto inputUs = id->input.takeOldestEventUs();
+		const auto latencyUs = inputUs != InputTracker::NoEvent ? id->timeUs + opts.frameUs - inputUs : 0;
+		renderer::recordFrameTimes(ctx, eventUs, 0, latencyUs);
+		const auto pixels = renderer::framebuffer(ctx);
+		id->frameHash = imageHash(pixels, opts.width, opts.height);
+		if (opts.printFrameHashes) {
+			oxOutf("frame {}: {}\n", frame, hex(id->frameHash));
+		}
+		if (opts.dumpDir[0]) {
+			oxReturnError(dumpFrame(opts.dumpDir, frame, pixels, opts.width, opts.height));
+		}
+		if (!opts.frames && id->wakeupTime == ~uint64_t(0)) {
+			id->running = false;
+		}
+		id->timeUs += opts.frameUs;
+		ctx->frameArena()->reset();
+	}
+	const auto elapsedUs = static_cast<uint64_t>(duration_cast<microseconds>(steady_clock::now() - start).count());
+	const auto &stats = renderer::frameStats(ctx);
+	const auto draw = stats.percentiles(&FrameSample::drawUs);
+	oxOutf("headless: {} frames in {} ms, {} frames/s, draw us p50/p95/p99: {}/{}/{}, last frame hash: {}\n",
+	       frame, elapsedUs / 1000, elapsedUs ? frame * 1000000 / elapsedUs : 0,
+	       draw.p50, draw.p95, draw.p99, hex(id->frameHash));
+	if (heapAllocationsCounted()) {
+		const auto heap = stats.percentiles(&FrameSample::heapAllocs);
+		oxOutf("headless: heap allocations per frame p50/p95/p99: {}/{}/{}, frame arena peak: {} bytes\n",
+		       heap.p50, heap.p95, heap.p99, ctx->frameArena()->peak());
+	}
+	if (const auto latency = inputLatency(ctx); latency.frames) {
+		oxOutf("headless: input latency us p50/p95/p99: {}/{}/{} over {} frames\n",
+		       latency.p50Us, latency.p95Us, latency.p99Us, latency.frames);
+	}
+	return OxError(0);
+}
+
+void setEventHandler(Context *ctx, event_handler h) noexcept {
+	const auto id = ctx->windowerData<HeadlessImplData>();
+	id->eventHandler = h;
+}
+
+void setFixedStep(Context *ctx, uint64_t tickUs, int maxCatchUpTicks, uint64_t) noexcept {
+	// frames are drawn once per virtual frame, so there is no frame cap to apply
+	const auto id = ctx->windowerData<HeadlessImplData>();
+	id->fixedStep = FixedStep(tickUs, static_cast<uint64_t>(maxCatchUpTicks > 1 ? maxCatchUpTicks : 1));
+}
+
+void setFramePacing(Context *ctx, const FramePacing &pacing) noexcept {
+	// there is no display to sync to, and the length of a virtual frame is
+	// left to Options::frameUs so that runs are reproducible
+	ctx->windowerData<HeadlessImplData>()->pacing = pacing;
+}
+
+FramePacing framePacing(Context *ctx) noexcept {
+	return ctx->windowerData<HeadlessImplData>()->pacing;
+}
+
+InputLatency inputLatency(Context *ctx) noexcept {
+	const auto l = renderer::frameStats(ctx).percentiles(&FrameSample::inputLatencyUs, true);
+	return {l.p50, l.p95, l.p99, l.samples};
+}
+
+ox::Error setRenderThread(Context*, bool enabled) noexcept {
+	// the software renderer draws the live state, so it can't be handed off
+	if (enabled) {
+		return OxError(1, "Render thread not supported by the headless windower");
+	}
+	return OxError(0);
+}
+
+bool renderThread(Context*) noexcept {
+	return false;
+}
+
+float tickInterpolation(Context *ctx) noexcept {
+	return ctx->windowerData<HeadlessImplData>()->fixedStep.alpha();
+}
+
+uint64_t ticksMs(Context *ctx) noexcept {
+	return ctx->windowerData<HeadlessImplData>()->timeUs / 1000;
+}
+
+ButtonState buttonState(Context *ctx) noexcept {
+	return ctx->windowerData<HeadlessImplData>()->input.state();
+}
+
+namespace headless {
+
+void setOptions(Context *ctx, const Options &opts) noexcept {
+	ctx->windowerData<HeadlessImplData>()->options = opts;
+}
+
+const Options &options(Context *ctx) noexcept {
+	return ctx->windowerData<HeadlessImplData>()->options;
+}
+
+uint64_t frameHash(Context *ctx) noexcept {
+	return ctx->windowerData<HeadlessImplData>()->frameHash;
+}
+
+ox::Error queueInput(Context *ctx, uint64_t timeUs, Key key, bool down) noexcept {
+	const auto id = ctx->windowerData<HeadlessImplData>();
+	if (!id->inputQueue.push({timeUs, static_cast<uint16_t>(key), down})) {
+		return OxError(1, "Headless input queue is full");
+	}
+	return OxError(0);
+}
+
+}
+
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <nostalgia/core/core.hpp>
+#include <nostalgia/core/fixedstep.hpp>
+#include <nostalgia/core/inputqueue.hpp>
+
+#include "headless.hpp"
+
+namespace nostalgia::core {
+
+struct HeadlessImplData {
+	headless::Options options;
+	// virtual clock, advanced by options.frameUs every frame
+	uint64_t timeUs = 0;
+	bool running = false;
+	event_handler eventHandler = nullptr;
+	uint64_t wakeupTime = 0;
+	FixedStep fixedStep;
+	// see setFramePacing, recorded only
+	FramePacing pacing;
+	uint64_t frameHash = 0;
+	// scripted input, see headless::queueInput
+	InputQueue<> inputQueue;
+	InputTracker input;
+};
+
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <nostalgia/core/userland/gfx.hpp>
+
+#include "core.hpp"
+
+namespace nostalgia::core {
+
+ox::Error initGfx(Context *ctx) noexcept {
+	return renderer::init(ctx);
+}
+
+ox::Error shutdownGfx(Context *ctx) noexcept {
+	oxReturnError(renderer::shutdown(ctx));
+	const auto id = ctx->windowerData<HeadlessImplData>();
+	ctx->setWindowerData(nullptr);
+	delete id;
+	return OxError(0);
+}
+
+int getScreenWidth(Context *ctx) noexcept {
+	return ctx->windowerData<HeadlessImplData>()->options.width;
+}
+
+int getScreenHeight(Context *ctx) noexcept {
+	return ctx->windowerData<HeadlessImplData>()->options.height;
+}
+
+common::Size getScreenSize(Context *ctx) noexcept {
+	const auto &opts = ctx->windowerData<HeadlessImplData>()->options;
+	return {opts.width, opts.height};
+}
+
+}
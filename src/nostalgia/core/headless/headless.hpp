@@ -0,0 +1,53 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <nostalgia/core/context.hpp>
+#include <nostalgia/core/input.hpp>
+
+namespace nostalgia::core::headless {
+
+struct Options {
+	// number of frames run executes before returning, 0 to run until the
+	// event handler stops
+	uint64_t frames = 600;
+	// virtual time advanced per frame, ticksMs and fixed step ticks follow it
+	uint64_t frameUs = 16667;
+	int width = 240;
+	int height = 160;
+	// print the hash of every frame to stdout
+	bool printFrameHashes = false;
+	// directory to write every frame to as a PPM image, empty to disable
+	const char *dumpDir = "";
+};
+
+/**
+ * Options are initialized from the environment by init:
+ * NOSTALGIA_HEADLESS_FRAMES, NOSTALGIA_HEADLESS_FRAME_US,
+ * NOSTALGIA_HEADLESS_HASHES (set to 1 to print frame hashes), and
+ * NOSTALGIA_HEADLESS_DUMP_DIR.
+ */
+void setOptions(Context *ctx, const Options &opts) noexcept;
+
+[[nodiscard]]
+const Options &options(Context *ctx) noexcept;
+
+/**
+ * @return imageHash of the last frame
+ */
+[[nodiscard]]
+uint64_t frameHash(Context *ctx) noexcept;
+
+/**
+ * Queues a button event for the tick containing timeUs on the virtual clock,
+ * for replaying input deterministically. Events must be queued in time order.
+ */
+ox::Error queueInput(Context *ctx, uint64_t timeUs, Key key, bool down) noexcept;
+
+}
@@ -8,6 +8,10 @@
 
 #pragma once
 
+#include <ox/std/types.hpp>
+
+#include "context.hpp"
+
 namespace nostalgia::core {
 
 enum Key {
@@ -24,7 +28,37 @@ enum Key {
 	GamePad_L      = 512,
 };
 
+/**
+ * Button state as of the current tick, each field a bitmask of Keys.
+ */
+struct ButtonState {
+	uint16_t held = 0;
+	// went down at some point during the tick, even if released again since
+	uint16_t pressed = 0;
+	// went up at some point during the tick, even if pressed again since
+	uint16_t released = 0;
+};
+
+/**
+ * @return the button state snapshot of the current tick, updated by run
+ *         before each call to the event handler
+ */
+[[nodiscard]]
+ButtonState buttonState(Context *ctx) noexcept;
+
 [[nodiscard]]
-bool buttonDown(Key) noexcept;
+inline bool buttonDown(Context *ctx, Key k) noexcept {
+	return buttonState(ctx).held & k;
+}
+
+[[nodiscard]]
+inline bool buttonPressed(Context *ctx, Key k) noexcept {
+	return buttonState(ctx).pressed & k;
+}
+
+[[nodiscard]]
+inline bool buttonReleased(Context *ctx, Key k) noexcept {
+	return buttonState(ctx).released & k;
+}
 
 }
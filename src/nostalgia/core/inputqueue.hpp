@@ -0,0 +1,150 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+
+#include <ox/std/types.hpp>
+
+#include "input.hpp"
+
+namespace nostalgia::core {
+
+struct InputEvent {
+	// time of the event on the platform's tick clock
+	uint64_t timeUs = 0;
+	// Key bitmask
+	uint16_t keys = 0;
+	bool down = false;
+};
+
+/**
+ * Lock-free single producer, single consumer ring of InputEvents. The
+ * platform's input callbacks push, and the run loop drains the events due
+ * before each tick into an InputTracker.
+ */
+template<std::size_t Capacity = 256>
+class InputQueue {
+
+	static_assert((Capacity & (Capacity - 1)) == 0, "InputQueue Capacity must be a power of 2");
+
+	private:
+		std::array<InputEvent, Capacity> m_events = {};
+		// monotonic counters, indices into m_events are taken mod Capacity
+		std::atomic<std::size_t> m_head = 0;
+		std::atomic<std::size_t> m_tail = 0;
+		std::atomic<uint64_t> m_dropped = 0;
+
+	public:
+		/**
+		 * Producer only.
+		 * @return false if the queue was full and the event was dropped
+		 */
+		bool push(const InputEvent &e) noexcept {
+			const auto head = m_head.load(std::memory_order_relaxed);
+			if (head - m_tail.load(std::memory_order_acquire) == Capacity) {
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			m_events[head % Capacity] = e;
+			m_head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		/**
+		 * Consumer only.
+		 * @return the oldest event, or nullptr if the queue is empty, valid
+		 *         until the next pop
+		 */
+		[[nodiscard]]
+		const InputEvent *peek() const noexcept {
+			const auto tail = m_tail.load(std::memory_order_relaxed);
+			if (tail == m_head.load(std::memory_order_acquire)) {
+				return nullptr;
+			}
+			return &m_events[tail % Capacity];
+		}
+
+		/**
+		 * Consumer only, removes the event returned by peek.
+		 */
+		void pop() noexcept {
+			m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+		/**
+		 * @return number of events dropped for lack of room
+		 */
+		[[nodiscard]]
+		uint64_t dropped() const noexcept {
+			return m_dropped.load(std::memory_order_relaxed);
+		}
+
+};
+
+/**
+ * Builds per tick ButtonState snapshots from a stream of InputEvents.
+ */
+class InputTracker {
+
+	public:
+		static constexpr auto NoEvent = ~uint64_t(0);
+
+	private:
+		ButtonState m_state;
+		uint64_t m_oldestEventUs = NoEvent;
+
+	public:
+		/**
+		 * Starts a new tick, applying all queued events up to tickEndUs. Events
+		 * stamped later stay queued for the following tick.
+		 */
+		template<std::size_t Capacity>
+		void tick(InputQueue<Capacity> *queue, uint64_t tickEndUs) noexcept {
+			m_state.pressed = 0;
+			m_state.released = 0;
+			for (auto e = queue->peek(); e && e->timeUs <= tickEndUs; e = queue->peek()) {
+				apply(*e);
+				queue->pop();
+			}
+		}
+
+		constexpr void apply(const InputEvent &e) noexcept {
+			if (e.timeUs < m_oldestEventUs) {
+				m_oldestEventUs = e.timeUs;
+			}
+			if (e.down) {
+				m_state.pressed = static_cast<uint16_t>(m_state.pressed | (e.keys & ~m_state.held));
+				m_state.held = static_cast<uint16_t>(m_state.held | e.keys);
+			} else {
+				m_state.released = static_cast<uint16_t>(m_state.released | (e.keys & m_state.held));
+				m_state.held = static_cast<uint16_t>(m_state.held & ~e.keys);
+			}
+		}
+
+		[[nodiscard]]
+		constexpr const ButtonState &state() const noexcept {
+			return m_state;
+		}
+
+		/**
+		 * For measuring input latency once the frame showing the effects of
+		 * the applied events is presented.
+		 * @return stamp of the oldest event applied since the last call, or NoEvent
+		 */
+		constexpr uint64_t takeOldestEventUs() noexcept {
+			const auto t = m_oldestEventUs;
+			m_oldestEventUs = NoEvent;
+			return t;
+		}
+
+};
+
+}
@@ -10,12 +10,19 @@
 
 namespace nostalgia::core {
 
+// number of resolved asset paths a ROM file system remembers
+static constexpr std::size_t RomPathCacheSize = 256;
+
 ox::Result<ox::UniquePtr<ox::FileSystem>> loadRomFs(const char *path) noexcept {
 	const auto lastDot = ox_lastIndexOf(path, '.');
 	const auto fsExt = lastDot != -1 ? path + lastDot : "";
 	if (ox_strcmp(fsExt, ".oxfs") == 0) {
-		oxRequire(rom, core::loadRom(path));
-		return {ox::make_unique<ox::FileSystem32>(rom, 32 * ox::units::MB, unloadRom)};
+		std::size_t romSize = 0;
+		// writes through the file system stay in memory instead of faulting
+		oxRequire(rom, core::loadRom(path, &romSize, RomAccess::CopyOnWrite));
+		auto fs = ox::make_unique<ox::FileSystem32>(rom, romSize, unloadRom);
+		fs->setPathCacheSize(RomPathCacheSize);
+		return {ox::move(fs)};
 	} else {
 #ifdef OX_HAS_PASSTHROUGHFS
 		return {ox::make_unique<ox::PassThroughFS>(path)};
@@ -12,9 +12,22 @@
 
 namespace nostalgia::core {
 
+enum class RomAccess {
+	// pages are shared with every other process reading the ROM
+	ReadOnly,
+	// writes go to private copies of the touched pages, the file is never changed
+	CopyOnWrite,
+};
+
 ox::Result<ox::UniquePtr<ox::FileSystem>> loadRomFs(const char *path) noexcept;
 
-ox::Result<char*> loadRom(const char *path = "") noexcept;
+/**
+ * Maps the ROM at path into memory where the platform can, and reads it into
+ * a heap buffer otherwise. Free the ROM with unloadRom.
+ * @param size set to the size of the ROM if not null
+ */
+ox::Result<char*> loadRom(const char *path = "", std::size_t *size = nullptr,
+                          RomAccess access = RomAccess::ReadOnly) noexcept;
 
 void unloadRom(char*) noexcept;
 
@@ -6,39 +6,34 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/.
  */
 
-#include "../gfx.hpp"
+#include <nostalgia/core/gfx.hpp>
+#include <nostalgia/core/userland/gfx.hpp>
 
 namespace nostalgia::core {
 
-ox::Error initGfx(Context*) noexcept {
-	return OxError(1);
-}
-
-ox::Error shutdownGfx(Context*) noexcept {
-	return OxError(1);
-}
+// Studio previews render with the software renderer at the GBA's resolution,
+// and read the result through renderer::framebuffer.
+constexpr auto ScreenWidth = 240;
+constexpr auto ScreenHeight = 160;
 
-ox::Error initConsole(Context*) noexcept {
-	return OxError(1);
+ox::Error initGfx(Context *ctx) noexcept {
+	return renderer::init(ctx);
 }
 
-ox::Error loadBgTileSheet(Context*,
-                          int,
-                          ox::FileAddress,
-                          ox::FileAddress) noexcept {
-	return OxError(1);
+ox::Error shutdownGfx(Context *ctx) noexcept {
+	return renderer::shutdown(ctx);
 }
 
-void puts(Context *ctx, int column, int row, const char *str) noexcept {
-	for (int i = 0; str[i]; i++) {
-		setTile(ctx, 0, column + i, row, static_cast<uint8_t>(charMap[static_cast<int>(str[i])]));
-	}
+int getScreenWidth(Context*) noexcept {
+	return ScreenWidth;
 }
 
-void setTile(Context*, int, int, int, uint8_t) noexcept {
+int getScreenHeight(Context*) noexcept {
+	return ScreenHeight;
 }
 
-void setSprite(Context*, unsigned, unsigned, unsigned, unsigned, unsigned, unsigned, unsigned) noexcept {
+common::Size getScreenSize(Context*) noexcept {
+	return {ScreenWidth, ScreenHeight};
 }
 
 }
@@ -12,6 +12,7 @@
 #include <nostalgia/core/core.hpp>
 #include <nostalgia/core/gfx.hpp>
 #include <nostalgia/core/input.hpp>
+#include <nostalgia/core/inputqueue.hpp>
 
 #include "core.hpp"
 
@@ -19,9 +20,49 @@ namespace nostalgia::core {
 
 static event_handler g_eventHandler = nullptr;
 static uint64_t g_wakeupTime;
+static InputQueue<> g_inputQueue;
+static InputTracker g_input;
 
 void draw(Context *ctx);
 
+/**
+ * @return the gamepad button the keyboard key maps to, or 0
+ */
+static uint16_t toButton(SDL_Keycode key) noexcept {
+	switch (key) {
+		case SDLK_x:
+			return GamePad_A;
+		case SDLK_z:
+			return GamePad_B;
+		case SDLK_BACKSPACE:
+			return GamePad_Select;
+		case SDLK_RETURN:
+			return GamePad_Start;
+		case SDLK_RIGHT:
+			return GamePad_Right;
+		case SDLK_LEFT:
+			return GamePad_Left;
+		case SDLK_UP:
+			return GamePad_Up;
+		case SDLK_DOWN:
+			return GamePad_Down;
+		case SDLK_s:
+			return GamePad_R;
+		case SDLK_a:
+			return GamePad_L;
+		default:
+			return 0;
+	}
+}
+
+static void queueKeyEvent(const SDL_KeyboardEvent &e) noexcept {
+	const auto button = toButton(e.keysym.sym);
+	if (button && !e.repeat) {
+		// SDL stamps events in ms on the SDL_GetTicks clock
+		g_inputQueue.push({static_cast<uint64_t>(e.timestamp) * 1000, button, e.type == SDL_KEYDOWN});
+	}
+}
+
 ox::Error init(Context *ctx) noexcept {
 	oxReturnError(initGfx(ctx));
 	return OxError(0);
@@ -42,6 +83,10 @@ ox::Error run(Context *ctx) noexcept {
 					if (event.key.keysym.sym == SDLK_q) {
 						running = false;
 					}
+					queueKeyEvent(event.key);
+					break;
+				case SDL_KEYUP:
+					queueKeyEvent(event.key);
 					break;
 				case SDL_QUIT: {
 					running = false;
@@ -51,6 +96,7 @@ ox::Error run(Context *ctx) noexcept {
 		}
 		const auto ticks = ticksMs();
 		if (g_wakeupTime <= ticks && g_eventHandler) {
+			g_input.tick(&g_inputQueue, ticks * 1000);
 			auto sleepTime = g_eventHandler(ctx);
 			if (sleepTime >= 0) {
 				g_wakeupTime = ticks + static_cast<unsigned>(sleepTime);
@@ -60,6 +106,7 @@ ox::Error run(Context *ctx) noexcept {
 		}
 		draw(ctx);
 		SDL_GL_SwapWindow(id->window);
+		ctx->frameArena()->reset();
 	}
 	return OxError(0);
 }
@@ -72,8 +119,8 @@ uint64_t ticksMs() noexcept {
 	return SDL_GetTicks();
 }
 
-bool buttonDown(Key) noexcept {
-	return false;
+ButtonState buttonState(Context*) noexcept {
+	return g_input.state();
 }
 
 }
@@ -25,6 +25,7 @@
 #include <QUndoCommand>
 
 #include <nostalgia/core/consts.hpp>
+#include <nostalgia/core/tilepixels.hpp>
 #include <nostalgia/common/point.hpp>
 
 #include "consts.hpp"
@@ -1005,23 +1006,19 @@ QImage TileSheetEditor::toQImage(NostalgiaGraphic *ng, NostalgiaPalette *npal) c
 	const auto w = ng->columns * TileWidth;
 	const auto h = ng->rows * TileHeight;
 	QImage dst(w, h, QImage::Format_RGB32);
-	auto setPixel = [&dst, npal, ng](std::size_t i, uint8_t p) {
-		const auto color = toColor32(npal->colors[p]) >> 8;
-		const auto pt = idxToPt(i, ng->columns);
-		dst.setPixel(pt.x, pt.y, color);
-	};
+	Color32 table[PaletteTableLength];
+	toColor32Table(npal->colors.data(), npal->colors.size(), table);
+	ox::Vector<Color32> pixels;
 	if (ng->bpp == 4) {
-		for (std::size_t i = 0; i < ng->pixels.size(); ++i) {
-			auto p1 = ng->pixels[i] & 0xF;
-			auto p2 = ng->pixels[i] >> 4;
-			setPixel(i * 2 + 0, p1);
-			setPixel(i * 2 + 1, p2);
-		}
+		pixels.resize(ng->pixels.size() * 2);
+		expand4bpp(ng->pixels.data(), ng->pixels.size(), table, pixels.data());
 	} else {
-		for (std::size_t i = 0; i < ng->pixels.size(); i++) {
-			const auto p = ng->pixels[i];
-			setPixel(i, p);
-		}
+		pixels.resize(ng->pixels.size());
+		expand8bpp(ng->pixels.data(), ng->pixels.size(), table, pixels.data());
+	}
+	for (std::size_t i = 0; i < pixels.size(); ++i) {
+		const auto pt = idxToPt(i, ng->columns);
+		dst.setPixel(pt.x, pt.y, pixels[i] >> 8);
 	}
 	return dst;
 }
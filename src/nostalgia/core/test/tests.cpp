@@ -0,0 +1,915 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+// make sure asserts are enabled for the test file
+#undef NDEBUG
+
+#include <atomic>
+#include <cmath>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <ox/std/std.hpp>
+
+#include <nostalgia/core/fixedstep.hpp>
+#include <nostalgia/core/framearena.hpp>
+#include <nostalgia/core/inputqueue.hpp>
+#include <nostalgia/core/media.hpp>
+#include <nostalgia/core/tilepixels.hpp>
+#include <nostalgia/core/userland/compositor.hpp>
+#include <nostalgia/core/userland/gfx.hpp>
+#include <nostalgia/core/userland/heapcounter.hpp>
+#include <nostalgia/core/userland/softrenderer.hpp>
+
+using namespace nostalgia::core;
+
+// odd length to exercise the scalar tails of the vector kernels
+constexpr std::size_t TestPixelBytes = 64 * 32 + 7;
+
+static ox::Vector<uint8_t> testPixels(std::size_t len) noexcept {
+	ox::Vector<uint8_t> out(len);
+	ox::Random rand;
+	for (std::size_t i = 0; i < len; ++i) {
+		out[i] = static_cast<uint8_t>(rand.gen());
+	}
+	return out;
+}
+
+static ox::Vector<Color16> testPalette() noexcept {
+	ox::Vector<Color16> out(PaletteTableLength);
+	for (std::size_t i = 0; i < out.size(); ++i) {
+		out[i] = static_cast<Color16>(i * 131);
+	}
+	return out;
+}
+
+// the per pixel loop loadBgTileSheet used before the shared kernels
+static void reference4bpp(const ox::Vector<uint8_t> &src, const ox::Vector<Color16> &pal, Color32 *dst) noexcept {
+	for (std::size_t i = 0; i < src.size(); ++i) {
+		dst[i * 2 + 0] = toColor32(pal[src[i] & 0xF]);
+		dst[i * 2 + 1] = toColor32(pal[src[i] >> 4]);
+	}
+}
+
+static void reference8bpp(const ox::Vector<uint8_t> &src, const ox::Vector<Color16> &pal, Color32 *dst) noexcept {
+	for (std::size_t i = 0; i < src.size(); ++i) {
+		dst[i] = toColor32(pal[src[i]]);
+	}
+}
+
+/**
+ * Scene description for SoftRenderer tests, rendered by a per pixel
+ * reference implementation.
+ */
+struct TestScene {
+	static constexpr auto SheetTiles = 64;
+	std::array<ox::Vector<uint8_t>, SoftRenderer::SectionCount> pixels;
+	std::array<ox::Vector<Color16>, SoftRenderer::SectionCount> palettes;
+	std::array<bool, SoftRenderer::BgCount> enabled = {};
+	std::array<BgTransform, SoftRenderer::BgCount> transforms = {};
+	std::array<bool, SoftRenderer::BgCount> wrap = {};
+	std::array<ox::Vector<uint8_t>, SoftRenderer::BgCount> tileMaps;
+	struct Sprite {
+		int x = 0, y = 0, w = 0, h = 0;
+		unsigned tileIdx = 0;
+		bool flipX = false;
+	};
+	// indexed by sprite index, w == 0 for hidden sprites
+	std::array<Sprite, SoftRenderer::SpriteCount> sprites = {};
+};
+
+static TestScene testScene(SoftRenderer *r) noexcept {
+	constexpr uint8_t dims[3][4][2] = {
+		{{1, 1}, {2, 2}, {4, 4}, {8, 8}},
+		{{2, 1}, {4, 1}, {4, 2}, {8, 4}},
+		{{1, 2}, {1, 4}, {2, 4}, {4, 8}},
+	};
+	TestScene scene;
+	ox::Random rand;
+	for (auto section = 0; section < SoftRenderer::SectionCount; ++section) {
+		auto &px = scene.pixels[static_cast<std::size_t>(section)];
+		px = testPixels(TestScene::SheetTiles * SoftRenderer::TileBytes);
+		// sprinkle in transparent pixels
+		for (auto &p : px) {
+			p = p % 3 == 0 ? 0 : p;
+		}
+		auto &pal = scene.palettes[static_cast<std::size_t>(section)];
+		pal = testPalette();
+		oxIgnoreError(r->loadTiles(section, px.data(), px.size()));
+		r->loadPalette(section, pal.data(), pal.size());
+	}
+	for (unsigned bg = 0; bg < SoftRenderer::BgCount; ++bg) {
+		auto &map = scene.tileMaps[bg];
+		map.resize(SoftRenderer::TileCount);
+		for (unsigned row = 0; row < 24; ++row) {
+			for (unsigned col = 0; col < 40; ++col) {
+				// include tiles past the end of the sheet
+				const auto tile = static_cast<uint8_t>(rand.gen() % (TestScene::SheetTiles + 8));
+				map[row * SoftRenderer::TileColumns + col] = tile;
+				r->setTile(bg, col, row, tile);
+			}
+		}
+	}
+	scene.enabled[0] = true;
+	scene.enabled[2] = true;
+	r->setBgEnabled(0, true);
+	r->setBgEnabled(2, true);
+	for (unsigned i = 0; i < SoftRenderer::SpriteCount; i += 3) {
+		const auto x = static_cast<unsigned>(rand.gen() % 512);
+		const auto y = static_cast<unsigned>(rand.gen() % 256);
+		const auto shape = static_cast<unsigned>(rand.gen() % 3);
+		const auto size = static_cast<unsigned>(rand.gen() % 4);
+		const auto tile = static_cast<unsigned>(rand.gen() % TestScene::SheetTiles);
+		const auto flip = static_cast<unsigned>(rand.gen() % 2);
+		r->setSprite(i, x, y, tile, shape, size, flip);
+		auto &s = scene.sprites[i];
+		s.x = static_cast<int>(x);
+		s.y = static_cast<int>(y);
+		if (s.x >= 512 - 64) {
+			s.x -= 512;
+		}
+		if (s.y >= 256 - 64) {
+			s.y -= 256;
+		}
+		s.w = dims[shape][size][0];
+		s.h = dims[shape][size][1];
+		s.tileIdx = tile;
+		s.flipX = flip;
+	}
+	return scene;
+}
+
+static Color32 referencePixel(const TestScene &scene, int x, int y, int height) noexcept {
+	const auto vx = ((2 * x + 1) * SoftRenderer::ScreenHeight) / (2 * height);
+	const auto vy = ((2 * y + 1) * SoftRenderer::ScreenHeight) / (2 * height);
+	auto color = SoftRenderer::ClearColor;
+	for (std::size_t bg = 0; bg < SoftRenderer::BgCount; ++bg) {
+		if (!scene.enabled[bg]) {
+			continue;
+		}
+		// map pixel under the center of the screen pixel
+		const auto &t = scene.transforms[bg];
+		const auto cx = static_cast<double>(vx) + 0.5;
+		const auto cy = static_cast<double>(vy) + 0.5;
+		auto mx = static_cast<int>(std::floor((t.pa * cx + t.pb * cy + t.x) / 256));
+		auto my = static_cast<int>(std::floor((t.pc * cx + t.pd * cy + t.y) / 256));
+		if (scene.wrap[bg]) {
+			mx = (mx % SoftRenderer::MapWidth + SoftRenderer::MapWidth) % SoftRenderer::MapWidth;
+			my = (my % SoftRenderer::MapHeight + SoftRenderer::MapHeight) % SoftRenderer::MapHeight;
+		} else if (mx < 0 || my < 0 || mx >= SoftRenderer::MapWidth || my >= SoftRenderer::MapHeight) {
+			continue;
+		}
+		const std::size_t tile = scene.tileMaps[bg][static_cast<std::size_t>((my / 8) * SoftRenderer::TileColumns + mx / 8)];
+		const std::size_t idx = tile < TestScene::SheetTiles ?
+			scene.pixels[bg][tile * 64 + static_cast<std::size_t>((my % 8) * 8 + mx % 8)] : 0;
+		color = toColor32(scene.palettes[bg][idx]);
+	}
+	for (auto i = SoftRenderer::SpriteCount - 1; i >= 0; --i) {
+		const auto &s = scene.sprites[static_cast<std::size_t>(i)];
+		auto px = vx - s.x;
+		const auto py = vy - s.y;
+		if (!s.w || px < 0 || py < 0 || px >= s.w * 8 || py >= s.h * 8) {
+			continue;
+		}
+		if (s.flipX) {
+			px = s.w * 8 - 1 - px;
+		}
+		const auto tile = s.tileIdx + static_cast<std::size_t>((py / 8) * s.w + px / 8);
+		if (tile >= TestScene::SheetTiles) {
+			continue;
+		}
+		const auto idx = scene.pixels[SoftRenderer::SpriteSection][tile * 64 + static_cast<std::size_t>((py % 8) * 8 + px % 8)];
+		if (idx) {
+			color = toColor32(scene.palettes[SoftRenderer::SpriteSection][idx]);
+		}
+	}
+	return color;
+}
+
+/**
+ * Renders the test scene, with the given layer transforms applied, and
+ * compares it to the reference.
+ * @param setup applies transforms to the renderer and scene
+ */
+static ox::Error checkSoftRender(int width, int height,
+                                 const std::function<void(SoftRenderer*, TestScene*)> &setup = {}) noexcept {
+	SoftRenderer r;
+	auto scene = testScene(&r);
+	if (setup) {
+		setup(&r, &scene);
+	}
+	ox::Vector<Color32> fb(static_cast<std::size_t>(width * height));
+	r.render(fb.data(), width, height);
+	for (auto y = 0; y < height; ++y) {
+		for (auto x = 0; x < width; ++x) {
+			if (fb[static_cast<std::size_t>(y * width + x)] != referencePixel(scene, x, y, height)) {
+				oxErrorf("SoftRenderer mismatch at {}, {}", x, y);
+				return OxError(1, "SoftRenderer output differs from reference");
+			}
+		}
+	}
+	return OxError(0);
+}
+
+static NostalgiaGraphic testSheet(int8_t bpp) noexcept {
+	NostalgiaGraphic sheet;
+	sheet.bpp = bpp;
+	sheet.pixels = testPixels(static_cast<std::size_t>(48 * 64 * bpp / 8));
+	sheet.pal.colors = testPalette();
+	return sheet;
+}
+
+static std::vector<CompositeScene> testCompositeScenes(const NostalgiaGraphic *sheet) noexcept {
+	ox::Random rand;
+	std::vector<CompositeScene> scenes;
+	for (auto i = 0; i < 6; ++i) {
+		CompositeScene scene;
+		scene.sheet = sheet;
+		scene.clearColor = 0xff000000 | static_cast<Color32>(i);
+		for (auto l = 0; l < i % 3 + 1; ++l) {
+			TileLayer layer;
+			layer.columns = 10 + i * 7 + l * 3;
+			layer.rows = 5 + i * 9 - l * 2;
+			layer.tiles.resize(static_cast<std::size_t>(layer.columns * layer.rows));
+			for (auto &t : layer.tiles) {
+				// include tiles past the end of the sheet
+				t = static_cast<uint16_t>(rand.gen() % 56);
+			}
+			scene.layers.push_back(ox::move(layer));
+		}
+		scenes.push_back(ox::move(scene));
+	}
+	return scenes;
+}
+
+/**
+ * Straightforward per pixel composite, to check Compositor against.
+ */
+static Color32 referenceComposite(const CompositeScene &scene, int x, int y) noexcept {
+	Color32 table[PaletteTableLength];
+	toColor32Table(scene.sheet->pal.colors.data(), scene.sheet->pal.colors.size(), table);
+	auto color = scene.clearColor;
+	for (const auto &layer : scene.layers) {
+		if (x / 8 >= layer.columns || y / 8 >= layer.rows) {
+			continue;
+		}
+		const std::size_t tile = layer.tiles[static_cast<std::size_t>((y / 8) * layer.columns + x / 8)];
+		const auto p = tile * 64 + static_cast<std::size_t>((y % 8) * 8 + x % 8);
+		if (p * static_cast<std::size_t>(scene.sheet->bpp) / 8 >= scene.sheet->pixels.size()) {
+			continue;
+		}
+		uint8_t idx = 0;
+		if (scene.sheet->bpp == 8) {
+			idx = scene.sheet->pixels[p];
+		} else {
+			idx = static_cast<uint8_t>((scene.sheet->pixels[p / 2] >> ((p % 2) * 4)) & 0xf);
+		}
+		if (idx) {
+			color = table[idx];
+		}
+	}
+	return color;
+}
+
+// a uniquely named file in the temp directory, removed when it goes out of scope
+class TempFile {
+	private:
+		std::string m_path;
+
+	public:
+		explicit TempFile(const char *suffix) noexcept {
+			static std::atomic<unsigned> counter = 0;
+			std::error_code ec;
+			const auto dir = std::filesystem::temp_directory_path(ec);
+			if (ec) {
+				return;
+			}
+			// the clock keeps concurrent test processes apart, the counter
+			// keeps files in this process apart
+			const auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+			for (auto tries = 0; tries < 100; ++tries) {
+				const auto name = "nostalgia-core-test-" + std::to_string(stamp) + "-"
+				                + std::to_string(counter++) + suffix;
+				auto path = (dir / name).string();
+				if (std::filesystem::exists(path, ec) || ec) {
+					continue;
+				}
+				if (std::ofstream(path, std::ios::binary)) {
+					m_path = ox::move(path);
+					return;
+				}
+			}
+		}
+
+		TempFile(const TempFile&) = delete;
+
+		~TempFile() noexcept {
+			if (!m_path.empty()) {
+				std::error_code ec;
+				std::filesystem::remove(m_path, ec);
+			}
+		}
+
+		TempFile &operator=(const TempFile&) = delete;
+
+		[[nodiscard]]
+		const std::string &path() const noexcept {
+			return m_path;
+		}
+
+};
+
+template<typename F>
+static double timeMs(F f) noexcept {
+	using namespace std::chrono;
+	const auto start = steady_clock::now();
+	f();
+	return duration<double, std::milli>(steady_clock::now() - start).count();
+}
+
+const std::map<std::string_view, std::function<ox::Error(std::string_view)>> tests = {
+	{
+		{
+			"TilePixels::unpack4bpp",
+			[](std::string_view) {
+				const auto src = testPixels(TestPixelBytes);
+				ox::Vector<uint8_t> dst(src.size() * 2);
+				unpack4bpp(src.data(), src.size(), dst.data());
+				for (std::size_t i = 0; i < src.size(); ++i) {
+					oxAssert(dst[i * 2 + 0] == (src[i] & 0xF), "Bad low nibble");
+					oxAssert(dst[i * 2 + 1] == (src[i] >> 4), "Bad high nibble");
+				}
+				return OxError(0);
+			}
+		},
+		{
+			"TilePixels::expand4bpp",
+			[](std::string_view) {
+				const auto src = testPixels(TestPixelBytes);
+				const auto pal = testPalette();
+				Color32 table[PaletteTableLength];
+				toColor32Table(pal.data(), pal.size(), table);
+				ox::Vector<Color32> expected(src.size() * 2);
+				ox::Vector<Color32> dst(src.size() * 2);
+				reference4bpp(src, pal, expected.data());
+				expand4bpp(src.data(), src.size(), table, dst.data());
+				oxAssert(dst == expected, "expand4bpp differs from toColor32");
+				return OxError(0);
+			}
+		},
+		{
+			"TilePixels::expand8bpp",
+			[](std::string_view) {
+				const auto src = testPixels(TestPixelBytes);
+				const auto pal = testPalette();
+				Color32 table[PaletteTableLength];
+				toColor32Table(pal.data(), pal.size(), table);
+				ox::Vector<Color32> expected(src.size());
+				ox::Vector<Color32> dst(src.size());
+				reference8bpp(src, pal, expected.data());
+				expand8bpp(src.data(), src.size(), table, dst.data());
+				oxAssert(dst == expected, "expand8bpp differs from toColor32");
+				return OxError(0);
+			}
+		},
+		{
+			"TilePixels::shortPalette",
+			[](std::string_view) {
+				const Color16 pal[] = {0x7fff, 0x001f};
+				Color32 table[PaletteTableLength];
+				toColor32Table(pal, 2, table);
+				oxAssert(table[0] == toColor32(pal[0]) && table[1] == toColor32(pal[1]), "Bad palette entry");
+				for (std::size_t i = 2; i < PaletteTableLength; ++i) {
+					oxAssert(table[i] == 0, "Palette table not zero filled");
+				}
+				return OxError(0);
+			}
+		},
+		{
+			"TilePixels::blend8bpp",
+			[](std::string_view) {
+				auto src = testPixels(TestPixelBytes);
+				for (std::size_t i = 0; i < src.size(); i += 3) {
+					src[i] = 0;
+				}
+				const auto pal = testPalette();
+				Color32 table[PaletteTableLength];
+				toColor32Table(pal.data(), pal.size(), table);
+				ox::Vector<Color32> dst(src.size());
+				for (std::size_t i = 0; i < dst.size(); ++i) {
+					dst[i] = static_cast<Color32>(i);
+				}
+				blend8bpp(src.data(), src.size(), table, dst.data());
+				for (std::size_t i = 0; i < src.size(); ++i) {
+					const auto expected = src[i] ? table[src[i]] : static_cast<Color32>(i);
+					oxAssert(dst[i] == expected, "blend8bpp wrote a bad pixel");
+				}
+				return OxError(0);
+			}
+		},
+		{
+			"SoftRenderer::render",
+			[](std::string_view) {
+				return checkSoftRender(240, 160);
+			}
+		},
+		{
+			"SoftRenderer::renderScaled",
+			[](std::string_view) {
+				oxReturnError(checkSoftRender(1200, 800));
+				// non-integer scale, with a different aspect ratio
+				return checkSoftRender(333, 217);
+			}
+		},
+		{
+			"SoftRenderer::scroll",
+			[](std::string_view) {
+				const auto scroll = [](SoftRenderer *r, TestScene *scene, unsigned bg, int x, int y, bool wrap) {
+					auto &t = scene->transforms[bg];
+					t.x = x * BgTransform::One;
+					t.y = y * BgTransform::One;
+					scene->wrap[bg] = wrap;
+					r->setBgTransform(bg, t);
+					r->setBgWrap(bg, wrap);
+				};
+				// the top layer scrolled partly off its map shows layer 0 below
+				oxReturnError(checkSoftRender(240, 160, [&](SoftRenderer *r, TestScene *s) {
+					scroll(r, s, 2, -37, 13, false);
+				}));
+				oxReturnError(checkSoftRender(240, 160, [&](SoftRenderer *r, TestScene *s) {
+					scroll(r, s, 2, 1000, -200, false);
+					scroll(r, s, 0, 5, 3, false);
+				}));
+				// wrapped in both directions, at a fractional scroll
+				oxReturnError(checkSoftRender(240, 160, [&](SoftRenderer *r, TestScene *s) {
+					scroll(r, s, 2, -61, 1017, true);
+					s->transforms[2].x += 100;
+					r->setBgTransform(2, s->transforms[2]);
+				}));
+				return checkSoftRender(333, 217, [&](SoftRenderer *r, TestScene *s) {
+					scroll(r, s, 2, 900, 1000, true);
+				});
+			}
+		},
+		{
+			"SoftRenderer::blitTiles",
+			[](std::string_view) {
+				return checkSoftRender(240, 160, [](SoftRenderer *r, TestScene *s) {
+					// a 7x5 block from a wider source, then a fill overlapping it
+					constexpr auto stride = 11;
+					uint8_t src[stride * 5];
+					for (std::size_t i = 0; i < sizeof(src); ++i) {
+						src[i] = static_cast<uint8_t>(i % (TestScene::SheetTiles + 4));
+					}
+					r->blitTiles(2, 3, 4, 7, 5, src, stride);
+					r->fillTiles(2, 8, 6, 12, 3, 5);
+					auto &map = s->tileMaps[2];
+					for (std::size_t y = 0; y < 5; ++y) {
+						for (std::size_t x = 0; x < 7; ++x) {
+							map[(4 + y) * SoftRenderer::TileColumns + 3 + x] = src[y * stride + x];
+						}
+					}
+					for (std::size_t y = 0; y < 3; ++y) {
+						for (std::size_t x = 0; x < 12; ++x) {
+							map[(6 + y) * SoftRenderer::TileColumns + 8 + x] = 5;
+						}
+					}
+				});
+			}
+		},
+		{
+			"TileRect::clip",
+			[](std::string_view) {
+				using renderer::TileRect;
+				TileRect inside{3, 4, 5, 6};
+				oxAssert(renderer::clipTileRect(&inside, 128, 128), "rect inside the map was dropped");
+				oxAssert(inside.column == 3 && inside.row == 4 && inside.width == 5 && inside.height == 6 &&
+				         inside.srcX == 0 && inside.srcY == 0, "rect inside the map was changed");
+				TileRect corner{-2, -3, 5, 6};
+				oxAssert(renderer::clipTileRect(&corner, 128, 128), "rect over the corner was dropped");
+				oxAssert(corner.column == 0 && corner.row == 0 && corner.width == 3 && corner.height == 3 &&
+				         corner.srcX == 2 && corner.srcY == 3, "rect over the top left corner clipped wrong");
+				TileRect edge{125, 126, 10, 10};
+				oxAssert(renderer::clipTileRect(&edge, 128, 128), "rect over the edge was dropped");
+				oxAssert(edge.width == 3 && edge.height == 2 && edge.srcX == 0, "rect over the bottom right edge clipped wrong");
+				TileRect outside{-10, 0, 10, 1};
+				oxAssert(!renderer::clipTileRect(&outside, 128, 128), "rect outside the map was kept");
+				TileRect empty{4, 4, 0, 3};
+				oxAssert(!renderer::clipTileRect(&empty, 128, 128), "empty rect was kept");
+				return OxError(0);
+			}
+		},
+		{
+			"SoftRenderer::affine",
+			[](std::string_view) {
+				// rotated by about 30 degrees and scaled, around a point off the map's origin
+				BgTransform t;
+				t.pa = 222;
+				t.pb = -128;
+				t.pc = 150;
+				t.pd = 260;
+				t.x = -20 * BgTransform::One;
+				t.y = 40 * BgTransform::One + 77;
+				oxReturnError(checkSoftRender(240, 160, [&](SoftRenderer *r, TestScene *s) {
+					s->transforms[2] = t;
+					r->setBgTransform(2, t);
+				}));
+				return checkSoftRender(240, 160, [&](SoftRenderer *r, TestScene *s) {
+					s->transforms[2] = t;
+					s->wrap[2] = true;
+					r->setBgTransform(2, t);
+					r->setBgWrap(2, true);
+				});
+			}
+		},
+		{
+			// not registered with CTest, run manually: NostalgiaCoreTest SoftRenderer::bench [frames]
+			"SoftRenderer::bench",
+			[](std::string_view arg) {
+				const auto frames = arg.empty() ? 2000 : std::stoi(std::string(arg));
+				SoftRenderer r;
+				const auto scene = testScene(&r);
+				ox::Vector<Color32> fb(240 * 160);
+				const auto ms = timeMs([&] {
+					for (auto i = 0; i < frames; ++i) {
+						r.render(fb.data(), 240, 160);
+					}
+				});
+				ox::Vector<Color32> ref(fb.size());
+				const auto refMs = timeMs([&] {
+					for (auto y = 0; y < 160; ++y) {
+						for (auto x = 0; x < 240; ++x) {
+							ref[static_cast<std::size_t>(y * 240 + x)] = referencePixel(scene, x, y, 160);
+						}
+					}
+				});
+				std::cout << frames << " frames at 240x160: " << ms / frames << " ms/frame, "
+				          << "per pixel reference: " << refMs << " ms/frame\n";
+				return OxError(0);
+			}
+		},
+		{
+			"ThreadPool::parallelFor",
+			[](std::string_view) {
+				for (const auto threads : {1, 2, 5}) {
+					ThreadPool pool(static_cast<std::size_t>(threads));
+					oxAssert(pool.threads() == static_cast<std::size_t>(threads), "wrong thread count");
+					constexpr std::size_t counts[] = {0, 1, 3, 1000};
+					for (const auto count : counts) {
+						std::vector<std::atomic<int>> runs(count);
+						pool.parallelFor(count, [&runs](std::size_t i) {
+							++runs[i];
+						});
+						for (const auto &r : runs) {
+							oxAssert(r == 1, "task not run exactly once");
+						}
+					}
+				}
+				return OxError(0);
+			}
+		},
+		{
+			"Compositor::composite",
+			[](std::string_view) {
+				ThreadPool pool(3);
+				Compositor compositor(&pool);
+				for (const int8_t bpp : {4, 8}) {
+					const auto sheet = testSheet(bpp);
+					for (const auto &scene : testCompositeScenes(&sheet)) {
+						oxRequire(img, compositor.composite(scene));
+						for (auto y = 0; y < img.height; ++y) {
+							for (auto x = 0; x < img.width; ++x) {
+								oxAssert(img.pixels[static_cast<std::size_t>(y * img.width + x)] == referenceComposite(scene, x, y),
+								         "Compositor output differs from reference");
+							}
+						}
+					}
+				}
+				return OxError(0);
+			}
+		},
+		{
+			"Compositor::deterministic",
+			[](std::string_view) {
+				const auto sheet = testSheet(4);
+				const auto scenes = testCompositeScenes(&sheet);
+				ox::Vector<uint64_t> expected;
+				for (const auto threads : {1, 2, 3, 8}) {
+					ThreadPool pool(static_cast<std::size_t>(threads));
+					Compositor compositor(&pool);
+					const auto images = compositor.compositeBatch(scenes, 2);
+					for (std::size_t i = 0; i < images.size(); ++i) {
+						oxReturnError(images[i].error);
+						const auto hash = imageHash(images[i].value);
+						if (expected.size() < images.size()) {
+							expected.emplace_back(hash);
+						}
+						oxAssert(hash == expected[i], "Compositor output depends on thread count");
+					}
+				}
+				return OxError(0);
+			}
+		},
+		{
+			"Compositor::downscale",
+			[](std::string_view) {
+				Image src;
+				src.width = 5;
+				src.height = 4;
+				src.pixels.resize(20);
+				for (std::size_t i = 0; i < src.pixels.size(); ++i) {
+					src.pixels[i] = 0x04030201u * static_cast<Color32>(2 * (i % 5) + 8 * (i / 5));
+				}
+				const auto dst = downscale(src, 2);
+				oxAssert(dst.width == 2 && dst.height == 2, "bad downscale dimensions");
+				// top left block holds 0, 2, 8, 10 times 0x04030201
+				oxAssert(dst.pixels[0] == 0x04030201u * 5, "bad downscale average");
+				// bottom right block holds 20, 22, 28, 30
+				oxAssert(dst.pixels[3] == 0x04030201u * 25, "bad downscale average");
+				return OxError(0);
+			}
+		},
+		{
+			"InputQueue::spsc",
+			[](std::string_view) {
+				constexpr uint64_t Events = 200000;
+				InputQueue<64> queue;
+				std::thread producer([&queue] {
+					for (uint64_t i = 0; i < Events;) {
+						if (queue.push({i, static_cast<uint16_t>(i), i % 2 == 0})) {
+							++i;
+						} else {
+							std::this_thread::yield();
+						}
+					}
+				});
+				uint64_t expected = 0;
+				while (expected < Events) {
+					const auto e = queue.peek();
+					if (!e) {
+						std::this_thread::yield();
+						continue;
+					}
+					oxAssert(e->timeUs == expected && e->keys == static_cast<uint16_t>(expected), "InputQueue event out of order");
+					queue.pop();
+					++expected;
+				}
+				producer.join();
+				oxAssert(queue.peek() == nullptr, "InputQueue not empty");
+				InputQueue<4> small;
+				for (auto i = 0; i < 5; ++i) {
+					small.push({});
+				}
+				oxAssert(small.dropped() == 1, "full InputQueue did not drop");
+				return OxError(0);
+			}
+		},
+		{
+			"InputTracker::tick",
+			[](std::string_view) {
+				InputQueue<> queue;
+				InputTracker input;
+				queue.push({100, GamePad_A, true});
+				// tapped within a single tick
+				queue.push({200, GamePad_B, true});
+				queue.push({300, GamePad_B, false});
+				// belongs to the next tick
+				queue.push({1100, GamePad_A, false});
+				input.tick(&queue, 1000);
+				auto s = input.state();
+				oxAssert(s.held == GamePad_A, "bad held buttons");
+				oxAssert(s.pressed == (GamePad_A | GamePad_B), "bad pressed buttons");
+				oxAssert(s.released == GamePad_B, "bad released buttons");
+				input.tick(&queue, 2000);
+				s = input.state();
+				oxAssert(s.held == 0 && s.pressed == 0 && s.released == GamePad_A, "bad second tick");
+				input.tick(&queue, 3000);
+				s = input.state();
+				oxAssert(s.held == 0 && s.pressed == 0 && s.released == 0, "edges not cleared");
+				return OxError(0);
+			}
+		},
+		{
+			"InputTracker::oldestEvent",
+			[](std::string_view) {
+				InputQueue<> queue;
+				InputTracker input;
+				queue.push({150, GamePad_A, true});
+				queue.push({400, GamePad_A, false});
+				queue.push({1200, GamePad_B, true});
+				input.tick(&queue, 500);
+				// a frame can show several ticks, the oldest event counts
+				input.tick(&queue, 1000);
+				oxAssert(input.takeOldestEventUs() == 150, "wrong oldest event");
+				oxAssert(input.takeOldestEventUs() == InputTracker::NoEvent, "oldest event not cleared");
+				input.tick(&queue, 1500);
+				oxAssert(input.takeOldestEventUs() == 1200, "wrong oldest event after take");
+				return OxError(0);
+			}
+		},
+		{
+			"FixedStep::advance",
+			[](std::string_view) {
+				FixedStep step(1000, 4);
+				oxAssert(step.advance(5000) == 0, "First advance should only start the clock");
+				oxAssert(step.advance(5999) == 0, "Tick ran early");
+				oxAssert(step.advance(6000) == 1, "Tick did not run on time");
+				oxAssert(step.advance(8500) == 2, "Wrong number of catch up ticks");
+				oxAssert(step.nextTickUs() == 9000, "Wrong next tick time");
+				oxAssert(step.alpha() == 0.5f, "Wrong interpolation alpha");
+				return OxError(0);
+			}
+		},
+		{
+			"FixedStep::catchUpLimit",
+			[](std::string_view) {
+				FixedStep step(1000, 4);
+				step.advance(0);
+				oxAssert(step.advance(10250) == 4, "Catch up limit not applied");
+				oxAssert(step.droppedTicks() == 6, "Wrong dropped tick count");
+				// the remainder of the last tick is kept
+				oxAssert(step.nextTickUs() == 11000, "Wrong next tick time");
+				oxAssert(step.advance(11000) == 1, "Tick did not run on time");
+				return OxError(0);
+			}
+		},
+		{
+			"FrameArena::alloc",
+			[](std::string_view) {
+				FrameArena arena(256);
+				const auto a = arena.alloc<uint8_t>(3);
+				const auto b = arena.alloc<uint64_t>(2);
+				oxAssert(a && b, "Allocation failed");
+				oxAssert(reinterpret_cast<std::size_t>(b) % alignof(uint64_t) == 0, "Misaligned allocation");
+				const auto mark = arena.mark();
+				{
+					ArenaScope scope(&arena);
+					const auto c = arena.alloc(100, 64);
+					oxAssert(reinterpret_cast<std::size_t>(c) % 64 == 0, "Misaligned allocation");
+					oxAssert(arena.used() > mark, "Allocation did not use the arena");
+				}
+				oxAssert(arena.used() == mark, "Scope did not rewind");
+				// too big for the arena, goes to the heap until reset
+				const auto big = arena.alloc<uint8_t>(1000);
+				ox_memset(big, 1, 1000);
+				oxAssert(arena.overflows() == 1, "Overflow not counted");
+				arena.reset();
+				oxAssert(arena.used() == 0, "Reset did not free");
+				oxAssert(arena.capacity() >= arena.peak(), "Arena did not grow to the frame's peak");
+				oxAssert(arena.alloc<uint8_t>(1000) != nullptr, "Allocation failed");
+				oxAssert(arena.overflows() == 1, "Grown arena overflowed");
+				return OxError(0);
+			}
+		},
+		{
+			"ArenaVector::growth",
+			[](std::string_view) {
+				FrameArena arena;
+				ArenaVector<int> v(&arena);
+				for (auto i = 0; i < 1000; ++i) {
+					v.push_back(i);
+				}
+				oxAssert(v.size() == 1000, "Wrong size");
+				for (auto i = 0; i < 1000; ++i) {
+					oxAssert(v[static_cast<std::size_t>(i)] == i, "Item lost in growth");
+				}
+				v.resize(10);
+				oxAssert(v.size() == 10 && v[9] == 9, "Bad resize");
+				ArenaVector<ox::String> strs(&arena, 3);
+				strs[2] = "frame";
+				auto moved = ox::move(strs);
+				oxAssert(strs.size() == 0 && moved.size() == 3 && moved[2] == "frame", "Bad move");
+				return OxError(0);
+			}
+		},
+		{
+			"FrameArena::steadyState",
+			[](std::string_view) {
+				FrameArena arena(1024);
+				const auto frame = [&arena] {
+					ArenaVector<uint32_t> a(&arena);
+					for (auto i = 0u; i < 4096; ++i) {
+						a.push_back(i);
+					}
+					{
+						ArenaScope scope(&arena);
+						ArenaVector<uint8_t> tmp(&arena, 8192);
+						tmp[8191] = 1;
+					}
+					arena.reset();
+				};
+				// the warm up frame overflows and grows the arena
+				frame();
+				const auto overflows = arena.overflows();
+				const auto allocs = heapAllocations();
+				for (auto i = 0; i < 100; ++i) {
+					frame();
+				}
+				oxAssert(arena.overflows() == overflows, "Steady state frame overflowed");
+				if (heapAllocationsCounted()) {
+					oxAssert(heapAllocations() == allocs, "Steady state frame allocated from the heap");
+				} else {
+					std::cout << "heap allocations not counted, build with NOSTALGIA_COUNT_HEAP_ALLOCS\n";
+				}
+				return OxError(0);
+			}
+		},
+		{
+			"Media::loadRom",
+			[](std::string_view) {
+				constexpr auto FilePath = "/TileSheets/Charset.ng";
+				const char data[] = "charset";
+				ox::Vector<char> image(64 * 1024);
+				oxReturnError(ox::FileSystem32::format(image.data(), image.size()));
+				{
+					ox::FileSystem32 fs(ox::FileStore32(image.data(), image.size()));
+					oxReturnError(fs.mkdir("/TileSheets", true));
+					oxReturnError(fs.write(FilePath, data, sizeof(data), ox::FileType::NormalFile));
+				}
+				// loadRomFs picks the file system by extension
+				const TempFile tmp(".oxfs");
+				if (tmp.path().empty()) {
+					return OxError(1, "Could not create a temp file");
+				}
+				const auto &path = tmp.path();
+				std::ofstream(path, std::ios::binary).write(image.data(), static_cast<std::streamsize>(image.size()));
+				{
+					oxRequire(fs, loadRomFs(path.c_str()));
+					oxRequire(file, fs->directAccess(FilePath));
+					oxAssert(ox_strcmp(file, data) == 0, "ROM file system returned the wrong data");
+					const char update[] = "updated";
+					oxReturnError(fs->write(FilePath, update, sizeof(update), ox::FileType::NormalFile));
+					oxRequire(updated, fs->directAccess(FilePath));
+					oxAssert(ox_strcmp(updated, update) == 0, "Writing to the ROM file system failed");
+				}
+				// writes to a copy on write ROM never reach the file
+				std::size_t size = 0;
+				oxRequire(rom, loadRom(path.c_str(), &size, RomAccess::CopyOnWrite));
+				oxAssert(size == image.size(), "loadRom reported the wrong size");
+				oxAssert(ox_memcmp(rom, image.data(), size) == 0, "loadRom returned the wrong data");
+				rom[0] = static_cast<char>(~image[0]);
+				unloadRom(rom);
+				char first = 0;
+				std::ifstream(path, std::ios::binary).read(&first, 1);
+				oxAssert(first == image[0], "Writing to a copy on write ROM changed the file");
+				return OxError(0);
+			}
+		},
+		{
+			// not registered with CTest, run manually: NostalgiaCoreTest TilePixels::bench [MB]
+			"TilePixels::bench",
+			[](std::string_view arg) {
+				const auto mb = arg.empty() ? 16 : std::stoi(std::string(arg));
+				const auto src = testPixels(static_cast<std::size_t>(mb) * ox::units::MB);
+				const auto pal = testPalette();
+				Color32 table[PaletteTableLength];
+				ox::Vector<Color32> dst(src.size() * 2);
+				const auto ref4 = timeMs([&] { reference4bpp(src, pal, dst.data()); });
+				const auto new4 = timeMs([&] {
+					toColor32Table(pal.data(), pal.size(), table);
+					expand4bpp(src.data(), src.size(), table, dst.data());
+				});
+				const auto ref8 = timeMs([&] { reference8bpp(src, pal, dst.data()); });
+				const auto new8 = timeMs([&] {
+					toColor32Table(pal.data(), pal.size(), table);
+					expand8bpp(src.data(), src.size(), table, dst.data());
+				});
+				ox::Vector<uint8_t> idx(src.size() * 2);
+				const auto unpack = timeMs([&] { unpack4bpp(src.data(), src.size(), idx.data()); });
+				std::cout << mb << " MB of pixel data\n"
+				          << "4bpp toColor32 loop: " << ref4 << " ms, expand4bpp: " << new4 << " ms\n"
+				          << "8bpp toColor32 loop: " << ref8 << " ms, expand8bpp: " << new8 << " ms\n"
+				          << "unpack4bpp: " << unpack << " ms\n";
+				return OxError(0);
+			}
+		},
+	},
+};
+
+int main(int argc, const char **args) {
+	int retval = -1;
+	if (argc > 1) {
+		std::string_view testName = args[1];
+		std::string_view testArg;
+		if (args[2]) {
+			testArg = args[2];
+		}
+		if (tests.find(testName) != tests.end()) {
+			retval = static_cast<int>(tests.at(testName)(testArg));
+		}
+	}
+	return retval;
+}
@@ -0,0 +1,213 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define NOSTALGIA_TILEPIXELS_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__)
+// AVX2 kernels are compiled with the target attribute and selected at runtime
+#define NOSTALGIA_TILEPIXELS_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+#include <ox/std/math.hpp>
+
+#include "tilepixels.hpp"
+
+namespace nostalgia::core {
+
+void toColor32Table(const Color16 *colors, std::size_t len, Color32 *table) noexcept {
+	const auto cnt = ox::min(len, PaletteTableLength);
+	for (std::size_t i = 0; i < cnt; ++i) {
+		table[i] = toColor32(colors[i]);
+	}
+	for (auto i = cnt; i < PaletteTableLength; ++i) {
+		table[i] = 0;
+	}
+}
+
+static void unpack4bppScalar(const uint8_t *src, std::size_t len, uint8_t *dst) noexcept {
+	for (std::size_t i = 0; i < len; ++i) {
+		dst[i * 2 + 0] = src[i] & 0xF;
+		dst[i * 2 + 1] = static_cast<uint8_t>(src[i] >> 4);
+	}
+}
+
+static void expand8bppScalar(const uint8_t *src, std::size_t len, const Color32 *table, Color32 *dst) noexcept {
+	for (std::size_t i = 0; i < len; ++i) {
+		dst[i] = table[src[i]];
+	}
+}
+
+static void blend8bppScalar(const uint8_t *src, std::size_t len, const Color32 *table, Color32 *dst) noexcept {
+	for (std::size_t i = 0; i < len; ++i) {
+		if (src[i]) {
+			dst[i] = table[src[i]];
+		}
+	}
+}
+
+static void expand4bppScalar(const uint8_t *src, std::size_t len, const Color32 *table, Color32 *dst) noexcept {
+	for (std::size_t i = 0; i < len; ++i) {
+		dst[i * 2 + 0] = table[src[i] & 0xF];
+		dst[i * 2 + 1] = table[src[i] >> 4];
+	}
+}
+
+#if defined(NOSTALGIA_TILEPIXELS_SSE2)
+
+/**
+ * Unpacks 16 source bytes into 32 palette indices.
+ */
+static void unpack4bpp16Sse2(const uint8_t *src, uint8_t *dst) noexcept {
+	const auto mask = _mm_set1_epi8(0xF);
+	const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+	const auto lo = _mm_and_si128(v, mask);
+	const auto hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 0), _mm_unpacklo_epi8(lo, hi));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), _mm_unpackhi_epi8(lo, hi));
+}
+
+static void unpack4bppSse2(const uint8_t *src, std::size_t len, uint8_t *dst) noexcept {
+	std::size_t i = 0;
+	for (; i + 16 <= len; i += 16) {
+		unpack4bpp16Sse2(src + i, dst + i * 2);
+	}
+	unpack4bppScalar(src + i, len - i, dst + i * 2);
+}
+
+/**
+ * SSE2 has no gather, so the nibbles are split 16 bytes at a time and the
+ * palette lookups are done from the unpacked indices.
+ */
+static void expand4bppSse2(const uint8_t *src, std::size_t len, const Color32 *table, Color32 *dst) noexcept {
+	std::size_t i = 0;
+	uint8_t idx[32];
+	for (; i + 16 <= len; i += 16) {
+		unpack4bpp16Sse2(src + i, idx);
+		expand8bppScalar(idx, 32, table, dst + i * 2);
+	}
+	expand4bppScalar(src + i, len - i, table, dst + i * 2);
+}
+
+#endif
+
+#if defined(NOSTALGIA_TILEPIXELS_AVX2)
+
+[[gnu::target("avx2")]]
+static void unpack4bppAvx2(const uint8_t *src, std::size_t len, uint8_t *dst) noexcept {
+	const auto mask = _mm256_set1_epi8(0xF);
+	std::size_t i = 0;
+	for (; i + 32 <= len; i += 32) {
+		const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+		const auto lo = _mm256_and_si256(v, mask);
+		const auto hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), mask);
+		// unpack works within 128 bit lanes, so put the lanes back in order
+		const auto a = _mm256_unpacklo_epi8(lo, hi);
+		const auto b = _mm256_unpackhi_epi8(lo, hi);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 2 + 0), _mm256_permute2x128_si256(a, b, 0x20));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 2 + 32), _mm256_permute2x128_si256(a, b, 0x31));
+	}
+	unpack4bppScalar(src + i, len - i, dst + i * 2);
+}
+
+[[gnu::target("avx2")]]
+static void expand8bppAvx2(const uint8_t *src, std::size_t len, const Color32 *table, Color32 *dst) noexcept {
+	const auto tbl = reinterpret_cast<const int*>(table);
+	std::size_t i = 0;
+	for (; i + 8 <= len; i += 8) {
+		const auto idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_i32gather_epi32(tbl, idx, 4));
+	}
+	expand8bppScalar(src + i, len - i, table, dst + i);
+}
+
+[[gnu::target("avx2")]]
+static void blend8bppAvx2(const uint8_t *src, std::size_t len, const Color32 *table, Color32 *dst) noexcept {
+	const auto tbl = reinterpret_cast<const int*>(table);
+	const auto zero = _mm256_setzero_si256();
+	std::size_t i = 0;
+	for (; i + 8 <= len; i += 8) {
+		const auto idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+		const auto colors = _mm256_i32gather_epi32(tbl, idx, 4);
+		const auto keep = _mm256_cmpeq_epi32(idx, zero);
+		const auto old = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_blendv_epi8(colors, old, keep));
+	}
+	blend8bppScalar(src + i, len - i, table, dst + i);
+}
+
+[[gnu::target("avx2")]]
+static void expand4bppAvx2(const uint8_t *src, std::size_t len, const Color32 *table, Color32 *dst) noexcept {
+	std::size_t i = 0;
+	uint8_t idx[64];
+	for (; i + 32 <= len; i += 32) {
+		unpack4bppAvx2(src + i, 32, idx);
+		expand8bppAvx2(idx, 64, table, dst + i * 2);
+	}
+	expand4bppScalar(src + i, len - i, table, dst + i * 2);
+}
+
+[[nodiscard]]
+static bool hasAvx2() noexcept {
+	static const bool avx2 = __builtin_cpu_supports("avx2");
+	return avx2;
+}
+
+#endif
+
+void unpack4bpp(const uint8_t *src, std::size_t len, uint8_t *dst) noexcept {
+#if defined(NOSTALGIA_TILEPIXELS_AVX2)
+	if (hasAvx2()) {
+		unpack4bppAvx2(src, len, dst);
+		return;
+	}
+#endif
+#if defined(NOSTALGIA_TILEPIXELS_SSE2)
+	unpack4bppSse2(src, len, dst);
+#else
+	unpack4bppScalar(src, len, dst);
+#endif
+}
+
+void expand4bpp(const uint8_t *src, std::size_t len, const Color32 *table, Color32 *dst) noexcept {
+#if defined(NOSTALGIA_TILEPIXELS_AVX2)
+	if (hasAvx2()) {
+		expand4bppAvx2(src, len, table, dst);
+		return;
+	}
+#endif
+#if defined(NOSTALGIA_TILEPIXELS_SSE2)
+	expand4bppSse2(src, len, table, dst);
+#else
+	expand4bppScalar(src, len, table, dst);
+#endif
+}
+
+void expand8bpp(const uint8_t *src, std::size_t len, const Color32 *table, Color32 *dst) noexcept {
+#if defined(NOSTALGIA_TILEPIXELS_AVX2)
+	if (hasAvx2()) {
+		expand8bppAvx2(src, len, table, dst);
+		return;
+	}
+#endif
+	expand8bppScalar(src, len, table, dst);
+}
+
+void blend8bpp(const uint8_t *src, std::size_t len, const Color32 *table, Color32 *dst) noexcept {
+#if defined(NOSTALGIA_TILEPIXELS_AVX2)
+	if (hasAvx2()) {
+		blend8bppAvx2(src, len, table, dst);
+		return;
+	}
+#endif
+	blend8bppScalar(src, len, table, dst);
+}
+
+}
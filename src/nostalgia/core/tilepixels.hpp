@@ -0,0 +1,58 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <ox/std/types.hpp>
+
+#include "color.hpp"
+
+namespace nostalgia::core {
+
+constexpr std::size_t PaletteTableLength = 256;
+
+/**
+ * Builds a full 256 entry Color32 lookup table from the given palette.
+ * Entries beyond the end of the palette are set to 0.
+ */
+void toColor32Table(const Color16 *colors, std::size_t len, Color32 *table) noexcept;
+
+/**
+ * Splits each 4bpp source byte into two 8 bit palette indices, low nibble
+ * first.
+ * @param src 4bpp pixel data
+ * @param len number of bytes in src, dst must hold len * 2 bytes
+ * @param dst destination for palette indices
+ */
+void unpack4bpp(const uint8_t *src, std::size_t len, uint8_t *dst) noexcept;
+
+/**
+ * Expands 4bpp pixel data to Color32.
+ * @param src 4bpp pixel data
+ * @param len number of bytes in src, dst must hold len * 2 Color32s
+ * @param table 256 entry table, as produced by toColor32Table
+ * @param dst destination for expanded pixels
+ */
+void expand4bpp(const uint8_t *src, std::size_t len, const Color32 *table, Color32 *dst) noexcept;
+
+/**
+ * Expands 8bpp pixel data to Color32.
+ * @param src 8bpp pixel data
+ * @param len number of bytes in src, dst must hold len Color32s
+ * @param table 256 entry table, as produced by toColor32Table
+ * @param dst destination for expanded pixels
+ */
+void expand8bpp(const uint8_t *src, std::size_t len, const Color32 *table, Color32 *dst) noexcept;
+
+/**
+ * Like expand8bpp, but treats palette index 0 as transparent, leaving the
+ * corresponding dst pixels untouched.
+ */
+void blend8bpp(const uint8_t *src, std::size_t len, const Color32 *table, Color32 *dst) noexcept;
+
+}
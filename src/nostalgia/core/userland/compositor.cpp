@@ -0,0 +1,201 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <array>
+
+#include <ox/std/hash.hpp>
+#include <ox/std/math.hpp>
+#include <ox/std/memops.hpp>
+
+#include <nostalgia/core/tilepixels.hpp>
+
+#include "compositor.hpp"
+
+namespace nostalgia::core {
+
+constexpr auto TileBytes = Compositor::TileWidth * Compositor::TileHeight;
+
+/**
+ * A scene with its tile sheet unpacked to 8 bit indices and its palette
+ * expanded, ready to be rendered by any number of bands at once.
+ */
+struct PreparedScene {
+	const CompositeScene *scene = nullptr;
+	ox::Vector<uint8_t> pixels;
+	std::size_t tiles = 0;
+	std::array<Color32, PaletteTableLength> palette = {};
+	ox::Error error;
+	Image image;
+};
+
+struct Band {
+	PreparedScene *scene = nullptr;
+	int y = 0;
+};
+
+static void prepare(const CompositeScene &scene, PreparedScene *out) noexcept {
+	out->scene = &scene;
+	const auto sheet = scene.sheet;
+	if (!sheet) {
+		out->error = OxError(1, "Composite scene has no tile sheet");
+		return;
+	}
+	if (sheet->bpp == 8) {
+		out->pixels = sheet->pixels;
+	} else {
+		out->pixels.resize(sheet->pixels.size() * 2);
+		unpack4bpp(sheet->pixels.data(), sheet->pixels.size(), out->pixels.data());
+	}
+	out->tiles = out->pixels.size() / TileBytes;
+	const auto &colors = scene.palette ? scene.palette->colors : sheet->pal.colors;
+	toColor32Table(colors.data(), colors.size(), out->palette.data());
+	auto columns = 0;
+	auto rows = 0;
+	for (const auto &layer : scene.layers) {
+		if (layer.tiles.size() != static_cast<std::size_t>(layer.columns * layer.rows)) {
+			out->error = OxError(1, "Tile layer size does not match its dimensions");
+			return;
+		}
+		columns = ox::max(columns, layer.columns);
+		rows = ox::max(rows, layer.rows);
+	}
+	out->image.width = columns * Compositor::TileWidth;
+	out->image.height = rows * Compositor::TileHeight;
+	out->image.pixels.resize(static_cast<std::size_t>(out->image.width * out->image.height));
+}
+
+static void renderBand(const Band &band) noexcept {
+	auto &s = *band.scene;
+	const auto width = s.image.width;
+	const auto yEnd = ox::min(band.y + Compositor::BandRows, s.image.height);
+	ox::Vector<uint8_t> idx(static_cast<std::size_t>(width));
+	for (auto y = band.y; y < yEnd; ++y) {
+		const auto line = &s.image.pixels[static_cast<std::size_t>(y * width)];
+		for (auto x = 0; x < width; ++x) {
+			line[x] = s.scene->clearColor;
+		}
+		const auto tileRow = y / Compositor::TileHeight;
+		const auto rowOffset = static_cast<std::size_t>((y % Compositor::TileHeight) * Compositor::TileWidth);
+		for (const auto &layer : s.scene->layers) {
+			if (tileRow >= layer.rows) {
+				continue;
+			}
+			const auto tiles = &layer.tiles[static_cast<std::size_t>(tileRow * layer.columns)];
+			for (auto c = 0; c < layer.columns; ++c) {
+				const std::size_t tile = tiles[c];
+				const auto dst = &idx[static_cast<std::size_t>(c * Compositor::TileWidth)];
+				if (tile < s.tiles) {
+					ox_memcpy(dst, &s.pixels[tile * TileBytes + rowOffset], Compositor::TileWidth);
+				} else {
+					ox_memset(dst, 0, Compositor::TileWidth);
+				}
+			}
+			const auto len = static_cast<std::size_t>(layer.columns * Compositor::TileWidth);
+			blend8bpp(idx.data(), len, s.palette.data(), line);
+		}
+	}
+}
+
+Compositor::Compositor(ThreadPool *pool) noexcept: m_pool(pool) {
+}
+
+ox::Result<Image> Compositor::composite(const CompositeScene &scene) noexcept {
+	auto out = compositeBatch({scene});
+	return ox::move(out[0]);
+}
+
+std::vector<ox::Result<Image>> Compositor::compositeBatch(const std::vector<CompositeScene> &scenes, int scale) noexcept {
+	std::vector<PreparedScene> prepared(scenes.size());
+	m_pool->parallelFor(scenes.size(), [&](std::size_t i) {
+		prepare(scenes[i], &prepared[i]);
+	});
+	std::vector<Band> bands;
+	for (auto &s : prepared) {
+		if (s.error) {
+			continue;
+		}
+		for (auto y = 0; y < s.image.height; y += BandRows) {
+			bands.emplace_back(Band{&s, y});
+		}
+	}
+	m_pool->parallelFor(bands.size(), [&](std::size_t i) {
+		renderBand(bands[i]);
+	});
+	if (scale > 1) {
+		m_pool->parallelFor(prepared.size(), [&](std::size_t i) {
+			prepared[i].image = downscale(prepared[i].image, scale);
+		});
+	}
+	std::vector<ox::Result<Image>> out(prepared.size());
+	for (std::size_t i = 0; i < prepared.size(); ++i) {
+		auto &s = prepared[i];
+		if (s.error) {
+			out[i] = s.error;
+		} else {
+			out[i] = ox::move(s.image);
+		}
+	}
+	return out;
+}
+
+Image downscale(const Image &src, int scale) noexcept {
+	if (scale <= 1) {
+		return src;
+	}
+	Image out;
+	out.width = src.width / scale;
+	out.height = src.height / scale;
+	out.pixels.resize(static_cast<std::size_t>(out.width * out.height));
+	const auto samples = static_cast<Color32>(scale * scale);
+	for (auto y = 0; y < out.height; ++y) {
+		for (auto x = 0; x < out.width; ++x) {
+			Color32 sum[4] = {};
+			for (auto sy = 0; sy < scale; ++sy) {
+				const auto row = &src.pixels[static_cast<std::size_t>((y * scale + sy) * src.width + x * scale)];
+				for (auto sx = 0; sx < scale; ++sx) {
+					const auto c = row[sx];
+					for (auto ch = 0; ch < 4; ++ch) {
+						sum[ch] += (c >> (ch * 8)) & 0xff;
+					}
+				}
+			}
+			Color32 c = 0;
+			for (auto ch = 0; ch < 4; ++ch) {
+				c |= (sum[ch] / samples) << (ch * 8);
+			}
+			out.pixels[static_cast<std::size_t>(y * out.width + x)] = c;
+		}
+	}
+	return out;
+}
+
+uint64_t imageHash(const Color32 *pixels, int width, int height) noexcept {
+	uint64_t hash = ox::Fnv1a64Basis;
+	const auto add = [&hash](uint32_t v) {
+		const uint8_t bytes[] = {
+			static_cast<uint8_t>(v),
+			static_cast<uint8_t>(v >> 8),
+			static_cast<uint8_t>(v >> 16),
+			static_cast<uint8_t>(v >> 24),
+		};
+		hash = ox::fnv1a64(bytes, sizeof(bytes), hash);
+	};
+	add(static_cast<uint32_t>(width));
+	add(static_cast<uint32_t>(height));
+	const auto len = static_cast<std::size_t>(width * height);
+	for (std::size_t i = 0; i < len; ++i) {
+		add(pixels[i]);
+	}
+	return hash;
+}
+
+uint64_t imageHash(const Image &img) noexcept {
+	return imageHash(img.pixels.data(), img.width, img.height);
+}
+
+}
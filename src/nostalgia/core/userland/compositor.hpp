@@ -0,0 +1,107 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <ox/std/error.hpp>
+#include <ox/std/vector.hpp>
+
+#include <nostalgia/core/gfx.hpp>
+
+#include "threadpool.hpp"
+
+namespace nostalgia::core {
+
+/**
+ * A grid of 8x8 tiles, as indices into a tile sheet.
+ */
+struct TileLayer {
+	// tiles not in the sheet, like EmptyTile, are transparent
+	static constexpr uint16_t EmptyTile = 0xffff;
+	int columns = 0;
+	int rows = 0;
+	// row-major, columns * rows entries
+	ox::Vector<uint16_t> tiles;
+};
+
+struct CompositeScene {
+	const NostalgiaGraphic *sheet = nullptr;
+	// uses the tile sheet's own palette if null
+	const NostalgiaPalette *palette = nullptr;
+	// drawn in order, palette index 0 is transparent on all layers
+	std::vector<TileLayer> layers;
+	Color32 clearColor = 0;
+};
+
+/**
+ * RGBA8 image, the bytes of each Color32 are in R, G, B, A order.
+ */
+struct Image {
+	int width = 0;
+	int height = 0;
+	ox::Vector<Color32> pixels;
+};
+
+/**
+ * Composites tile layers into Images on the CPU, without a Context. Each
+ * image is split into bands of scanlines that are rendered in parallel on a
+ * ThreadPool. Bands write to disjoint rows and share no state, so output is
+ * identical for any number of threads.
+ */
+class Compositor {
+
+	public:
+		static constexpr auto TileWidth = 8;
+		static constexpr auto TileHeight = 8;
+		static constexpr auto BandRows = 16;
+
+	private:
+		ThreadPool *m_pool = nullptr;
+
+	public:
+		explicit Compositor(ThreadPool *pool) noexcept;
+
+		/**
+		 * Renders the scene at one image pixel per tile pixel, the image being
+		 * the size of its largest layer.
+		 */
+		[[nodiscard]]
+		ox::Result<Image> composite(const CompositeScene &scene) noexcept;
+
+		/**
+		 * Renders all scenes, with the bands of all of them spread across the
+		 * pool at once, so that many small scenes still use every thread.
+		 * @param scale integer factor to downscale the images by, averaging
+		 *              each scale x scale block of pixels, for thumbnails
+		 */
+		[[nodiscard]]
+		std::vector<ox::Result<Image>> compositeBatch(const std::vector<CompositeScene> &scenes, int scale = 1) noexcept;
+
+};
+
+/**
+ * Box filter downscale by an integer factor, partial blocks at the right and
+ * bottom edges are dropped.
+ */
+[[nodiscard]]
+Image downscale(const Image &src, int scale) noexcept;
+
+/**
+ * @return FNV-1a hash of the image dimensions and pixels, for golden image
+ *         comparisons. Independent of the host's byte order, and shared by
+ *         every renderer's output so equal frames hash equally.
+ */
+[[nodiscard]]
+uint64_t imageHash(const Color32 *pixels, int width, int height) noexcept;
+
+[[nodiscard]]
+uint64_t imageHash(const Image &img) noexcept;
+
+}
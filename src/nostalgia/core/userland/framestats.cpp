@@ -0,0 +1,63 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <algorithm>
+
+#include "framestats.hpp"
+
+namespace nostalgia::core {
+
+FrameSample *FrameStats::push() noexcept {
+	auto &s = m_samples[m_frames % Capacity];
+	s = {};
+	++m_frames;
+	return &s;
+}
+
+FrameSample *FrameStats::frame(uint64_t frame) noexcept {
+	if (frame >= m_frames || m_frames - frame > Capacity) {
+		return nullptr;
+	}
+	return &m_samples[frame % Capacity];
+}
+
+uint64_t FrameStats::frames() const noexcept {
+	return m_frames;
+}
+
+std::size_t FrameStats::size() const noexcept {
+	return m_frames < Capacity ? static_cast<std::size_t>(m_frames) : Capacity;
+}
+
+const FrameSample &FrameStats::operator[](std::size_t i) const noexcept {
+	const auto first = m_frames - size();
+	return m_samples[(first + i) % Capacity];
+}
+
+FramePercentiles FrameStats::percentiles(uint64_t FrameSample::*field, bool skipZero) const noexcept {
+	std::array<uint64_t, Capacity> vals;
+	std::size_t n = 0;
+	for (std::size_t i = 0; i < size(); ++i) {
+		const auto v = (*this)[i].*field;
+		if (v || !skipZero) {
+			vals[n++] = v;
+		}
+	}
+	if (!n) {
+		return {};
+	}
+	std::sort(vals.begin(), vals.begin() + static_cast<std::ptrdiff_t>(n));
+	const auto rank = [&](std::size_t pct) {
+		// nearest rank: ceil(pct / 100 * n), 1 based
+		const auto r = (pct * n + 99) / 100;
+		return vals[r ? r - 1 : 0];
+	};
+	return {rank(50), rank(95), rank(99), n};
+}
+
+}
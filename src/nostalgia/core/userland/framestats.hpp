@@ -0,0 +1,100 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <array>
+
+#include <ox/std/types.hpp>
+
+namespace nostalgia::core {
+
+/**
+ * Measurements of a single frame. Times are in microseconds.
+ */
+struct FrameSample {
+	// time since the start of the previous frame's draw
+	uint64_t frameUs = 0;
+	uint64_t eventUs = 0;
+	uint64_t drawUs = 0;
+	uint64_t swapUs = 0;
+	// 0 until the frame's GPU timer query resolves, a few frames later
+	uint64_t gpuUs = 0;
+	uint64_t uploadBytes = 0;
+	uint64_t glCalls = 0;
+	uint64_t drawCalls = 0;
+	// global operator new calls during the frame, 0 unless heapAllocationsCounted
+	uint64_t heapAllocs = 0;
+	// time from the oldest input event the frame reflects to the end of its
+	// swap, 0 for frames without input
+	uint64_t inputLatencyUs = 0;
+};
+
+struct FramePercentiles {
+	uint64_t p50 = 0;
+	uint64_t p95 = 0;
+	uint64_t p99 = 0;
+	// number of samples the percentiles were taken over
+	std::size_t samples = 0;
+};
+
+/**
+ * Ring buffer of the samples of the last Capacity frames.
+ */
+class FrameStats {
+
+	public:
+		static constexpr std::size_t Capacity = 256;
+
+	private:
+		std::array<FrameSample, Capacity> m_samples = {};
+		uint64_t m_frames = 0;
+
+	public:
+		/**
+		 * Starts a new frame, overwriting the oldest sample once full.
+		 * @return the zeroed sample of the new frame
+		 */
+		FrameSample *push() noexcept;
+
+		/**
+		 * @return the sample of the given frame number, or nullptr if it has
+		 *         been overwritten or not started yet
+		 */
+		[[nodiscard]]
+		FrameSample *frame(uint64_t frame) noexcept;
+
+		/**
+		 * @return number of frames started since creation
+		 */
+		[[nodiscard]]
+		uint64_t frames() const noexcept;
+
+		/**
+		 * @return number of samples held
+		 */
+		[[nodiscard]]
+		std::size_t size() const noexcept;
+
+		/**
+		 * @param i sample index, 0 being the oldest held
+		 */
+		[[nodiscard]]
+		const FrameSample &operator[](std::size_t i) const noexcept;
+
+		/**
+		 * Nearest-rank percentiles of the given field over the held samples.
+		 * @param skipZero ignore samples where the field is 0, for fields that
+		 *                 are only measured on some frames
+		 */
+		[[nodiscard]]
+		FramePercentiles percentiles(uint64_t FrameSample::*field, bool skipZero = false) const noexcept;
+
+};
+
+}
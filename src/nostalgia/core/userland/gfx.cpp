@@ -8,14 +8,22 @@
 
 #include <ox/claw/claw.hpp>
 #include <nostalgia/core/gfx.hpp>
+#include <nostalgia/core/tilepixels.hpp>
 
 #include "gfx.hpp"
+#include "tilesheetloader.hpp"
 
 namespace nostalgia::core {
 
 template<typename T>
 static ox::Result<T> readObj(Context *ctx, const ox::FileAddress &file) noexcept {
-	oxRequire(buff, ctx->rom->read(file));
+	// load time buffers stay on the heap, a large file would otherwise grow the
+	// frame arena for the rest of the run
+	ox::Buffer buff;
+	{
+		std::lock_guard lk(renderer::romMutex(ctx));
+		oxReturnError(ctx->rom->read(file).moveTo(&buff));
+	}
 	return ox::readClaw<T>(buff);
 }
 
@@ -26,43 +34,72 @@ ox::Error initConsole(Context *ctx) noexcept {
 	return loadBgTileSheet(ctx, 0, TilesheetAddr, PaletteAddr);
 }
 
-ox::Error loadSpriteTileSheet(Context*,
-                              int,
-                              const ox::FileAddress&,
-                              const ox::FileAddress&) noexcept {
-	return OxError(0);
+/**
+ * Loads the given tile sheet and unpacks it to one palette index per pixel.
+ */
+static ox::Result<NostalgiaGraphic> readTileSheetIndices(Context *ctx, const ox::FileAddress &tilesheetPath) noexcept {
+	oxRequireM(tilesheet, readObj<NostalgiaGraphic>(ctx, tilesheetPath));
+	if (tilesheet.bpp != 8) {
+		ox::Vector<uint8_t> pixels(tilesheet.pixels.size() * 2);
+		unpack4bpp(tilesheet.pixels.data(), tilesheet.pixels.size(), pixels.data());
+		tilesheet.pixels = ox::move(pixels);
+	}
+	return ox::move(tilesheet);
+}
+
+ox::Error loadSpriteTileSheet(Context *ctx,
+                              int section,
+                              const ox::FileAddress &tilesheetPath,
+                              const ox::FileAddress &palettePath) noexcept {
+	if (section != 0) {
+		return OxError(1, "Only sprite tile sheet section 0 is supported on userland");
+	}
+	oxRequire(tilesheet, readTileSheetIndices(ctx, tilesheetPath));
+	constexpr int width = 8;
+	const int height = static_cast<int>(tilesheet.pixels.size() / width);
+	oxReturnError(renderer::loadSpriteTexture(ctx, tilesheet.pixels.data(), width, height));
+	return loadSpritePalette(ctx, section, palettePath ? palettePath : tilesheet.defaultPalette);
 }
 
 ox::Error loadBgTileSheet(Context *ctx,
                           int section,
                           const ox::FileAddress &tilesheetPath,
                           const ox::FileAddress &palettePath) noexcept {
-	oxRequire(tilesheet, readObj<NostalgiaGraphic>(ctx, tilesheetPath));
-	oxRequire(palette, readObj<NostalgiaPalette>(ctx, palettePath ? palettePath : tilesheet.defaultPalette));
-	const unsigned bytesPerTile = tilesheet.bpp == 8 ? 64 : 32;
-	const auto tiles = tilesheet.pixels.size() / bytesPerTile;
+	oxRequire(tilesheet, readTileSheetIndices(ctx, tilesheetPath));
 	constexpr int width = 8;
-	const int height = 8 * static_cast<int>(tiles);
-	ox::Vector<uint32_t> pixels;
-	if (bytesPerTile == 64) { // 8 BPP
-		pixels.resize(tilesheet.pixels.size());
-		for (std::size_t i = 0; i < tilesheet.pixels.size(); ++i) {
-			pixels[i] = toColor32(palette.colors[tilesheet.pixels[i]]);
-		}
-	} else { // 4 BPP
-		pixels.resize(tilesheet.pixels.size() * 2);
-		for (std::size_t i = 0; i < tilesheet.pixels.size(); ++i) {
-			pixels[i * 2 + 0] = toColor32(palette.colors[tilesheet.pixels[i] & 0xF]);
-			pixels[i * 2 + 1] = toColor32(palette.colors[tilesheet.pixels[i] >> 4]);
-		}
-	}
-	return renderer::loadBgTexture(ctx, section, pixels.data(), width, height);
+	const int height = static_cast<int>(tilesheet.pixels.size() / width);
+	oxReturnError(renderer::loadBgTexture(ctx, section, tilesheet.pixels.data(), width, height));
+	return loadBgPalette(ctx, section, palettePath ? palettePath : tilesheet.defaultPalette);
 }
 
-void puts(Context *ctx, int column, int row, const char *str) noexcept {
-	for (int i = 0; str[i]; ++i) {
-		setTile(ctx, 0, column + i, row, static_cast<uint8_t>(charMap[static_cast<uint8_t>(str[i])]));
-	}
+ox::Result<TileSheetLoadId> loadBgTileSheetAsync(Context *ctx,
+                                                 int section,
+                                                 const ox::FileAddress &tilesheetAddr,
+                                                 const ox::FileAddress &paletteAddr,
+                                                 bool commit) noexcept {
+	return renderer::tileSheetLoader(ctx)->loadBg(section, tilesheetAddr, paletteAddr, commit);
+}
+
+TileSheetLoadStatus tileSheetLoadStatus(Context *ctx, TileSheetLoadId id) noexcept {
+	return renderer::tileSheetLoader(ctx)->status(id);
+}
+
+ox::Error tileSheetLoadError(Context *ctx, TileSheetLoadId id) noexcept {
+	return renderer::tileSheetLoader(ctx)->error(id);
+}
+
+ox::Error commitTileSheetLoad(Context *ctx, TileSheetLoadId id) noexcept {
+	return renderer::tileSheetLoader(ctx)->commit(id);
+}
+
+ox::Error loadBgPalette(Context *ctx, int section, const ox::FileAddress &paletteAddr) noexcept {
+	oxRequire(palette, readObj<NostalgiaPalette>(ctx, paletteAddr));
+	return renderer::loadBgPalette(ctx, section, palette.colors.data(), palette.colors.size());
+}
+
+ox::Error loadSpritePalette(Context *ctx, int, const ox::FileAddress &paletteAddr) noexcept {
+	oxRequire(palette, readObj<NostalgiaPalette>(ctx, paletteAddr));
+	return renderer::loadSpritePalette(ctx, palette.colors.data(), palette.colors.size());
 }
 
 }
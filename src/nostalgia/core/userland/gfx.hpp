@@ -8,16 +8,126 @@
 
 #pragma once
 
+#include <mutex>
+
+#include <ox/std/math.hpp>
 #include <ox/std/types.hpp>
 
+#include <nostalgia/core/color.hpp>
 #include <nostalgia/core/context.hpp>
 
+#include "framestats.hpp"
+
+namespace nostalgia::core {
+class TileSheetLoader;
+}
+
 namespace nostalgia::core::renderer {
 
-ox::Error init(Context *ctx);
+/**
+ * A rectangle of tile map cells, along with the offset of its top left
+ * cell in the rectangle it was clipped from.
+ */
+struct TileRect {
+	int column = 0;
+	int row = 0;
+	int width = 0;
+	int height = 0;
+	int srcX = 0;
+	int srcY = 0;
+};
+
+/**
+ * Clips a rectangle to a columns x rows tile map.
+ * @return false if nothing is left
+ */
+constexpr bool clipTileRect(TileRect *rect, int columns, int rows) noexcept {
+	rect->srcX = ox::max(0, -rect->column);
+	rect->srcY = ox::max(0, -rect->row);
+	rect->width = ox::min(rect->column + rect->width, columns) - (rect->column + rect->srcX);
+	rect->height = ox::min(rect->row + rect->height, rows) - (rect->row + rect->srcY);
+	rect->column += rect->srcX;
+	rect->row += rect->srcY;
+	return rect->width > 0 && rect->height > 0;
+}
+
+using GlProc = void(*)();
+
+// looks up a GL function by name, e.g. glfwGetProcAddress
+using GlProcLookup = GlProc(*)(const char *name);
+
+/**
+ * @param glProc used to find GL functions the GL headers do not declare,
+ * the features that need them are off without it
+ */
+ox::Error init(Context *ctx, GlProcLookup glProc = nullptr) noexcept;
+
+ox::Error shutdown(Context *ctx) noexcept;
+
+/**
+ * Hands the state set through the core API since the last call over to
+ * drawPublished, and queues the texture writes of the loads since then.
+ * The core API keeps writing to its own copy, so game logic can run while
+ * drawPublished renders. Must not run concurrently with drawPublished.
+ */
+void publishFrame(Context *ctx) noexcept;
+
+/**
+ * Renders the state of the last publishFrame. With the OpenGL renderer it is
+ * the only function that touches the GL context, so it can run on a thread
+ * of its own while the core API is used on another. The software renderer
+ * keeps a single copy of its state and must draw on the API's thread.
+ * core::draw is publishFrame followed by drawPublished.
+ */
+void drawPublished(Context *ctx) noexcept;
+
+/**
+ * Loads a tile sheet as 8 bit palette indices, one byte per pixel.
+ */
+ox::Error loadBgTexture(Context *ctx, int section, const uint8_t *pixels, int w, int h) noexcept;
+
+/**
+ * Loads the palette for the given section, colors beyond the 256th are ignored.
+ */
+ox::Error loadBgPalette(Context *ctx, int section, const Color16 *colors, std::size_t len) noexcept;
+
+/**
+ * Loads the sprite tile sheet as 8 bit palette indices, one byte per pixel.
+ */
+ox::Error loadSpriteTexture(Context *ctx, const uint8_t *pixels, int w, int h) noexcept;
+
+ox::Error loadSpritePalette(Context *ctx, const Color16 *colors, std::size_t len) noexcept;
 
-ox::Error shutdown(Context *ctx);
+/**
+ * Mutex to hold while reading from the Context's rom, as the tile sheet
+ * loader reads from it on its worker threads.
+ */
+[[nodiscard]]
+std::mutex &romMutex(Context *ctx) noexcept;
+
+/**
+ * @return the tile sheet loader, created on first use
+ */
+[[nodiscard]]
+TileSheetLoader *tileSheetLoader(Context *ctx) noexcept;
+
+/**
+ * Adds the windower's CPU times to the sample of the last drawn frame.
+ * To be called once per frame, after the buffer swap.
+ * @param inputLatencyUs see FrameSample::inputLatencyUs
+ */
+void recordFrameTimes(Context *ctx, uint64_t eventUs, uint64_t swapUs, uint64_t inputLatencyUs = 0) noexcept;
+
+[[nodiscard]]
+const FrameStats &frameStats(Context *ctx) noexcept;
+
+/**
+ * Toggles an ImGui overlay of the frame stats, drawn at the end of draw.
+ * The windower must start its ImGui frame before draw.
+ */
+void setFrameStatsOverlay(Context *ctx, bool enabled) noexcept;
 
-ox::Error loadBgTexture(Context *ctx, int section, void *bytes, int w, int h);
+[[nodiscard]]
+bool frameStatsOverlay(Context *ctx) noexcept;
 
 }
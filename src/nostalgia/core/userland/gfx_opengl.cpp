@@ -7,18 +7,40 @@
  */
 
 #include <array>
+#include <chrono>
+#include <mutex>
 
 #include <nostalgia/glutils/glutils.hpp>
 
 #define IMGUI_IMPL_OPENGL_ES3
+#include <imgui.h>
 #include <imgui_impl_opengl3.h>
 
-#include <ox/std/bit.hpp>
+// timer queries come from GL_ARB_timer_query or GL_EXT_disjoint_timer_query,
+// which the GLES 3 headers do not declare
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED 0x88BF
+#endif
+#ifndef GL_APIENTRYP
+#define GL_APIENTRYP *
+#endif
+using GetQueryObjectui64v = void(GL_APIENTRYP)(GLuint id, GLenum pname, GLuint64 *params);
+
+#include <ox/std/assert.hpp>
 #include <ox/std/fmt.hpp>
+#include <ox/std/math.hpp>
+#include <ox/std/memops.hpp>
+#include <ox/std/memory.hpp>
 
 #include <nostalgia/core/config.hpp>
 #include <nostalgia/core/gfx.hpp>
 
+#include "framestats.hpp"
+#include "gfx.hpp"
+#include "heapcounter.hpp"
+#include "tileatlas.hpp"
+#include "tilesheetloader.hpp"
+
 namespace nostalgia::core {
 
 
@@ -28,98 +50,375 @@ constexpr auto TileRows = 128;
 constexpr auto TileColumns = 128;
 constexpr auto TileCount = TileRows * TileColumns;
 constexpr auto BgVertexVboRows = 4;
-constexpr auto BgVertexVboRowLength = 4;
+constexpr auto BgVertexVboRowLength = 2;
 constexpr auto BgVertexVboLength = BgVertexVboRows * BgVertexVboRowLength;
-constexpr auto BgVertexEboLength = 6;
+constexpr auto PaletteLength = 256;
+constexpr auto SpriteCount = 128;
+// sections 0-3 are the backgrounds, the sprite tile sheet gets the last one
+constexpr auto SectionCount = 5;
+constexpr auto SpriteSection = 4;
+// max tiles per tile sheet, the width of the section lookup texture
+constexpr auto LookupLength = 1024;
+// GPU timer queries in flight, results are read this many frames later
+constexpr auto GpuQueryCount = 3;
+
+// sprite dimensions in tiles, indexed by shape (square, wide, tall) and size
+constexpr uint8_t SpriteDimensions[3][4][2] = {
+	{{1, 1}, {2, 2}, {4, 4}, {8, 8}},
+	{{2, 1}, {4, 1}, {4, 2}, {8, 4}},
+	{{1, 2}, {1, 4}, {2, 4}, {4, 8}},
+};
+
+constexpr uint16_t SpriteFlag_FlipX = 1 << 8;
+constexpr uint16_t SpriteFlag_Enabled = 1 << 9;
+
+// unit quad, drawn as a triangle strip, one instance per tile
+constexpr std::array<float, BgVertexVboLength> BgQuadVertices = {
+	0, 0, // bottom left
+	1, 0, // bottom right
+	0, 1, // top left
+	1, 1, // top right
+};
+
+// range of dirty columns in a tile map row, empty when begin >= end
+struct DirtySpan {
+	uint16_t begin = TileColumns;
+	uint16_t end = 0;
+};
+
+/**
+ * A layer's tile map and placement. There are two of each: the one the core
+ * API writes, and the one draws read, which publishFrame brings up to date.
+ */
+struct BgState {
+	bool enabled = false;
+	// one tile index per cell, uploaded as a per-instance vertex attribute
+	std::array<uint16_t, TileCount> tileMap = {};
+	// cells changed since the last publish in the API's copy, cells not yet
+	// uploaded in the drawn one
+	std::array<DirtySpan, TileRows> dirtyRows = {};
+	bool dirty = false;
+	// true while every cell of tileMap is known to be 0
+	bool clear = true;
+	// applied by the vertex shader, so scrolling costs no upload
+	BgTransform transform;
+	bool wrap = false;
+};
 
 struct Background {
 	glutils::GLVertexArray vao;
-	glutils::GLBuffer vbo;
-	glutils::GLBuffer ebo;
-	glutils::GLTexture tex;
-	bool enabled = false;
-	bool updated = false;
-	std::array<float, TileCount * BgVertexVboLength> bgVertices = {};
-	std::array<GLuint, TileCount * BgVertexEboLength> bgElements = {};
+	glutils::GLBuffer tileMapBuff;
+	BgState drawn;
+};
+
+/**
+ * Sprite attributes as consumed by the sprite vertex shader, laid out
+ * as a per-instance ivec4.
+ */
+struct SpriteAttr {
+	int16_t x = 0;
+	int16_t y = 0;
+	uint16_t tileIdx = 0;
+	// bits 0-3: width in tiles, 4-7: height in tiles, 8: flip x, 9: enabled
+	uint16_t flags = 0;
+};
+
+/**
+ * Sprite attributes, kept in an API and a drawn copy like BgState.
+ */
+struct SpriteState {
+	bool loaded = false;
+	// Sprites are stored in reverse order of their index, so that lower
+	// indices are drawn last and end up on top, as on the GBA.
+	std::array<SpriteAttr, SpriteCount> attrs = {};
+	// range of attrs changed since the last publish or upload, empty when
+	// begin >= end
+	std::size_t dirtyBegin = SpriteCount;
+	std::size_t dirtyEnd = 0;
+};
+
+struct Sprites {
+	glutils::GLVertexArray vao;
+	glutils::GLBuffer attrBuff;
+	SpriteState drawn;
+};
+
+/**
+ * A glTexSubImage2D call on the texture bound to unit, with its texels at
+ * offset in TexWrites::data.
+ */
+struct TexWrite {
+	unsigned unit = 0;
+	GLint x = 0;
+	GLint y = 0;
+	GLsizei w = 0;
+	GLsizei h = 0;
+	GLenum type = GL_UNSIGNED_BYTE;
+	std::size_t offset = 0;
+	std::size_t len = 0;
+};
+
+/**
+ * Texture writes queued by tile sheet and palette loads, so that only draws
+ * touch the GL context.
+ */
+struct TexWrites {
+	ox::Vector<TexWrite> writes;
+	// grown by doubling and never shrunk, dataLen bytes of it are in use
+	ox::Vector<uint8_t> data;
+	std::size_t dataLen = 0;
+};
+
+/**
+ * Renderer state as set through the core API since the last publish.
+ */
+struct FrameState {
+	std::array<BgState, 4> backgrounds;
+	SpriteState sprites;
+	TexWrites texWrites;
+	bool statsOverlay = false;
 };
 
 struct GlImplData {
-	glutils::GLProgram bgShader;
-	int64_t prevFpsCheckTime = 0;
+	glutils::Program bgShader;
+	glutils::Program spriteShader;
+	glutils::GLState state;
+	// quad geometry shared by all background layers, built once at init
+	glutils::GLBuffer bgQuadVbo;
+	// Tiles of all loaded tile sheets, 8 bit palette indices, deduplicated.
+	glutils::GLTexture atlasTex;
+	TileAtlas atlas;
+	// One row per section, mapping the section's tile sheet indices to
+	// atlas slots.
+	glutils::GLTexture lookupTex;
+	std::array<ox::Vector<uint16_t>, SectionCount> sectionSlots;
+	// One row of PaletteLength Color16 values per section, converted to RGBA
+	// in the fragment shaders.
+	glutils::GLTexture paletteTex;
+	GLint uniformSection = 0;
+	GLint uniformXScale = 0;
+	GLint uniformMapToScreen = 0;
+	GLint uniformOrigin = 0;
+	GLint uniformWrap = 0;
+	GLint uniformSpriteXScale = 0;
+	// last values set for the uniforms above, to skip redundant updates
+	int section = 0;
+	float xScale = 0;
+	std::array<float, 4> mapToScreen = {};
+	std::array<float, 4> origin = {};
+	int wrap = 0;
+	float spriteXScale = 0;
+	std::chrono::steady_clock::time_point prevFpsCheckTime;
+	std::chrono::steady_clock::time_point prevDrawStart;
 	uint64_t draws = 0;
+	// bytes of tile map, sprite and texture data uploaded in the current frame and FPS window
+	uint64_t frameUploadBytes = 0;
+	uint64_t frameDrawCalls = 0;
+	uint64_t windowUploadBytes = 0;
+	uint64_t windowGlCalls = 0;
+	FrameStats stats;
+	uint64_t prevHeapAllocs = 0;
+	// null if the context has no timer queries, which turns GPU timing off
+	GetQueryObjectui64v getQueryObjectui64v = nullptr;
+	// GL_TIME_ELAPSED queries, used round robin, and the frame each measures
+	std::array<GLuint, GpuQueryCount> gpuQueries = {};
+	std::array<uint64_t, GpuQueryCount> gpuQueryFrames = {};
+	std::array<bool, GpuQueryCount> gpuQueryPending = {};
+	// the published state, only read and written by drawPublished
 	std::array<Background, 4> backgrounds;
+	Sprites sprites;
+	TexWrites texWrites;
+	bool statsOverlay = false;
+	// frame arena stats as of the last publish, for the overlay
+	uint64_t arenaPeak = 0;
+	uint64_t arenaCapacity = 0;
+	uint64_t arenaOverflows = 0;
+	// written by the core API, read by publishFrame
+	FrameState next;
+	std::mutex romMtx;
+	ox::UniquePtr<TileSheetLoader> tileSheetLoader;
 };
 
 constexpr const GLchar *bgvshad = R"(
 	{}
-	in vec2 vTexCoord;
-	in vec2 position;
-	out vec2 fTexCoord;
-	uniform float vTileHeight;
+	const int TileColumns = {};
+	// the tile map is square
+	const float MapSize = float(TileColumns) * 8.0;
+	const float YScale = 2.0 / 20.0;
+	in vec2 vPosition;
+	in uint vTileIdx;
+	out vec2 fTilePos;
+	flat out int fTileIdx;
+	uniform float vXScale;
+	// inverse of the layer's BgTransform matrix
+	uniform mat2 vMapToScreen;
+	// xy: map pixel at the top left of the screen, zw: at its center
+	uniform vec4 vOrigin;
+	uniform int vWrap;
 	void main() {
-	    gl_Position = vec4(position, 0.0, 1.0);
-	    fTexCoord = vTexCoord * vec2(1, vTileHeight);
+	    int col = gl_InstanceID % TileColumns;
+	    int row = gl_InstanceID / TileColumns;
+	    vec2 tile = vec2(float(col), float(row)) * 8.0;
+	    if (vWrap != 0) {
+	        // place the tile in the repeat of the map closest to the screen's center
+	        tile -= MapSize * floor((tile + 4.0 - vOrigin.zw) / MapSize + 0.5);
+	    }
+	    fTilePos = vec2(vPosition.x, 1.0 - vPosition.y) * 8.0;
+	    vec2 px = vMapToScreen * (tile + fTilePos - vOrigin.xy);
+	    gl_Position = vec4(px.x * vXScale / 8.0 - 1.0, 1.0 - px.y * YScale / 8.0, 0.0, 1.0);
+	    fTileIdx = int(vTileIdx);
 	})";
 
 constexpr const GLchar *bgfshad = R"(
 	{}
+	const int AtlasColumns = {};
 	out vec4 outColor;
-	in vec2 fTexCoord;
-	uniform sampler2D image;
+	in vec2 fTilePos;
+	flat in int fTileIdx;
+	uniform int vSection;
+	uniform usampler2D atlas;
+	uniform usampler2D palette;
+	uniform usampler2D lookup;
+	void main() {
+	    ivec2 p = min(ivec2(fTilePos), ivec2(7));
+	    int slot = int(texelFetch(lookup, ivec2(fTileIdx, vSection), 0).r);
+	    ivec2 ap = ivec2((slot % AtlasColumns) * 8 + p.x, (slot / AtlasColumns) * 8 + p.y);
+	    uint idx = texelFetch(atlas, ap, 0).r;
+	    uint c = texelFetch(palette, ivec2(int(idx), vSection), 0).r;
+	    uvec3 rgb = uvec3(c & 31u, (c >> 5u) & 31u, (c >> 10u) & 31u) * 8u;
+	    outColor = vec4(vec3(rgb) / 255.0, 1.0);
+	})";
+
+constexpr const GLchar *spritevshad = R"(
+	{}
+	const float YScale = 2.0 / 20.0;
+	in vec2 vPosition;
+	in ivec4 vSprite;
+	out vec2 fSpritePos;
+	flat out int fTileIdx;
+	flat out int fTilesWide;
+	flat out int fFlipX;
+	uniform float vXScale;
 	void main() {
-	    //outColor = vec4(0.0, 0.7, 1.0, 1.0);
-	    outColor = texture(image, fTexCoord);
+	    int flags = vSprite.w;
+	    if ((flags & 512) == 0) {
+	        // hidden, collapse to a degenerate quad
+	        gl_Position = vec4(0.0, 0.0, 0.0, 1.0);
+	        return;
+	    }
+	    fTilesWide = flags & 15;
+	    vec2 size = vec2(float(fTilesWide), float((flags >> 4) & 15)) * 8.0;
+	    fSpritePos = vec2(vPosition.x, 1.0 - vPosition.y) * size;
+	    vec2 px = vec2(vSprite.xy) + fSpritePos;
+	    gl_Position = vec4(px.x * vXScale / 8.0 - 1.0, 1.0 - px.y * YScale / 8.0, 0.0, 1.0);
+	    fTileIdx = vSprite.z;
+	    fFlipX = (flags >> 8) & 1;
+	})";
+
+constexpr const GLchar *spritefshad = R"(
+	{}
+	const int AtlasColumns = {};
+	const int LookupLength = {};
+	const int Section = {};
+	out vec4 outColor;
+	in vec2 fSpritePos;
+	flat in int fTileIdx;
+	flat in int fTilesWide;
+	flat in int fFlipX;
+	uniform usampler2D atlas;
+	uniform usampler2D palette;
+	uniform usampler2D lookup;
+	void main() {
+	    ivec2 p = ivec2(fSpritePos);
+	    if (fFlipX != 0) {
+	        p.x = fTilesWide * 8 - 1 - p.x;
+	    }
+	    int tile = fTileIdx + (p.y / 8) * fTilesWide + p.x / 8;
+	    if (tile >= LookupLength) {
+	        discard;
+	    }
+	    int slot = int(texelFetch(lookup, ivec2(tile, Section), 0).r);
+	    ivec2 ap = ivec2((slot % AtlasColumns) * 8 + p.x % 8, (slot / AtlasColumns) * 8 + p.y % 8);
+	    uint idx = texelFetch(atlas, ap, 0).r;
+	    if (idx == 0u) {
+	        discard;
+	    }
+	    uint c = texelFetch(palette, ivec2(int(idx), Section), 0).r;
+	    uvec3 rgb = uvec3(c & 31u, (c >> 5u) & 31u, (c >> 10u) & 31u) * 8u;
+	    outColor = vec4(vec3(rgb) / 255.0, 1.0);
 	})";
 
 [[nodiscard]]
-static constexpr auto bgVertexRow(unsigned x, unsigned y) noexcept {
-	return y * TileRows + x;
+static constexpr auto bgTileIdx(unsigned x, unsigned y) noexcept {
+	return y * TileColumns + x;
 }
 
-static void setTileBufferObject(Context *ctx, unsigned vi, float x, float y, int textureRow, float *vbo, GLuint *ebo) {
-	// don't worry, this memcpy gets optimized to something much more ideal
-	const auto [sw, sh] = getScreenSize(ctx);
-	constexpr float ymod = 2.0f / 20.0f;
-	const float xmod = ymod * static_cast<float>(sh) / static_cast<float>(sw);
-	x *= xmod;
-	y *= -ymod;
-	x -= 1.0f;
-	y += 1.0f - ymod;
-	const float vertices[BgVertexVboLength] = {
-		       x,        y, 0, static_cast<float>(textureRow + 1), // bottom left
-		x + xmod,        y, 1, static_cast<float>(textureRow + 1), // bottom right
-		x + xmod, y + ymod, 1, static_cast<float>(textureRow + 0), // top right
-		       x, y + ymod, 0, static_cast<float>(textureRow + 0), // top left
-	};
-	memcpy(vbo, vertices, sizeof(vertices));
-	const GLuint elms[BgVertexEboLength] = {
-		vi + 0, vi + 1, vi + 2,
-		vi + 2, vi + 3, vi + 0,
-	};
-	memcpy(ebo, elms, sizeof(elms));
+/**
+ * Marks columns [begin, end) of row y for upload.
+ */
+static void markDirty(BgState *bg, unsigned y, unsigned begin, unsigned end) noexcept {
+	auto &span = bg->dirtyRows[y];
+	span.begin = ox::min(span.begin, static_cast<uint16_t>(begin));
+	span.end = ox::max(span.end, static_cast<uint16_t>(end));
+	bg->dirty = true;
 }
 
-static void sendVbo(const Background &bg) noexcept {
-	// vbo
-	glBindBuffer(GL_ARRAY_BUFFER, bg.vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(bg.bgVertices), &bg.bgVertices, GL_DYNAMIC_DRAW);
+static void markDirty(BgState *bg, unsigned x, unsigned y) noexcept {
+	markDirty(bg, y, x, x + 1);
 }
 
-static void sendEbo(const Background &bg) noexcept {
-	// ebo
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bg.ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(bg.bgElements), &bg.bgElements, GL_STATIC_DRAW);
+static void markAllDirty(BgState *bg) noexcept {
+	for (auto &span : bg->dirtyRows) {
+		span.begin = 0;
+		span.end = TileColumns;
+	}
+	bg->dirty = true;
 }
 
-static void initBackgroundBufferObjects(Context *ctx, Background *bg) noexcept {
-	for (auto x = 0u; x < TileColumns; ++x) {
-		for (auto y = 0u; y < TileRows; ++y) {
-			const auto i = bgVertexRow(x, y);
-			auto vbo = &bg->bgVertices[i * BgVertexVboLength];
-			auto ebo = &bg->bgElements[i * BgVertexEboLength];
-			setTileBufferObject(ctx, i * BgVertexVboRows, static_cast<float>(x), static_cast<float>(y), 0, vbo, ebo);
+/**
+ * Uploads the dirty spans of the given tile map with glBufferSubData.
+ * Spans that are contiguous in the tile map (a row dirty through its last
+ * column followed by a row dirty from its first) are merged into one upload.
+ * @return number of bytes uploaded
+ */
+static uint64_t sendDirtyTileMap(glutils::GLState *state, Background *layer) noexcept {
+	const auto bg = &layer->drawn;
+	if (!bg->dirty) {
+		return 0;
+	}
+	uint64_t sent = 0;
+	state->bindArrayBuffer(layer->tileMapBuff);
+	std::size_t pendingBegin = 0;
+	std::size_t pendingEnd = 0;
+	const auto flush = [state, bg, &sent, &pendingBegin, &pendingEnd] {
+		if (pendingBegin < pendingEnd) {
+			state->countCalls();
+			const auto offset = pendingBegin * sizeof(bg->tileMap[0]);
+			const auto len = (pendingEnd - pendingBegin) * sizeof(bg->tileMap[0]);
+			glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(len),
+			                &bg->tileMap[pendingBegin]);
+			sent += len;
+		}
+		pendingBegin = pendingEnd = 0;
+	};
+	for (auto y = 0u; y < TileRows; ++y) {
+		auto &span = bg->dirtyRows[y];
+		if (span.begin < span.end) {
+			const std::size_t begin = bgTileIdx(span.begin, y);
+			const std::size_t end = bgTileIdx(span.end, y);
+			if (pendingBegin < pendingEnd && pendingEnd == begin) {
+				pendingEnd = end;
+			} else {
+				flush();
+				pendingBegin = begin;
+				pendingEnd = end;
+			}
+			span = {};
 		}
 	}
+	flush();
+	bg->dirty = false;
+	return sent;
 }
 
 static glutils::GLVertexArray genVertexArrayObject() noexcept {
@@ -134,106 +433,594 @@ static glutils::GLBuffer genBuffer() noexcept {
 	return glutils::GLBuffer(buff);
 }
 
-static void initBackgroundBufferset(Context *ctx, GLuint shader, Background *bg) noexcept {
+static glutils::GLBuffer initBackgroundQuad() noexcept {
+	auto vbo = genBuffer();
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(BgQuadVertices), BgQuadVertices.data(), GL_STATIC_DRAW);
+	return vbo;
+}
+
+static void initBackgroundBufferset(glutils::Program *shader, GLuint quadVbo, Background *bg) noexcept {
 	// vao
 	bg->vao = genVertexArrayObject();
 	glBindVertexArray(bg->vao);
-	// vbo & ebo
-	bg->vbo = genBuffer();
-	bg->ebo = genBuffer();
-	initBackgroundBufferObjects(ctx, bg);
-	sendVbo(*bg);
-	sendEbo(*bg);
-	// vbo layout
-	auto posAttr = static_cast<GLuint>(glGetAttribLocation(shader, "position"));
+	// shared quad vbo
+	glBindBuffer(GL_ARRAY_BUFFER, quadVbo);
+	auto posAttr = static_cast<GLuint>(shader->attrib("vPosition"));
 	glEnableVertexAttribArray(posAttr);
 	glVertexAttribPointer(posAttr, 2, GL_FLOAT, GL_FALSE, BgVertexVboRowLength * sizeof(float), nullptr);
-	auto texCoordAttr = static_cast<GLuint>(glGetAttribLocation(shader, "vTexCoord"));
-	glEnableVertexAttribArray(texCoordAttr);
-	glVertexAttribPointer(texCoordAttr, 2, GL_FLOAT, GL_FALSE, BgVertexVboRowLength * sizeof(float),
-	                      ox::bit_cast<void*>(2 * sizeof(float)));
+	// tile map, advances once per tile instance
+	bg->tileMapBuff = genBuffer();
+	glBindBuffer(GL_ARRAY_BUFFER, bg->tileMapBuff);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(bg->drawn.tileMap), bg->drawn.tileMap.data(), GL_DYNAMIC_DRAW);
+	auto tileIdxAttr = static_cast<GLuint>(shader->attrib("vTileIdx"));
+	glEnableVertexAttribArray(tileIdxAttr);
+	glVertexAttribIPointer(tileIdxAttr, 1, GL_UNSIGNED_SHORT, sizeof(bg->drawn.tileMap[0]), nullptr);
+	glVertexAttribDivisor(tileIdxAttr, 1);
+}
+
+static void initSpriteBufferset(glutils::Program *shader, GLuint quadVbo, Sprites *sprites) noexcept {
+	sprites->vao = genVertexArrayObject();
+	glBindVertexArray(sprites->vao);
+	glBindBuffer(GL_ARRAY_BUFFER, quadVbo);
+	auto posAttr = static_cast<GLuint>(shader->attrib("vPosition"));
+	glEnableVertexAttribArray(posAttr);
+	glVertexAttribPointer(posAttr, 2, GL_FLOAT, GL_FALSE, BgVertexVboRowLength * sizeof(float), nullptr);
+	sprites->attrBuff = genBuffer();
+	glBindBuffer(GL_ARRAY_BUFFER, sprites->attrBuff);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(sprites->drawn.attrs), sprites->drawn.attrs.data(), GL_DYNAMIC_DRAW);
+	auto spriteAttr = static_cast<GLuint>(shader->attrib("vSprite"));
+	glEnableVertexAttribArray(spriteAttr);
+	glVertexAttribIPointer(spriteAttr, 4, GL_SHORT, sizeof(SpriteAttr), nullptr);
+	glVertexAttribDivisor(spriteAttr, 1);
+}
+
+static void markSpriteDirty(SpriteState *sprites, std::size_t begin, std::size_t end) noexcept {
+	sprites->dirtyBegin = ox::min(sprites->dirtyBegin, begin);
+	sprites->dirtyEnd = ox::max(sprites->dirtyEnd, end);
 }
 
-static glutils::GLTexture loadTexture(GLsizei w, GLsizei h, void *pixels) noexcept {
+static void markSpriteDirty(SpriteState *sprites, std::size_t slot) noexcept {
+	markSpriteDirty(sprites, slot, slot + 1);
+}
+
+/**
+ * @return number of bytes uploaded
+ */
+static uint64_t sendDirtySprites(glutils::GLState *state, Sprites *layer) noexcept {
+	const auto sprites = &layer->drawn;
+	if (sprites->dirtyBegin >= sprites->dirtyEnd) {
+		return 0;
+	}
+	const auto offset = sprites->dirtyBegin * sizeof(SpriteAttr);
+	const auto len = (sprites->dirtyEnd - sprites->dirtyBegin) * sizeof(SpriteAttr);
+	state->bindArrayBuffer(layer->attrBuff);
+	state->countCalls();
+	glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(len),
+	                &sprites->attrs[sprites->dirtyBegin]);
+	sprites->dirtyBegin = SpriteCount;
+	sprites->dirtyEnd = 0;
+	return len;
+}
+
+static glutils::GLTexture genTexture(glutils::GLState *state, unsigned unit, GLsizei w, GLsizei h) noexcept {
 	GLuint texId = 0;
 	glGenTextures(1, &texId);
 	glutils::GLTexture tex(texId);
 	tex.width = w;
 	tex.height = h;
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, tex.id);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tex.width, tex.height, 0,  GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	state->bindTexture(unit, tex.id);
+	// integer textures are only complete with nearest filtering
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	return ox::move(tex);
+	return tex;
+}
+
+static void initTextures(GlImplData *id) noexcept {
+	auto &state = id->state;
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	{
+		ox::Vector<uint8_t> blank(TileAtlas::Width * TileAtlas::Height);
+		ox_memset(blank.data(), 0, blank.size());
+		id->atlasTex = genTexture(&state, 0, TileAtlas::Width, TileAtlas::Height);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, TileAtlas::Width, TileAtlas::Height, 0,
+		             GL_RED_INTEGER, GL_UNSIGNED_BYTE, blank.data());
+	}
+	const std::array<uint16_t, LookupLength * SectionCount> blank = {};
+	id->paletteTex = genTexture(&state, 1, PaletteLength, SectionCount);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R16UI, PaletteLength, SectionCount, 0,
+	             GL_RED_INTEGER, GL_UNSIGNED_SHORT, blank.data());
+	id->lookupTex = genTexture(&state, 2, LookupLength, SectionCount);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R16UI, LookupLength, SectionCount, 0,
+	             GL_RED_INTEGER, GL_UNSIGNED_SHORT, blank.data());
+}
+
+/**
+ * Queues a write of w x h texels of type to the texture bound to unit.
+ */
+static void queueTexWrite(TexWrites *tw, unsigned unit, GLint x, GLint y, GLsizei w, GLsizei h,
+                          GLenum type, const void *texels, std::size_t len) noexcept {
+	if (tw->dataLen + len > tw->data.size()) {
+		tw->data.resize(ox::max(tw->data.size() * 2, tw->dataLen + len));
+	}
+	ox_memcpy(&tw->data[tw->dataLen], texels, len);
+	tw->writes.emplace_back(TexWrite{unit, x, y, w, h, type, tw->dataLen, len});
+	tw->dataLen += len;
+}
+
+static void clearTexWrites(TexWrites *tw) noexcept {
+	tw->writes.clear();
+	tw->dataLen = 0;
+}
+
+[[nodiscard]]
+static const glutils::GLTexture &texture(const GlImplData *id, unsigned unit) noexcept {
+	switch (unit) {
+		case 0:
+			return id->atlasTex;
+		case 1:
+			return id->paletteTex;
+		default:
+			return id->lookupTex;
+	}
+}
+
+/**
+ * @return number of bytes uploaded
+ */
+static uint64_t sendTexWrites(GlImplData *id) noexcept {
+	auto &tw = id->texWrites;
+	uint64_t sent = 0;
+	for (const auto &w : tw.writes) {
+		id->state.bindTexture(w.unit, texture(id, w.unit));
+		glTexSubImage2D(GL_TEXTURE_2D, 0, w.x, w.y, w.w, w.h, GL_RED_INTEGER, w.type, &tw.data[w.offset]);
+		id->state.countCalls();
+		sent += w.len;
+	}
+	clearTexWrites(&tw);
+	return sent;
+}
+
+/**
+ * Adds the tiles of a tile sheet to the atlas and points the section's
+ * lookup row at them, releasing the tiles of the section's previous sheet.
+ */
+static ox::Error loadSectionTiles(GlImplData *id, int section, const uint8_t *pixels, std::size_t tiles) noexcept {
+	if (tiles > LookupLength) {
+		return OxError(1, "Tile sheet has too many tiles");
+	}
+	auto &atlas = id->atlas;
+	ox::Vector<uint16_t> slots(tiles);
+	for (std::size_t i = 0; i < tiles; ++i) {
+		bool isNew = false;
+		const auto slot = atlas.add(pixels + i * TileAtlas::TileBytes, &isNew);
+		if (slot.error) {
+			for (std::size_t j = 0; j < i; ++j) {
+				atlas.release(slots[j]);
+			}
+			return slot.error;
+		}
+		slots[i] = slot.value;
+		if (isNew) {
+			const auto x = (slot.value % TileAtlas::Columns) * TileAtlas::TileWidth;
+			const auto y = (slot.value / TileAtlas::Columns) * TileAtlas::TileHeight;
+			queueTexWrite(&id->next.texWrites, 0, static_cast<GLint>(x), static_cast<GLint>(y),
+			              TileAtlas::TileWidth, TileAtlas::TileHeight, GL_UNSIGNED_BYTE,
+			              atlas.tile(slot.value), TileAtlas::TileBytes);
+		}
+	}
+	auto &sectionSlots = id->sectionSlots[static_cast<std::size_t>(section)];
+	for (const auto slot : sectionSlots) {
+		atlas.release(slot);
+	}
+	std::array<uint16_t, LookupLength> lookup = {};
+	ox_memcpy(lookup.data(), slots.data(), slots.size() * sizeof(uint16_t));
+	sectionSlots = ox::move(slots);
+	queueTexWrite(&id->next.texWrites, 2, 0, section, LookupLength, 1, GL_UNSIGNED_SHORT,
+	              lookup.data(), sizeof(lookup));
+	oxTracef("nostalgia::core::gfx::gl", "section {}: {} tiles, {} atlas slots free", section, tiles, atlas.freeSlots());
+	return OxError(0);
+}
+
+static void loadSectionPalette(GlImplData *id, int section, const Color16 *colors, std::size_t len) noexcept {
+	std::array<Color16, PaletteLength> pal = {};
+	ox_memcpy(pal.data(), colors, ox::min(len, pal.size()) * sizeof(Color16));
+	queueTexWrite(&id->next.texWrites, 1, 0, section, PaletteLength, 1, GL_UNSIGNED_SHORT,
+	              pal.data(), sizeof(pal));
 }
 
 static void tickFps(GlImplData *id) noexcept {
 	++id->draws;
+	id->windowUploadBytes += id->frameUploadBytes;
+	id->windowGlCalls += id->state.calls();
 	if (id->draws >= 500) {
 		using namespace std::chrono;
-		const auto now = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
-		const auto duration = static_cast<double>(now - id->prevFpsCheckTime) / 1000.0;
-		const auto fps = static_cast<int>(static_cast<double>(id->draws) / duration);
+		const auto now = steady_clock::now();
+		const auto elapsed = duration_cast<duration<double>>(now - id->prevFpsCheckTime).count();
+		const auto fps = static_cast<int>(static_cast<double>(id->draws) / elapsed);
+		const auto uploadPerFrame = id->windowUploadBytes / id->draws;
+		const auto glCallsPerFrame = id->windowGlCalls / id->draws;
 		if constexpr(config::UserlandFpsPrint) {
-			oxInfof("FPS: {}", fps);
+			oxInfof("FPS: {}, upload: {} B/frame", fps, uploadPerFrame);
 		}
 		oxTracef("nostalgia::core::gfx::gl::fps", "FPS: {}", fps);
+		oxTracef("nostalgia::core::gfx::gl::upload", "upload: {} B/frame, {} B last frame",
+		         uploadPerFrame, id->frameUploadBytes);
+		oxTracef("nostalgia::core::gfx::gl::calls", "GL calls: {}/frame, {} last frame",
+		         glCallsPerFrame, id->state.calls());
+		const auto frame = id->stats.percentiles(&FrameSample::frameUs);
+		const auto draw = id->stats.percentiles(&FrameSample::drawUs);
+		const auto gpu = id->stats.percentiles(&FrameSample::gpuUs);
+		oxTracef("nostalgia::core::gfx::gl::frametime",
+		         "frame us p50/p95/p99: {}/{}/{}, draw: {}/{}/{}, GPU: {}/{}/{}",
+		         frame.p50, frame.p95, frame.p99, draw.p50, draw.p95, draw.p99, gpu.p50, gpu.p95, gpu.p99);
 		id->prevFpsCheckTime = now;
 		id->draws = 0;
+		id->windowUploadBytes = 0;
+		id->windowGlCalls = 0;
+	}
+	id->frameUploadBytes = 0;
+	id->frameDrawCalls = 0;
+	id->state.resetCalls();
+}
+
+[[nodiscard]]
+static bool glExtensionSupported(const char *name) noexcept {
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; ++i) {
+		const auto ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+		if (ext && ox_strcmp(ext, name) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @return glGetQueryObjectui64v, or null if the context has no timer queries
+ */
+[[nodiscard]]
+static GetQueryObjectui64v loadTimerQuery(GlProcLookup glProc) noexcept {
+	if (!glProc) {
+		return nullptr;
+	}
+	if (glExtensionSupported("GL_ARB_timer_query")) {
+		return reinterpret_cast<GetQueryObjectui64v>(glProc("glGetQueryObjectui64v"));
 	}
+	if (glExtensionSupported("GL_EXT_disjoint_timer_query")) {
+		return reinterpret_cast<GetQueryObjectui64v>(glProc("glGetQueryObjectui64vEXT"));
+	}
+	return nullptr;
 }
 
-static void drawBackground(Background *bg) noexcept {
-	if (bg->enabled) {
-		glBindVertexArray(bg->vao);
-		if (bg->updated) {
-			bg->updated = false;
-			renderer::sendVbo(*bg);
+/**
+ * Collects the result of the query last issued in the current frame's query
+ * slot, if available, and starts timing the current frame with it.
+ * Never blocks on the GPU, a result still pending after GpuQueryCount frames
+ * is dropped.
+ */
+static void beginGpuTimer(GlImplData *id, uint64_t frame) noexcept {
+	if (!id->getQueryObjectui64v) {
+		return;
+	}
+	const auto slot = static_cast<std::size_t>(frame % GpuQueryCount);
+	const auto query = id->gpuQueries[slot];
+	if (id->gpuQueryPending[slot]) {
+		GLuint available = 0;
+		glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available) {
+			GLuint64 ns = 0;
+			id->getQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+			if (const auto sample = id->stats.frame(id->gpuQueryFrames[slot])) {
+				sample->gpuUs = ns / 1000;
+			}
 		}
-		glBindTexture(GL_TEXTURE_2D, bg->tex);
-		glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(bg->bgElements.size()), GL_UNSIGNED_INT, nullptr);
+		id->state.countCalls(available ? 2 : 1);
+	}
+	glBeginQuery(GL_TIME_ELAPSED, query);
+	id->state.countCalls();
+	id->gpuQueryFrames[slot] = frame;
+	id->gpuQueryPending[slot] = true;
+}
+
+static void endGpuTimer(GlImplData *id) noexcept {
+	if (!id->getQueryObjectui64v) {
+		return;
 	}
+	glEndQuery(GL_TIME_ELAPSED);
+	id->state.countCalls();
 }
 
-static void drawBackgrounds(GlImplData *id) noexcept {
+static void plotField(const char *label, const FrameStats &stats, uint64_t FrameSample::*field) noexcept {
+	std::array<float, FrameStats::Capacity> vals;
+	const auto n = stats.size();
+	for (std::size_t i = 0; i < n; ++i) {
+		vals[i] = static_cast<float>(stats[i].*field) / 1000.0f;
+	}
+	const auto p = stats.percentiles(field);
+	ImGui::Text("%-6s p50 %6.2f  p95 %6.2f  p99 %6.2f ms", label,
+	            static_cast<double>(p.p50) / 1000.0, static_cast<double>(p.p95) / 1000.0,
+	            static_cast<double>(p.p99) / 1000.0);
+	ImGui::PlotLines(label, vals.data(), static_cast<int>(n), 0, nullptr, 0.0f, 33.3f, ImVec2(0, 32));
+}
+
+static void drawStatsOverlay(GlImplData *id) noexcept {
+	ImGui_ImplOpenGL3_NewFrame();
+	ImGui::NewFrame();
+	constexpr auto flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize |
+	                       ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing |
+	                       ImGuiWindowFlags_NoNav;
+	ImGui::SetNextWindowPos(ImVec2(8, 8), ImGuiCond_Always);
+	ImGui::SetNextWindowBgAlpha(0.6f);
+	if (ImGui::Begin("Frame Stats", nullptr, flags)) {
+		const auto &stats = id->stats;
+		const auto frame = stats.percentiles(&FrameSample::frameUs);
+		ImGui::Text("FPS (p50): %.1f", frame.p50 ? 1000000.0 / static_cast<double>(frame.p50) : 0.0);
+		ImGui::Separator();
+		plotField("frame", stats, &FrameSample::frameUs);
+		plotField("event", stats, &FrameSample::eventUs);
+		plotField("draw", stats, &FrameSample::drawUs);
+		plotField("swap", stats, &FrameSample::swapUs);
+		plotField("GPU", stats, &FrameSample::gpuUs);
+		ImGui::Separator();
+		const auto upload = stats.percentiles(&FrameSample::uploadBytes);
+		const auto calls = stats.percentiles(&FrameSample::glCalls);
+		const auto draws = stats.percentiles(&FrameSample::drawCalls);
+		ImGui::Text("upload B  p50 %llu  p95 %llu  p99 %llu", static_cast<unsigned long long>(upload.p50),
+		            static_cast<unsigned long long>(upload.p95), static_cast<unsigned long long>(upload.p99));
+		ImGui::Text("GL calls  p50 %llu  p95 %llu  p99 %llu", static_cast<unsigned long long>(calls.p50),
+		            static_cast<unsigned long long>(calls.p95), static_cast<unsigned long long>(calls.p99));
+		ImGui::Text("draws     p50 %llu  p95 %llu  p99 %llu", static_cast<unsigned long long>(draws.p50),
+		            static_cast<unsigned long long>(draws.p95), static_cast<unsigned long long>(draws.p99));
+		if (heapAllocationsCounted()) {
+			const auto allocs = stats.percentiles(&FrameSample::heapAllocs);
+			ImGui::Text("heap new  p50 %llu  p95 %llu  p99 %llu", static_cast<unsigned long long>(allocs.p50),
+			            static_cast<unsigned long long>(allocs.p95), static_cast<unsigned long long>(allocs.p99));
+		}
+		const auto latency = stats.percentiles(&FrameSample::inputLatencyUs, true);
+		ImGui::Text("input us  p50 %llu  p95 %llu  p99 %llu", static_cast<unsigned long long>(latency.p50),
+		            static_cast<unsigned long long>(latency.p95), static_cast<unsigned long long>(latency.p99));
+		ImGui::Text("arena     peak %llu B  cap %llu B  overflows %llu", static_cast<unsigned long long>(id->arenaPeak),
+		            static_cast<unsigned long long>(id->arenaCapacity), static_cast<unsigned long long>(id->arenaOverflows));
+	}
+	ImGui::End();
+	ImGui::Render();
+	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+	// ImGui changes program, buffer, VAO, and texture bindings behind GLState
+	id->state.invalidate();
+}
+
+/**
+ * Sets a uniform of the current program, unless it already holds val.
+ */
+static void setUniform(glutils::GLState *state, GLint loc, float *cache, float val) noexcept {
+	if (*cache != val) {
+		glUniform1f(loc, val);
+		*cache = val;
+		state->countCalls();
+	}
+}
+
+static void setUniform(glutils::GLState *state, GLint loc, int *cache, int val) noexcept {
+	if (*cache != val) {
+		glUniform1i(loc, val);
+		*cache = val;
+		state->countCalls();
+	}
+}
+
+static void setUniform(glutils::GLState *state, GLint loc, std::array<float, 4> *cache,
+                       const std::array<float, 4> &val, bool matrix) noexcept {
+	if (*cache != val) {
+		if (matrix) {
+			glUniformMatrix2fv(loc, 1, GL_FALSE, val.data());
+		} else {
+			glUniform4fv(loc, 1, val.data());
+		}
+		*cache = val;
+		state->countCalls();
+	}
+}
+
+/**
+ * Sets the uniforms placing the layer's tiles on screen.
+ * @param screenWidth width of the screen in pixels of the 20 tile high virtual screen
+ * @return false if the layer's matrix is singular, leaving nothing to draw
+ */
+static bool setBgTransformUniforms(GlImplData *id, const BgState &bg, float screenWidth) noexcept {
+	constexpr auto One = static_cast<float>(BgTransform::One);
+	const auto &t = bg.transform;
+	const auto pa = static_cast<float>(t.pa) / One;
+	const auto pb = static_cast<float>(t.pb) / One;
+	const auto pc = static_cast<float>(t.pc) / One;
+	const auto pd = static_cast<float>(t.pd) / One;
+	const auto det = pa * pd - pb * pc;
+	if (det == 0) {
+		return false;
+	}
+	const auto x = static_cast<float>(t.x) / One;
+	const auto y = static_cast<float>(t.y) / One;
+	const auto cx = screenWidth / 2;
+	// the virtual screen is 20 tiles high
+	constexpr auto cy = 20.0f * 8 / 2;
+	// GL matrices are column major
+	const std::array<float, 4> mapToScreen = {pd / det, -pc / det, -pb / det, pa / det};
+	const std::array<float, 4> origin = {x, y, pa * cx + pb * cy + x, pc * cx + pd * cy + y};
+	setUniform(&id->state, id->uniformMapToScreen, &id->mapToScreen, mapToScreen, true);
+	setUniform(&id->state, id->uniformOrigin, &id->origin, origin, false);
+	setUniform(&id->state, id->uniformWrap, &id->wrap, bg.wrap ? 1 : 0);
+	return true;
+}
+
+static void drawBackground(GlImplData *id, int section, Background *bg, float screenWidth) noexcept {
+	if (bg->drawn.enabled && setBgTransformUniforms(id, bg->drawn, screenWidth)) {
+		auto &state = id->state;
+		id->frameUploadBytes += sendDirtyTileMap(&state, bg);
+		setUniform(&state, id->uniformSection, &id->section, section);
+		state.bindVertexArray(bg->vao);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, BgVertexVboRows, TileCount);
+		state.countCalls();
+		++id->frameDrawCalls;
+	}
+}
+
+static void drawSprites(Context *ctx, GlImplData *id) noexcept {
+	auto &sprites = id->sprites;
+	if (!sprites.drawn.loaded) {
+		return;
+	}
+	auto &state = id->state;
+	id->frameUploadBytes += sendDirtySprites(&state, &sprites);
+	state.useProgram(id->spriteShader);
+	const auto [sw, sh] = getScreenSize(ctx);
+	constexpr float ymod = 2.0f / 20.0f;
+	const float xmod = ymod * static_cast<float>(sh) / static_cast<float>(sw);
+	setUniform(&state, id->uniformSpriteXScale, &id->spriteXScale, xmod);
+	state.bindVertexArray(sprites.vao);
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, BgVertexVboRows, SpriteCount);
+	state.countCalls();
+	++id->frameDrawCalls;
+}
+
+static void drawBackgrounds(Context *ctx, GlImplData *id) noexcept {
 	// load background shader and its uniforms
-	glUseProgram(id->bgShader);
-	const auto uniformTileHeight = static_cast<GLint>(glGetUniformLocation(id->bgShader, "vTileHeight"));
-	for (auto &bg : id->backgrounds) {
-		glUniform1f(uniformTileHeight, 1.0f / static_cast<float>(bg.tex.height / 8));
-		drawBackground(&bg);
+	id->state.useProgram(id->bgShader);
+	const auto [sw, sh] = getScreenSize(ctx);
+	constexpr float ymod = 2.0f / 20.0f;
+	const float xmod = ymod * static_cast<float>(sh) / static_cast<float>(sw);
+	setUniform(&id->state, id->uniformXScale, &id->xScale, xmod);
+	// every layer draws from the same atlas, palette, and lookup textures
+	id->state.bindTexture(0, id->atlasTex);
+	id->state.bindTexture(1, id->paletteTex);
+	id->state.bindTexture(2, id->lookupTex);
+	const auto screenWidth = 16.0f / xmod;
+	for (auto i = 0u; i < id->backgrounds.size(); ++i) {
+		drawBackground(id, static_cast<int>(i), &id->backgrounds[i], screenWidth);
 	}
 }
 
-ox::Error init(Context *ctx) noexcept {
+ox::Error init(Context *ctx, GlProcLookup glProc) noexcept {
 	constexpr auto GlslVersion = "#version 150";
 	const auto id = new GlImplData;
 	ctx->setRendererData(id);
-	const auto vshad = ox::sfmt(bgvshad, GlslVersion);
-	const auto fshad = ox::sfmt(bgfshad, GlslVersion);
-	oxReturnError(glutils::buildShaderProgram(vshad.c_str(), fshad.c_str()).moveTo(&id->bgShader));
+	const auto vshad = ox::sfmt(bgvshad, GlslVersion, TileColumns);
+	const auto fshad = ox::sfmt(bgfshad, GlslVersion, TileAtlas::Columns);
+	oxReturnError(glutils::buildProgram(vshad.c_str(), fshad.c_str()).moveTo(&id->bgShader));
+	const auto spriteVshad = ox::sfmt(spritevshad, GlslVersion);
+	const auto spriteFshad = ox::sfmt(spritefshad, GlslVersion, TileAtlas::Columns, LookupLength, SpriteSection);
+	oxReturnError(glutils::buildProgram(spriteVshad.c_str(), spriteFshad.c_str()).moveTo(&id->spriteShader));
+	id->uniformSection = id->bgShader.uniform("vSection");
+	id->uniformXScale = id->bgShader.uniform("vXScale");
+	id->uniformMapToScreen = id->bgShader.uniform("vMapToScreen");
+	id->uniformOrigin = id->bgShader.uniform("vOrigin");
+	id->uniformWrap = id->bgShader.uniform("vWrap");
+	glUseProgram(id->bgShader);
+	glUniform1i(id->bgShader.uniform("atlas"), 0);
+	glUniform1i(id->bgShader.uniform("palette"), 1);
+	glUniform1i(id->bgShader.uniform("lookup"), 2);
+	id->bgQuadVbo = initBackgroundQuad();
 	for (auto &bg : id->backgrounds) {
-		initBackgroundBufferset(ctx, id->bgShader, &bg);
+		initBackgroundBufferset(&id->bgShader, id->bgQuadVbo, &bg);
+	}
+	id->uniformSpriteXScale = id->spriteShader.uniform("vXScale");
+	glUseProgram(id->spriteShader);
+	glUniform1i(id->spriteShader.uniform("atlas"), 0);
+	glUniform1i(id->spriteShader.uniform("palette"), 1);
+	glUniform1i(id->spriteShader.uniform("lookup"), 2);
+	initSpriteBufferset(&id->spriteShader, id->bgQuadVbo, &id->sprites);
+	glClearColor(0, 0, 0, 1);
+	// init bound objects directly
+	id->state.invalidate();
+	initTextures(id);
+	id->getQueryObjectui64v = loadTimerQuery(glProc);
+	if (id->getQueryObjectui64v) {
+		glGenQueries(GpuQueryCount, id->gpuQueries.data());
+	} else {
+		oxTrace("nostalgia::core::gfx::gl", "No timer queries, GPU timing is off");
 	}
+	id->prevFpsCheckTime = std::chrono::steady_clock::now();
+	id->prevDrawStart = id->prevFpsCheckTime;
 	ImGui_ImplOpenGL3_Init(GlslVersion);
 	return OxError(0);
 }
 
+std::mutex &romMutex(Context *ctx) noexcept {
+	return ctx->rendererData<GlImplData>()->romMtx;
+}
+
+TileSheetLoader *tileSheetLoader(Context *ctx) noexcept {
+	const auto id = ctx->rendererData<GlImplData>();
+	if (!id->tileSheetLoader) {
+		id->tileSheetLoader = ox::UniquePtr<TileSheetLoader>(new TileSheetLoader(ctx, &id->romMtx));
+	}
+	return id->tileSheetLoader.get();
+}
+
 ox::Error shutdown(Context *ctx) noexcept {
 	const auto id = ctx->rendererData<GlImplData>();
+	ImGui_ImplOpenGL3_Shutdown();
+	if (id->getQueryObjectui64v) {
+		glDeleteQueries(GpuQueryCount, id->gpuQueries.data());
+	}
 	ctx->setRendererData(nullptr);
 	delete id;
 	return OxError(0);
 }
 
-ox::Error loadBgTexture(Context *ctx, int section, void *pixels, int w, int h) noexcept {
+void recordFrameTimes(Context *ctx, uint64_t eventUs, uint64_t swapUs, uint64_t inputLatencyUs) noexcept {
+	const auto id = ctx->rendererData<GlImplData>();
+	if (const auto sample = id->stats.frame(id->stats.frames() - 1)) {
+		sample->eventUs = eventUs;
+		sample->swapUs = swapUs;
+		sample->inputLatencyUs = inputLatencyUs;
+		const auto allocs = heapAllocations();
+		sample->heapAllocs = allocs - id->prevHeapAllocs;
+		id->prevHeapAllocs = allocs;
+	}
+}
+
+const FrameStats &frameStats(Context *ctx) noexcept {
+	return ctx->rendererData<GlImplData>()->stats;
+}
+
+void setFrameStatsOverlay(Context *ctx, bool enabled) noexcept {
+	ctx->rendererData<GlImplData>()->next.statsOverlay = enabled;
+}
+
+bool frameStatsOverlay(Context *ctx) noexcept {
+	return ctx->rendererData<GlImplData>()->next.statsOverlay;
+}
+
+ox::Error loadBgTexture(Context *ctx, int section, const uint8_t *pixels, int w, int h) noexcept {
 	oxTracef("nostalgia::core::gfx::gl", "loadBgTexture: { section: {}, w: {}, h: {} }", section, w, h);
 	const auto &id = ctx->rendererData<GlImplData>();
-	auto &tex = id->backgrounds[static_cast<std::size_t>(section)].tex;
-	tex = loadTexture(w, h, pixels);
+	const auto tiles = static_cast<std::size_t>(w * h) / TileAtlas::TileBytes;
+	return loadSectionTiles(id, section, pixels, tiles);
+}
+
+ox::Error loadBgPalette(Context *ctx, int section, const Color16 *colors, std::size_t len) noexcept {
+	oxTracef("nostalgia::core::gfx::gl", "loadBgPalette: { section: {}, len: {} }", section, len);
+	const auto &id = ctx->rendererData<GlImplData>();
+	loadSectionPalette(id, section, colors, len);
+	return OxError(0);
+}
+
+ox::Error loadSpriteTexture(Context *ctx, const uint8_t *pixels, int w, int h) noexcept {
+	oxTracef("nostalgia::core::gfx::gl", "loadSpriteTexture: { w: {}, h: {} }", w, h);
+	const auto &id = ctx->rendererData<GlImplData>();
+	const auto tiles = static_cast<std::size_t>(w * h) / TileAtlas::TileBytes;
+	oxReturnError(loadSectionTiles(id, SpriteSection, pixels, tiles));
+	id->next.sprites.loaded = true;
+	return OxError(0);
+}
+
+ox::Error loadSpritePalette(Context *ctx, const Color16 *colors, std::size_t len) noexcept {
+	oxTracef("nostalgia::core::gfx::gl", "loadSpritePalette: { len: {} }", len);
+	const auto &id = ctx->rendererData<GlImplData>();
+	loadSectionPalette(id, SpriteSection, colors, len);
 	return OxError(0);
 }
 
@@ -242,58 +1029,211 @@ ox::Error loadBgTexture(Context *ctx, int section, void *pixels, int w, int h) n
 uint8_t bgStatus(Context *ctx) noexcept {
 	const auto &id = ctx->rendererData<renderer::GlImplData>();
 	uint8_t out = 0;
-	for (unsigned i = 0; i < id->backgrounds.size(); ++i) {
-		out |= id->backgrounds[i].enabled << i;
+	for (unsigned i = 0; i < id->next.backgrounds.size(); ++i) {
+		out |= id->next.backgrounds[i].enabled << i;
 	}
 	return out;
 }
 
 void setBgStatus(Context *ctx, uint32_t status) noexcept {
 	const auto &id = ctx->rendererData<renderer::GlImplData>();
-	for (unsigned i = 0; i < id->backgrounds.size(); ++i) {
-		id->backgrounds[i].enabled = (status >> i) & 1;
+	for (unsigned i = 0; i < id->next.backgrounds.size(); ++i) {
+		id->next.backgrounds[i].enabled = (status >> i) & 1;
 	}
 }
 
 bool bgStatus(Context *ctx, unsigned bg) noexcept {
 	const auto &id = ctx->rendererData<renderer::GlImplData>();
-	return id->backgrounds[bg].enabled;
+	return id->next.backgrounds[bg].enabled;
 }
 
 void setBgStatus(Context *ctx, unsigned bg, bool status) noexcept {
 	const auto &id = ctx->rendererData<renderer::GlImplData>();
-	id->backgrounds[bg].enabled = status;
+	id->next.backgrounds[bg].enabled = status;
 }
 
 
-void draw(Context *ctx) noexcept {
-	const auto id = ctx->rendererData<renderer::GlImplData>();
-	renderer::tickFps(id);
+namespace renderer {
+
+static void publishBackground(BgState *next, BgState *drawn) noexcept {
+	drawn->enabled = next->enabled;
+	drawn->clear = next->clear;
+	drawn->transform = next->transform;
+	drawn->wrap = next->wrap;
+	if (!next->dirty) {
+		return;
+	}
+	for (auto y = 0u; y < TileRows; ++y) {
+		auto &span = next->dirtyRows[y];
+		if (span.begin < span.end) {
+			const auto i = bgTileIdx(span.begin, y);
+			ox_memcpy(&drawn->tileMap[i], &next->tileMap[i], (span.end - span.begin) * sizeof(next->tileMap[0]));
+			markDirty(drawn, y, span.begin, span.end);
+			span = {};
+		}
+	}
+	next->dirty = false;
+}
+
+static void publishSprites(SpriteState *next, SpriteState *drawn) noexcept {
+	drawn->loaded = next->loaded;
+	if (next->dirtyBegin >= next->dirtyEnd) {
+		return;
+	}
+	ox_memcpy(&drawn->attrs[next->dirtyBegin], &next->attrs[next->dirtyBegin],
+	          (next->dirtyEnd - next->dirtyBegin) * sizeof(SpriteAttr));
+	markSpriteDirty(drawn, next->dirtyBegin, next->dirtyEnd);
+	next->dirtyBegin = SpriteCount;
+	next->dirtyEnd = 0;
+}
+
+static void publishTexWrites(TexWrites *next, TexWrites *drawn) noexcept {
+	if (drawn->writes.empty()) {
+		// trade buffers, so both keep their capacity
+		auto tmp = ox::move(*drawn);
+		*drawn = ox::move(*next);
+		*next = ox::move(tmp);
+	} else {
+		// the last publish was never drawn
+		for (const auto &w : next->writes) {
+			queueTexWrite(drawn, w.unit, w.x, w.y, w.w, w.h, w.type, &next->data[w.offset], w.len);
+		}
+	}
+	clearTexWrites(next);
+}
+
+void publishFrame(Context *ctx) noexcept {
+	const auto id = ctx->rendererData<GlImplData>();
+	// tile sheets finished loading since the last frame go out with this one
+	if (id->tileSheetLoader) {
+		id->tileSheetLoader->uploadReady();
+	}
+	for (auto i = 0u; i < id->backgrounds.size(); ++i) {
+		publishBackground(&id->next.backgrounds[i], &id->backgrounds[i].drawn);
+	}
+	publishSprites(&id->next.sprites, &id->sprites.drawn);
+	publishTexWrites(&id->next.texWrites, &id->texWrites);
+	id->statsOverlay = id->next.statsOverlay;
+	const auto arena = ctx->frameArena();
+	id->arenaPeak = arena->peak();
+	id->arenaCapacity = arena->capacity();
+	id->arenaOverflows = arena->overflows();
+}
+
+void drawPublished(Context *ctx) noexcept {
+	using namespace std::chrono;
+	const auto id = ctx->rendererData<GlImplData>();
+	const auto start = steady_clock::now();
+	const auto frame = id->stats.frames();
+	const auto sample = id->stats.push();
+	sample->frameUs = static_cast<uint64_t>(duration_cast<microseconds>(start - id->prevDrawStart).count());
+	id->prevDrawStart = start;
+	beginGpuTimer(id, frame);
+	id->frameUploadBytes += sendTexWrites(id);
 	// clear screen
-	glClearColor(0, 0, 0, 1);
 	glClear(GL_COLOR_BUFFER_BIT);
+	id->state.countCalls();
 	// render
-	renderer::drawBackgrounds(id);
+	drawBackgrounds(ctx, id);
+	drawSprites(ctx, id);
+	endGpuTimer(id);
+	sample->uploadBytes = id->frameUploadBytes;
+	sample->glCalls = id->state.calls();
+	sample->drawCalls = id->frameDrawCalls;
+	sample->drawUs = static_cast<uint64_t>(duration_cast<microseconds>(steady_clock::now() - start).count());
+	if (id->statsOverlay) {
+		drawStatsOverlay(id);
+	}
+	tickFps(id);
+}
+
+}
+
+void draw(Context *ctx) noexcept {
+	renderer::publishFrame(ctx);
+	renderer::drawPublished(ctx);
 }
 
 void clearTileLayer(Context *ctx, int layer) noexcept {
 	const auto id = ctx->rendererData<renderer::GlImplData>();
-	auto &bg = id->backgrounds[static_cast<std::size_t>(layer)];
-	initBackgroundBufferObjects(ctx, &bg);
-	bg.updated = true;
+	auto &bg = id->next.backgrounds[static_cast<std::size_t>(layer)];
+	if (bg.clear) {
+		return;
+	}
+	bg.tileMap.fill(0);
+	renderer::markAllDirty(&bg);
+	bg.clear = true;
 }
 
-void hideSprite(Context*, unsigned) noexcept {
+void setBgScroll(Context *ctx, int layer, int x, int y) noexcept {
+	const auto id = ctx->rendererData<renderer::GlImplData>();
+	auto &t = id->next.backgrounds[static_cast<std::size_t>(layer)].transform;
+	t.x = x * BgTransform::One;
+	t.y = y * BgTransform::One;
 }
 
-void setSprite(Context*,
-               unsigned,
-               unsigned,
-               unsigned,
-               unsigned,
-               unsigned,
-               unsigned,
-               unsigned) noexcept {
+void setBgTransform(Context *ctx, int layer, const BgTransform &transform) noexcept {
+	const auto id = ctx->rendererData<renderer::GlImplData>();
+	id->next.backgrounds[static_cast<std::size_t>(layer)].transform = transform;
+}
+
+BgTransform bgTransform(Context *ctx, int layer) noexcept {
+	const auto id = ctx->rendererData<renderer::GlImplData>();
+	return id->next.backgrounds[static_cast<std::size_t>(layer)].transform;
+}
+
+void setBgWrap(Context *ctx, int layer, bool wrap) noexcept {
+	const auto id = ctx->rendererData<renderer::GlImplData>();
+	id->next.backgrounds[static_cast<std::size_t>(layer)].wrap = wrap;
+}
+
+void hideSprite(Context *ctx, unsigned idx) noexcept {
+	oxAssert(idx < static_cast<unsigned>(renderer::SpriteCount), "Sprite index out of range");
+	if (idx >= static_cast<unsigned>(renderer::SpriteCount)) [[unlikely]] {
+		return;
+	}
+	const auto id = ctx->rendererData<renderer::GlImplData>();
+	auto &sprites = id->next.sprites;
+	const auto slot = renderer::SpriteCount - 1 - idx;
+	sprites.attrs[slot].flags = 0;
+	renderer::markSpriteDirty(&sprites, slot);
+}
+
+void setSprite(Context *ctx,
+               unsigned idx,
+               unsigned x,
+               unsigned y,
+               unsigned tileIdx,
+               unsigned spriteShape,
+               unsigned spriteSize,
+               unsigned flipX) noexcept {
+	oxAssert(idx < static_cast<unsigned>(renderer::SpriteCount), "Sprite index out of range");
+	if (idx >= static_cast<unsigned>(renderer::SpriteCount)) [[unlikely]] {
+		return;
+	}
+	const auto id = ctx->rendererData<renderer::GlImplData>();
+	auto &sprites = id->next.sprites;
+	const auto slot = renderer::SpriteCount - 1 - idx;
+	const auto &dim = renderer::SpriteDimensions[spriteShape % 3][spriteSize & 3];
+	// wrap coordinates like the GBA's 9 bit x and 8 bit y, so sprites
+	// positioned just before 0 show partially at the left and top edges
+	auto sx = static_cast<int>(x & 0x1ff);
+	auto sy = static_cast<int>(y & 0xff);
+	if (sx >= 512 - 64) {
+		sx -= 512;
+	}
+	if (sy >= 256 - 64) {
+		sy -= 256;
+	}
+	auto &attr = sprites.attrs[slot];
+	attr.x = static_cast<int16_t>(sx);
+	attr.y = static_cast<int16_t>(sy);
+	attr.tileIdx = static_cast<uint16_t>(tileIdx);
+	attr.flags = static_cast<uint16_t>(dim[0] | (dim[1] << 4) | renderer::SpriteFlag_Enabled);
+	if (flipX) {
+		attr.flags |= renderer::SpriteFlag_FlipX;
+	}
+	renderer::markSpriteDirty(&sprites, slot);
 }
 
 void setTile(Context *ctx, int layer, int column, int row, uint8_t tile) noexcept {
@@ -301,12 +1241,54 @@ void setTile(Context *ctx, int layer, int column, int row, uint8_t tile) noexcep
 	const auto z = static_cast<unsigned>(layer);
 	const auto y = static_cast<unsigned>(row);
 	const auto x = static_cast<unsigned>(column);
-	const auto i = renderer::bgVertexRow(x, y);
-	auto &bg = id->backgrounds[z];
-	auto vbo = &bg.bgVertices[i * renderer::BgVertexVboLength];
-	auto ebo = &bg.bgElements[i * renderer::BgVertexEboLength];
-	renderer::setTileBufferObject(ctx, i * renderer::BgVertexVboRows, static_cast<float>(x), static_cast<float>(y), tile, vbo, ebo);
-	bg.updated = true;
+	const auto i = renderer::bgTileIdx(x, y);
+	auto &bg = id->next.backgrounds[z];
+	bg.tileMap[i] = tile;
+	bg.clear = bg.clear && tile == 0;
+	renderer::markDirty(&bg, x, y);
+}
+
+void blitTileRect(Context *ctx, int layer, int column, int row, int width, int height,
+                  const uint8_t *tiles, int stride) noexcept {
+	const auto id = ctx->rendererData<renderer::GlImplData>();
+	renderer::TileRect r{column, row, width, height};
+	if (!renderer::clipTileRect(&r, renderer::TileColumns, renderer::TileRows)) {
+		return;
+	}
+	auto &bg = id->next.backgrounds[static_cast<std::size_t>(layer)];
+	const auto x = static_cast<unsigned>(r.column);
+	auto nonZero = 0u;
+	for (auto y = 0; y < r.height; ++y) {
+		const auto src = tiles + (r.srcY + y) * stride + r.srcX;
+		const auto mapY = static_cast<unsigned>(r.row + y);
+		// the store holds 16 bit indices, so rows are widened rather than copied
+		const auto dst = &bg.tileMap[renderer::bgTileIdx(x, mapY)];
+		for (auto i = 0; i < r.width; ++i) {
+			dst[i] = src[i];
+			nonZero |= src[i];
+		}
+		renderer::markDirty(&bg, mapY, x, x + static_cast<unsigned>(r.width));
+	}
+	bg.clear = bg.clear && nonZero == 0;
+}
+
+void fillTileRect(Context *ctx, int layer, int column, int row, int width, int height, uint8_t tile) noexcept {
+	const auto id = ctx->rendererData<renderer::GlImplData>();
+	renderer::TileRect r{column, row, width, height};
+	if (!renderer::clipTileRect(&r, renderer::TileColumns, renderer::TileRows)) {
+		return;
+	}
+	auto &bg = id->next.backgrounds[static_cast<std::size_t>(layer)];
+	const auto x = static_cast<unsigned>(r.column);
+	for (auto y = 0; y < r.height; ++y) {
+		const auto mapY = static_cast<unsigned>(r.row + y);
+		const auto dst = &bg.tileMap[renderer::bgTileIdx(x, mapY)];
+		for (auto i = 0; i < r.width; ++i) {
+			dst[i] = tile;
+		}
+		renderer::markDirty(&bg, mapY, x, x + static_cast<unsigned>(r.width));
+	}
+	bg.clear = bg.clear && tile == 0;
 }
 
 }
@@ -0,0 +1,245 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <chrono>
+#include <mutex>
+
+#include <ox/std/memory.hpp>
+
+#include <nostalgia/core/gfx.hpp>
+
+#include "gfx.hpp"
+#include "gfx_software.hpp"
+#include "heapcounter.hpp"
+#include "softrenderer.hpp"
+#include "tilesheetloader.hpp"
+
+namespace nostalgia::core {
+
+namespace renderer {
+
+struct SwImplData {
+	SoftRenderer renderer;
+	ox::Vector<Color32> framebuffer;
+	FrameStats stats;
+	uint64_t prevHeapAllocs = 0;
+	std::chrono::steady_clock::time_point prevDrawStart;
+	std::mutex romMtx;
+	ox::UniquePtr<TileSheetLoader> tileSheetLoader;
+};
+
+ox::Error init(Context *ctx, GlProcLookup) noexcept {
+	const auto id = new SwImplData;
+	ctx->setRendererData(id);
+	id->prevDrawStart = std::chrono::steady_clock::now();
+	return OxError(0);
+}
+
+ox::Error shutdown(Context *ctx) noexcept {
+	const auto id = ctx->rendererData<SwImplData>();
+	ctx->setRendererData(nullptr);
+	delete id;
+	return OxError(0);
+}
+
+std::mutex &romMutex(Context *ctx) noexcept {
+	return ctx->rendererData<SwImplData>()->romMtx;
+}
+
+TileSheetLoader *tileSheetLoader(Context *ctx) noexcept {
+	const auto id = ctx->rendererData<SwImplData>();
+	if (!id->tileSheetLoader) {
+		id->tileSheetLoader = ox::UniquePtr<TileSheetLoader>(new TileSheetLoader(ctx, &id->romMtx));
+	}
+	return id->tileSheetLoader.get();
+}
+
+void recordFrameTimes(Context *ctx, uint64_t eventUs, uint64_t swapUs, uint64_t inputLatencyUs) noexcept {
+	const auto id = ctx->rendererData<SwImplData>();
+	if (const auto sample = id->stats.frame(id->stats.frames() - 1)) {
+		sample->eventUs = eventUs;
+		sample->swapUs = swapUs;
+		sample->inputLatencyUs = inputLatencyUs;
+		const auto allocs = heapAllocations();
+		sample->heapAllocs = allocs - id->prevHeapAllocs;
+		id->prevHeapAllocs = allocs;
+	}
+}
+
+const FrameStats &frameStats(Context *ctx) noexcept {
+	return ctx->rendererData<SwImplData>()->stats;
+}
+
+void setFrameStatsOverlay(Context*, bool) noexcept {
+	// the software renderer has no overlay
+}
+
+bool frameStatsOverlay(Context*) noexcept {
+	return false;
+}
+
+const Color32 *framebuffer(Context *ctx) noexcept {
+	return ctx->rendererData<SwImplData>()->framebuffer.data();
+}
+
+ox::Error loadBgTexture(Context *ctx, int section, const uint8_t *pixels, int w, int h) noexcept {
+	oxTracef("nostalgia::core::gfx::sw", "loadBgTexture: { section: {}, w: {}, h: {} }", section, w, h);
+	const auto id = ctx->rendererData<SwImplData>();
+	return id->renderer.loadTiles(section, pixels, static_cast<std::size_t>(w * h));
+}
+
+ox::Error loadBgPalette(Context *ctx, int section, const Color16 *colors, std::size_t len) noexcept {
+	const auto id = ctx->rendererData<SwImplData>();
+	id->renderer.loadPalette(section, colors, len);
+	return OxError(0);
+}
+
+ox::Error loadSpriteTexture(Context *ctx, const uint8_t *pixels, int w, int h) noexcept {
+	oxTracef("nostalgia::core::gfx::sw", "loadSpriteTexture: { w: {}, h: {} }", w, h);
+	const auto id = ctx->rendererData<SwImplData>();
+	return id->renderer.loadTiles(SoftRenderer::SpriteSection, pixels, static_cast<std::size_t>(w * h));
+}
+
+ox::Error loadSpritePalette(Context *ctx, const Color16 *colors, std::size_t len) noexcept {
+	const auto id = ctx->rendererData<SwImplData>();
+	id->renderer.loadPalette(SoftRenderer::SpriteSection, colors, len);
+	return OxError(0);
+}
+
+}
+
+uint8_t bgStatus(Context *ctx) noexcept {
+	const auto id = ctx->rendererData<renderer::SwImplData>();
+	uint8_t out = 0;
+	for (unsigned i = 0; i < SoftRenderer::BgCount; ++i) {
+		out |= static_cast<uint8_t>(id->renderer.bgEnabled(i) << i);
+	}
+	return out;
+}
+
+void setBgStatus(Context *ctx, uint32_t status) noexcept {
+	const auto id = ctx->rendererData<renderer::SwImplData>();
+	for (unsigned i = 0; i < SoftRenderer::BgCount; ++i) {
+		id->renderer.setBgEnabled(i, (status >> i) & 1);
+	}
+}
+
+bool bgStatus(Context *ctx, unsigned bg) noexcept {
+	const auto id = ctx->rendererData<renderer::SwImplData>();
+	return id->renderer.bgEnabled(bg);
+}
+
+void setBgStatus(Context *ctx, unsigned bg, bool status) noexcept {
+	const auto id = ctx->rendererData<renderer::SwImplData>();
+	id->renderer.setBgEnabled(bg, status);
+}
+
+namespace renderer {
+
+void publishFrame(Context *ctx) noexcept {
+	// the renderer's state is drawn as set, only loads are left to pick up
+	const auto id = ctx->rendererData<SwImplData>();
+	if (id->tileSheetLoader) {
+		id->tileSheetLoader->uploadReady();
+	}
+}
+
+void drawPublished(Context *ctx) noexcept {
+	using namespace std::chrono;
+	const auto id = ctx->rendererData<SwImplData>();
+	const auto start = steady_clock::now();
+	const auto sample = id->stats.push();
+	sample->frameUs = static_cast<uint64_t>(duration_cast<microseconds>(start - id->prevDrawStart).count());
+	id->prevDrawStart = start;
+	const auto [w, h] = getScreenSize(ctx);
+	id->framebuffer.resize(static_cast<std::size_t>(w * h));
+	id->renderer.render(id->framebuffer.data(), w, h);
+	sample->drawUs = static_cast<uint64_t>(duration_cast<microseconds>(steady_clock::now() - start).count());
+}
+
+}
+
+void draw(Context *ctx) noexcept {
+	renderer::publishFrame(ctx);
+	renderer::drawPublished(ctx);
+}
+
+void clearTileLayer(Context *ctx, int layer) noexcept {
+	const auto id = ctx->rendererData<renderer::SwImplData>();
+	id->renderer.clearBg(static_cast<unsigned>(layer));
+}
+
+void setBgScroll(Context *ctx, int layer, int x, int y) noexcept {
+	const auto id = ctx->rendererData<renderer::SwImplData>();
+	const auto bg = static_cast<unsigned>(layer);
+	auto t = id->renderer.bgTransform(bg);
+	t.x = x * BgTransform::One;
+	t.y = y * BgTransform::One;
+	id->renderer.setBgTransform(bg, t);
+}
+
+void setBgTransform(Context *ctx, int layer, const BgTransform &transform) noexcept {
+	const auto id = ctx->rendererData<renderer::SwImplData>();
+	id->renderer.setBgTransform(static_cast<unsigned>(layer), transform);
+}
+
+BgTransform bgTransform(Context *ctx, int layer) noexcept {
+	const auto id = ctx->rendererData<renderer::SwImplData>();
+	return id->renderer.bgTransform(static_cast<unsigned>(layer));
+}
+
+void setBgWrap(Context *ctx, int layer, bool wrap) noexcept {
+	const auto id = ctx->rendererData<renderer::SwImplData>();
+	id->renderer.setBgWrap(static_cast<unsigned>(layer), wrap);
+}
+
+void hideSprite(Context *ctx, unsigned idx) noexcept {
+	const auto id = ctx->rendererData<renderer::SwImplData>();
+	id->renderer.hideSprite(idx);
+}
+
+void setSprite(Context *ctx,
+               unsigned idx,
+               unsigned x,
+               unsigned y,
+               unsigned tileIdx,
+               unsigned spriteShape,
+               unsigned spriteSize,
+               unsigned flipX) noexcept {
+	const auto id = ctx->rendererData<renderer::SwImplData>();
+	id->renderer.setSprite(idx, x, y, tileIdx, spriteShape, spriteSize, flipX);
+}
+
+void setTile(Context *ctx, int layer, int column, int row, uint8_t tile) noexcept {
+	const auto id = ctx->rendererData<renderer::SwImplData>();
+	id->renderer.setTile(static_cast<unsigned>(layer), static_cast<unsigned>(column), static_cast<unsigned>(row), tile);
+}
+
+void blitTileRect(Context *ctx, int layer, int column, int row, int width, int height,
+                  const uint8_t *tiles, int stride) noexcept {
+	const auto id = ctx->rendererData<renderer::SwImplData>();
+	renderer::TileRect r{column, row, width, height};
+	if (!renderer::clipTileRect(&r, SoftRenderer::TileColumns, SoftRenderer::TileRows)) {
+		return;
+	}
+	id->renderer.blitTiles(static_cast<unsigned>(layer), static_cast<unsigned>(r.column), static_cast<unsigned>(r.row),
+	                       static_cast<unsigned>(r.width), static_cast<unsigned>(r.height),
+	                       tiles + r.srcY * stride + r.srcX, static_cast<std::size_t>(stride));
+}
+
+void fillTileRect(Context *ctx, int layer, int column, int row, int width, int height, uint8_t tile) noexcept {
+	const auto id = ctx->rendererData<renderer::SwImplData>();
+	renderer::TileRect r{column, row, width, height};
+	if (!renderer::clipTileRect(&r, SoftRenderer::TileColumns, SoftRenderer::TileRows)) {
+		return;
+	}
+	id->renderer.fillTiles(static_cast<unsigned>(layer), static_cast<unsigned>(r.column), static_cast<unsigned>(r.row),
+	                       static_cast<unsigned>(r.width), static_cast<unsigned>(r.height), tile);
+}
+
+}
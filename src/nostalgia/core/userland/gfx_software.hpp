@@ -0,0 +1,23 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <nostalgia/core/color.hpp>
+#include <nostalgia/core/context.hpp>
+
+namespace nostalgia::core::renderer {
+
+/**
+ * @return the framebuffer the software renderer drew the last frame into,
+ *         getScreenWidth(ctx) x getScreenHeight(ctx) pixels
+ */
+[[nodiscard]]
+const Color32 *framebuffer(Context *ctx) noexcept;
+
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "heapcounter.hpp"
+
+namespace nostalgia::core {
+
+#ifdef NOSTALGIA_COUNT_HEAP_ALLOCS
+
+static std::atomic<uint64_t> g_heapAllocations = 0;
+
+bool heapAllocationsCounted() noexcept {
+	return true;
+}
+
+uint64_t heapAllocations() noexcept {
+	return g_heapAllocations.load(std::memory_order_relaxed);
+}
+
+static void *countedAlloc(std::size_t size) {
+	g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+	if (const auto p = std::malloc(size ? size : 1)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+#else
+
+bool heapAllocationsCounted() noexcept {
+	return false;
+}
+
+uint64_t heapAllocations() noexcept {
+	return 0;
+}
+
+#endif
+
+}
+
+#ifdef NOSTALGIA_COUNT_HEAP_ALLOCS
+
+// the aligned and nothrow forms are left to the standard library, which
+// implements the nothrow forms in terms of these
+
+void *operator new(std::size_t size) {
+	return nostalgia::core::countedAlloc(size);
+}
+
+void *operator new[](std::size_t size) {
+	return nostalgia::core::countedAlloc(size);
+}
+
+void operator delete(void *p) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+	std::free(p);
+}
+
+#endif
@@ -0,0 +1,29 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <ox/std/types.hpp>
+
+namespace nostalgia::core {
+
+/**
+ * Whether global operator new is instrumented, which is the case in debug
+ * builds (NOSTALGIA_COUNT_HEAP_ALLOCS).
+ */
+[[nodiscard]]
+bool heapAllocationsCounted() noexcept;
+
+/**
+ * @return number of calls to global operator new since program start, on
+ *         all threads, or 0 if not counted
+ */
+[[nodiscard]]
+uint64_t heapAllocations() noexcept;
+
+}
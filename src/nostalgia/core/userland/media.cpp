@@ -7,24 +7,76 @@
  */
 
 #include <fstream>
+#include <mutex>
 
+#include <ox/std/defines.hpp>
 #include <ox/std/trace.hpp>
+#include <ox/std/vector.hpp>
+
+#if defined(OX_OS_Linux) || defined(OX_OS_Darwin) || defined(OX_OS_FreeBSD) || \
+    defined(OX_OS_NetBSD) || defined(OX_OS_OpenBSD) || defined(OX_OS_DragonFlyBSD)
+#define NOSTALGIA_MMAP_ROM
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "../media.hpp"
 
 namespace nostalgia::core {
 
-ox::Result<char*> loadRom(const char *path) noexcept {
+struct LoadedRom {
+	char *rom = nullptr;
+	std::size_t size = 0;
+	bool mapped = false;
+};
+
+// unloadRom only gets the pointer, munmap also needs the size
+static std::mutex g_romsMtx;
+static ox::Vector<LoadedRom> g_roms;
+
+static void addRom(char *rom, std::size_t size, bool mapped) noexcept {
+	std::lock_guard lk(g_romsMtx);
+	g_roms.push_back({rom, size, mapped});
+}
+
+#ifdef NOSTALGIA_MMAP_ROM
+static ox::Result<char*> mapRom(const char *path, std::size_t *size, RomAccess access) noexcept {
+	const auto fd = open(path, O_RDONLY);
+	if (fd == -1) {
+		return OxError(1, "Could not open ROM file");
+	}
+	struct stat st = {};
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		close(fd);
+		return OxError(2, "Could not stat ROM file");
+	}
+	const auto romSize = static_cast<std::size_t>(st.st_size);
+	const auto prot = access == RomAccess::CopyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ;
+	const auto rom = mmap(nullptr, romSize, prot, MAP_PRIVATE, fd, 0);
+	// the mapping holds its own reference to the file
+	close(fd);
+	if (rom == MAP_FAILED) {
+		return OxError(3, "Could not map ROM file");
+	}
+	*size = romSize;
+	return static_cast<char*>(rom);
+}
+#endif
+
+static ox::Result<char*> readRom(const char *path, std::size_t *size) noexcept {
 	std::ifstream file(path, std::ios::binary | std::ios::ate);
 	if (!file.good()) {
 		oxErrorf("Could not find ROM file: {}", path);
 		return OxError(1, "Could not find ROM file");
 	}
 	try {
-		const auto size = file.tellg();
+		const auto romSize = static_cast<std::size_t>(file.tellg());
 		file.seekg(0, std::ios::beg);
-		auto buff = new char[static_cast<std::size_t>(size)];
-		file.read(buff, size);
+		auto buff = new char[romSize];
+		file.read(buff, static_cast<std::streamsize>(romSize));
+		*size = romSize;
 		return buff;
 	} catch (const std::ios_base::failure &e) {
 		oxErrorf("Could not read ROM file: {}", e.what());
@@ -32,8 +84,50 @@ ox::Result<char*> loadRom(const char *path) noexcept {
 	}
 }
 
+ox::Result<char*> loadRom(const char *path, std::size_t *size, [[maybe_unused]] RomAccess access) noexcept {
+	std::size_t romSize = 0;
+	char *rom = nullptr;
+	auto mapped = false;
+#ifdef NOSTALGIA_MMAP_ROM
+	if (auto [mappedRom, err] = mapRom(path, &romSize, access); !err) {
+		rom = mappedRom;
+		mapped = true;
+	} else {
+		oxTracef("nostalgia::core::loadRom", "Could not map ROM, reading it instead: {}", err.msg);
+	}
+#endif
+	if (!mapped) {
+		oxReturnError(readRom(path, &romSize).moveTo(&rom));
+	}
+	addRom(rom, romSize, mapped);
+	if (size) {
+		*size = romSize;
+	}
+	return rom;
+}
+
 void unloadRom(char *rom) noexcept {
-	delete rom;
+	if (!rom) {
+		return;
+	}
+	LoadedRom loaded;
+	{
+		std::lock_guard lk(g_romsMtx);
+		for (std::size_t i = 0; i < g_roms.size(); ++i) {
+			if (g_roms[i].rom == rom) {
+				loaded = g_roms[i];
+				oxIgnoreError(g_roms.erase(i));
+				break;
+			}
+		}
+	}
+#ifdef NOSTALGIA_MMAP_ROM
+	if (loaded.mapped) {
+		munmap(loaded.rom, loaded.size);
+		return;
+	}
+#endif
+	delete[] rom;
 }
 
 }
@@ -0,0 +1,322 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <ox/std/assert.hpp>
+#include <ox/std/math.hpp>
+#include <ox/std/memops.hpp>
+
+#include "softrenderer.hpp"
+
+namespace nostalgia::core {
+
+// max tiles per tile sheet, as in the OpenGL renderer's lookup texture
+constexpr std::size_t MaxSectionTiles = 1024;
+
+// sprite dimensions in tiles, indexed by shape (square, wide, tall) and size
+constexpr uint8_t SpriteDimensions[3][4][2] = {
+	{{1, 1}, {2, 2}, {4, 4}, {8, 8}},
+	{{2, 1}, {4, 1}, {4, 2}, {8, 4}},
+	{{1, 2}, {1, 4}, {2, 4}, {4, 8}},
+};
+
+/**
+ * Maps a framebuffer coordinate to the virtual screen, sampling at the
+ * center of the framebuffer pixel like the GL rasterizer.
+ */
+[[nodiscard]]
+static constexpr int toVirtual(int p, int height) noexcept {
+	return ((2 * p + 1) * SoftRenderer::ScreenHeight) / (2 * height);
+}
+
+ox::Error SoftRenderer::loadTiles(int section, const uint8_t *pixels, std::size_t len) noexcept {
+	const auto tiles = len / TileBytes;
+	if (tiles > MaxSectionTiles) {
+		return OxError(1, "Tile sheet has too many tiles");
+	}
+	auto &s = m_sections[static_cast<std::size_t>(section)];
+	s.pixels.resize(tiles * TileBytes);
+	ox_memcpy(s.pixels.data(), pixels, s.pixels.size());
+	s.tiles = tiles;
+	return OxError(0);
+}
+
+void SoftRenderer::loadPalette(int section, const Color16 *colors, std::size_t len) noexcept {
+	auto &pal = m_sections[static_cast<std::size_t>(section)].palette;
+	// missing entries are opaque black, as with the GL renderer's zero filled palette rows
+	for (std::size_t i = 0; i < pal.size(); ++i) {
+		pal[i] = toColor32(i < len ? colors[i] : 0);
+	}
+}
+
+void SoftRenderer::setBgEnabled(unsigned bg, bool enabled) noexcept {
+	m_backgrounds[bg].enabled = enabled;
+}
+
+bool SoftRenderer::bgEnabled(unsigned bg) const noexcept {
+	return m_backgrounds[bg].enabled;
+}
+
+void SoftRenderer::setTile(unsigned bg, unsigned column, unsigned row, uint8_t tile) noexcept {
+	m_backgrounds[bg].tileMap[row * TileColumns + column] = tile;
+}
+
+void SoftRenderer::blitTiles(unsigned bg, unsigned column, unsigned row, unsigned width, unsigned height,
+                             const uint8_t *tiles, std::size_t stride) noexcept {
+	auto dst = &m_backgrounds[bg].tileMap[row * TileColumns + column];
+	for (auto y = 0u; y < height; ++y) {
+		ox_memcpy(dst, tiles, width);
+		dst += TileColumns;
+		tiles += stride;
+	}
+}
+
+void SoftRenderer::fillTiles(unsigned bg, unsigned column, unsigned row, unsigned width, unsigned height,
+                             uint8_t tile) noexcept {
+	auto dst = &m_backgrounds[bg].tileMap[row * TileColumns + column];
+	for (auto y = 0u; y < height; ++y) {
+		ox_memset(dst, tile, width);
+		dst += TileColumns;
+	}
+}
+
+void SoftRenderer::clearBg(unsigned bg) noexcept {
+	m_backgrounds[bg].tileMap.fill(0);
+}
+
+void SoftRenderer::setBgTransform(unsigned bg, const BgTransform &transform) noexcept {
+	m_backgrounds[bg].transform = transform;
+}
+
+const BgTransform &SoftRenderer::bgTransform(unsigned bg) const noexcept {
+	return m_backgrounds[bg].transform;
+}
+
+void SoftRenderer::setBgWrap(unsigned bg, bool wrap) noexcept {
+	m_backgrounds[bg].wrap = wrap;
+}
+
+void SoftRenderer::setSprite(unsigned idx, unsigned x, unsigned y, unsigned tileIdx,
+                             unsigned spriteShape, unsigned spriteSize, unsigned flipX) noexcept {
+	oxAssert(idx < static_cast<unsigned>(SpriteCount), "Sprite index out of range");
+	if (idx >= static_cast<unsigned>(SpriteCount)) [[unlikely]] {
+		return;
+	}
+	const auto &dim = SpriteDimensions[spriteShape % 3][spriteSize & 3];
+	auto sx = static_cast<int>(x & 0x1ff);
+	auto sy = static_cast<int>(y & 0xff);
+	if (sx >= 512 - 64) {
+		sx -= 512;
+	}
+	if (sy >= 256 - 64) {
+		sy -= 256;
+	}
+	auto &s = m_sprites[idx];
+	s.enabled = true;
+	s.x = sx;
+	s.y = sy;
+	s.tileIdx = tileIdx & 0xffff;
+	s.width = dim[0];
+	s.height = dim[1];
+	s.flipX = flipX;
+}
+
+void SoftRenderer::hideSprite(unsigned idx) noexcept {
+	oxAssert(idx < static_cast<unsigned>(SpriteCount), "Sprite index out of range");
+	if (idx >= static_cast<unsigned>(SpriteCount)) [[unlikely]] {
+		return;
+	}
+	m_sprites[idx].enabled = false;
+}
+
+void SoftRenderer::render(Color32 *fb, int width, int height) noexcept {
+	if (width <= 0 || height <= 0) {
+		return;
+	}
+	const auto vw = toVirtual(width - 1, height) + 1;
+	const auto vwLen = static_cast<std::size_t>(vw);
+	// room to write whole tile rows past both ends of the line
+	m_bgLine.resize(vwLen + 2 * TileWidth);
+	m_spriteLine.resize(vwLen);
+	const auto scaled = vw != width;
+	if (scaled) {
+		m_colorLine.resize(vwLen);
+		m_columnMap.resize(static_cast<std::size_t>(width));
+		for (auto x = 0; x < width; ++x) {
+			m_columnMap[static_cast<std::size_t>(x)] = toVirtual(x, height);
+		}
+	}
+	auto prevVy = -1;
+	for (auto y = 0; y < height; ++y) {
+		const auto row = fb + y * width;
+		const auto vy = toVirtual(y, height);
+		if (vy == prevVy) {
+			ox_memcpy(row, row - width, static_cast<std::size_t>(width) * sizeof(Color32));
+			continue;
+		}
+		prevVy = vy;
+		// unscaled lines are rendered straight into the framebuffer
+		const auto line = scaled ? m_colorLine.data() : row;
+		renderBgLine(line, vw, vy);
+		renderSpriteLine(line, vw, vy);
+		if (scaled) {
+			for (auto x = 0; x < width; ++x) {
+				row[x] = line[m_columnMap[static_cast<std::size_t>(x)]];
+			}
+		}
+	}
+}
+
+void SoftRenderer::renderBgLine(Color32 *line, int width, int vy) noexcept {
+	// layers are opaque where they cover the map, so drawing can start at
+	// the topmost layer that covers the whole line
+	auto bottom = -1;
+	auto top = -1;
+	for (auto bg = 0; bg < BgCount; ++bg) {
+		if (m_backgrounds[static_cast<std::size_t>(bg)].enabled) {
+			if (bottom < 0 || coversLine(static_cast<unsigned>(bg), width, vy)) {
+				bottom = bg;
+			}
+			top = bg;
+		}
+	}
+	if (bottom < 0 || !coversLine(static_cast<unsigned>(bottom), width, vy)) {
+		for (auto x = 0; x < width; ++x) {
+			line[x] = ClearColor;
+		}
+	}
+	for (auto bg = bottom; bg >= 0 && bg <= top; ++bg) {
+		if (m_backgrounds[static_cast<std::size_t>(bg)].enabled) {
+			renderLayerLine(static_cast<unsigned>(bg), line, width, vy);
+		}
+	}
+}
+
+bool SoftRenderer::coversLine(unsigned bg, int width, int vy) const noexcept {
+	const auto &b = m_backgrounds[bg];
+	if (b.wrap) {
+		return true;
+	}
+	if (!b.transform.identityMatrix()) {
+		return false;
+	}
+	const auto mx = (b.transform.x + BgTransform::One / 2) >> 8;
+	const auto my = vy + ((b.transform.y + BgTransform::One / 2) >> 8);
+	return mx >= 0 && mx + width <= MapWidth && my >= 0 && my < MapHeight;
+}
+
+bool SoftRenderer::renderLayerLine(unsigned bg, Color32 *line, int width, int vy) noexcept {
+	const auto &b = m_backgrounds[bg];
+	const auto &s = m_sections[bg];
+	const auto &t = b.transform;
+	if (!t.identityMatrix()) {
+		// sample at pixel centers, as the GL rasterizer does, in units of
+		// 1/512 of a pixel to keep the half pixel exact
+		const auto rowX = int64_t{t.pb} * (2 * vy + 1) + 2 * int64_t{t.x};
+		const auto rowY = int64_t{t.pd} * (2 * vy + 1) + 2 * int64_t{t.y};
+		for (auto x = 0; x < width; ++x) {
+			auto mx = static_cast<int>((int64_t{t.pa} * (2 * x + 1) + rowX) >> 9);
+			auto my = static_cast<int>((int64_t{t.pc} * (2 * x + 1) + rowY) >> 9);
+			if (b.wrap) {
+				mx &= MapWidth - 1;
+				my &= MapHeight - 1;
+			} else if (mx < 0 || my < 0 || mx >= MapWidth || my >= MapHeight) {
+				continue;
+			}
+			const std::size_t tile = b.tileMap[static_cast<std::size_t>((my / TileHeight) * TileColumns + mx / TileWidth)];
+			const std::size_t v = tile < s.tiles ?
+				s.pixels[tile * TileBytes + static_cast<std::size_t>((my % TileHeight) * TileWidth + mx % TileWidth)] : 0;
+			line[x] = s.palette[v];
+		}
+		return b.wrap;
+	}
+	// a pure translation, gather whole tile rows
+	auto mx = (t.x + BgTransform::One / 2) >> 8;
+	auto my = vy + ((t.y + BgTransform::One / 2) >> 8);
+	auto x0 = 0;
+	auto x1 = width;
+	if (b.wrap) {
+		mx &= MapWidth - 1;
+		my &= MapHeight - 1;
+	} else {
+		x0 = ox::max(0, -mx);
+		x1 = ox::min(width, MapWidth - mx);
+		if (my < 0 || my >= MapHeight || x0 >= x1) {
+			return false;
+		}
+	}
+	const auto row = my / TileHeight;
+	const auto tileMap = &b.tileMap[static_cast<std::size_t>(row * TileColumns)];
+	const auto rowOffset = static_cast<std::size_t>((my % TileHeight) * TileWidth);
+	// map x of the first pixel, and the offset of that pixel in its tile
+	const auto first = mx + x0;
+	const auto fine = first % TileWidth;
+	const auto cols = (fine + x1 - x0 + TileWidth - 1) / TileWidth;
+	const auto idx = m_bgLine.data();
+	for (auto c = 0; c < cols; ++c) {
+		const auto col = (first / TileWidth + c) & (TileColumns - 1);
+		const std::size_t tile = tileMap[col];
+		const auto dst = idx + c * TileWidth;
+		if (tile < s.tiles) {
+			ox_memcpy(dst, &s.pixels[tile * TileBytes + rowOffset], TileWidth);
+		} else {
+			ox_memset(dst, 0, TileWidth);
+		}
+	}
+	expand8bpp(idx + fine, static_cast<std::size_t>(x1 - x0), s.palette.data(), line + x0);
+	return x0 == 0 && x1 == width;
+}
+
+void SoftRenderer::renderSpriteLine(Color32 *line, int width, int vy) noexcept {
+	const auto &s = m_sections[SpriteSection];
+	if (!s.tiles) {
+		return;
+	}
+	const auto idx = m_spriteLine.data();
+	auto begin = width;
+	auto end = 0;
+	// lower indices are drawn last and end up on top, as on the GBA
+	for (auto i = SpriteCount - 1; i >= 0; --i) {
+		const auto &sprite = m_sprites[static_cast<std::size_t>(i)];
+		const auto pw = sprite.width * TileWidth;
+		const auto py = vy - sprite.y;
+		if (!sprite.enabled || py < 0 || py >= sprite.height * TileHeight) {
+			continue;
+		}
+		const auto x0 = ox::max(sprite.x, 0);
+		const auto x1 = ox::min(sprite.x + pw, width);
+		if (x0 >= x1) {
+			continue;
+		}
+		if (begin >= end) {
+			ox_memset(idx, 0, static_cast<std::size_t>(width));
+		}
+		begin = ox::min(begin, x0);
+		end = ox::max(end, x1);
+		const auto rowTile = sprite.tileIdx + static_cast<std::size_t>((py / TileHeight) * sprite.width);
+		const auto rowOffset = static_cast<std::size_t>((py % TileHeight) * TileWidth);
+		for (auto x = x0; x < x1; ++x) {
+			auto px = x - sprite.x;
+			if (sprite.flipX) {
+				px = pw - 1 - px;
+			}
+			const auto tile = rowTile + static_cast<std::size_t>(px / TileWidth);
+			if (tile >= s.tiles) {
+				continue;
+			}
+			const auto v = s.pixels[tile * TileBytes + rowOffset + static_cast<std::size_t>(px % TileWidth)];
+			if (v) {
+				idx[x] = v;
+			}
+		}
+	}
+	if (begin < end) {
+		blend8bpp(idx + begin, static_cast<std::size_t>(end - begin), s.palette.data(), line + begin);
+	}
+}
+
+}
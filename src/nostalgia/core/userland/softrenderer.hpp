@@ -0,0 +1,166 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <array>
+
+#include <ox/std/error.hpp>
+#include <ox/std/vector.hpp>
+
+#include <nostalgia/core/color.hpp>
+#include <nostalgia/core/gfx.hpp>
+#include <nostalgia/core/tilepixels.hpp>
+
+namespace nostalgia::core {
+
+/**
+ * CPU implementation of the background and sprite layers, producing the
+ * same image as the OpenGL renderer.
+ * Frames are built a scanline of the virtual screen at a time: the palette
+ * indices of the line are gathered tile row by tile row, then expanded to
+ * Color32 with the tilepixels kernels, and framebuffer rows sharing a
+ * virtual line are copied. Layers with a rotation or scaling matrix are
+ * sampled a pixel at a time instead.
+ */
+class SoftRenderer {
+
+	public:
+		static constexpr auto TileWidth = 8;
+		static constexpr auto TileHeight = 8;
+		static constexpr auto TileBytes = TileWidth * TileHeight;
+		static constexpr auto TileColumns = 128;
+		static constexpr auto TileRows = 128;
+		static constexpr auto TileCount = TileColumns * TileRows;
+		// tile map dimensions in pixels, powers of 2 so wrapping is a mask
+		static constexpr auto MapWidth = TileColumns * TileWidth;
+		static constexpr auto MapHeight = TileRows * TileHeight;
+		static constexpr auto BgCount = 4;
+		static constexpr auto SpriteCount = 128;
+		// sections 0-3 are the backgrounds, the sprite tile sheet gets the last one
+		static constexpr auto SectionCount = 5;
+		static constexpr auto SpriteSection = 4;
+		static constexpr Color32 ClearColor = 0xff000000;
+		// virtual screen height in pixels, rendering scales this to the framebuffer
+		static constexpr auto ScreenHeight = 20 * TileHeight;
+
+	private:
+		struct Section {
+			// 8x8 tiles of 8 bit palette indices, tile-major
+			ox::Vector<uint8_t> pixels;
+			std::size_t tiles = 0;
+			std::array<Color32, PaletteTableLength> palette = {};
+		};
+
+		struct Background {
+			bool enabled = false;
+			bool wrap = false;
+			BgTransform transform;
+			std::array<uint8_t, TileCount> tileMap = {};
+		};
+
+		struct Sprite {
+			bool enabled = false;
+			int x = 0;
+			int y = 0;
+			unsigned tileIdx = 0;
+			// dimensions in tiles
+			int width = 0;
+			int height = 0;
+			bool flipX = false;
+		};
+
+		std::array<Section, SectionCount> m_sections;
+		std::array<Background, BgCount> m_backgrounds;
+		std::array<Sprite, SpriteCount> m_sprites;
+		// scanline scratch buffers, in virtual screen pixels
+		ox::Vector<uint8_t> m_bgLine;
+		ox::Vector<uint8_t> m_spriteLine;
+		ox::Vector<Color32> m_colorLine;
+		// virtual x of each framebuffer column, for scaled framebuffers
+		ox::Vector<int> m_columnMap;
+
+	public:
+		/**
+		 * @param pixels 8 bit palette indices, 8 pixels wide
+		 * @param len number of bytes in pixels
+		 */
+		ox::Error loadTiles(int section, const uint8_t *pixels, std::size_t len) noexcept;
+
+		/**
+		 * Loads the palette for the given section, colors beyond the 256th are ignored.
+		 */
+		void loadPalette(int section, const Color16 *colors, std::size_t len) noexcept;
+
+		void setBgEnabled(unsigned bg, bool enabled) noexcept;
+
+		[[nodiscard]]
+		bool bgEnabled(unsigned bg) const noexcept;
+
+		void setTile(unsigned bg, unsigned column, unsigned row, uint8_t tile) noexcept;
+
+		/**
+		 * Copies a width x height rectangle of tiles into the tile map, which
+		 * it must lie within.
+		 * @param stride distance between the starts of the source rows
+		 */
+		void blitTiles(unsigned bg, unsigned column, unsigned row, unsigned width, unsigned height,
+		               const uint8_t *tiles, std::size_t stride) noexcept;
+
+		/**
+		 * Sets a width x height rectangle of the tile map, which it must lie
+		 * within, to the given tile.
+		 */
+		void fillTiles(unsigned bg, unsigned column, unsigned row, unsigned width, unsigned height,
+		               uint8_t tile) noexcept;
+
+		void clearBg(unsigned bg) noexcept;
+
+		void setBgTransform(unsigned bg, const BgTransform &transform) noexcept;
+
+		[[nodiscard]]
+		const BgTransform &bgTransform(unsigned bg) const noexcept;
+
+		void setBgWrap(unsigned bg, bool wrap) noexcept;
+
+		/**
+		 * Takes the same arguments as core::setSprite, coordinates wrap like
+		 * the GBA's 9 bit x and 8 bit y.
+		 */
+		void setSprite(unsigned idx, unsigned x, unsigned y, unsigned tileIdx,
+		               unsigned spriteShape, unsigned spriteSize, unsigned flipX) noexcept;
+
+		void hideSprite(unsigned idx) noexcept;
+
+		/**
+		 * Renders the layers into a width x height framebuffer, with the
+		 * screen scaled so that 20 tile rows fill its height.
+		 */
+		void render(Color32 *fb, int width, int height) noexcept;
+
+	private:
+		void renderBgLine(Color32 *line, int width, int vy) noexcept;
+
+		/**
+		 * Renders the pixels of the line the layer covers.
+		 * @return true if the layer covers the whole line
+		 */
+		bool renderLayerLine(unsigned bg, Color32 *line, int width, int vy) noexcept;
+
+		/**
+		 * @return whether the layer is known to cover the whole line without
+		 *         rendering it
+		 */
+		[[nodiscard]]
+		bool coversLine(unsigned bg, int width, int vy) const noexcept;
+
+		void renderSpriteLine(Color32 *line, int width, int vy) noexcept;
+
+};
+
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "threadpool.hpp"
+
+namespace nostalgia::core {
+
+ThreadPool::ThreadPool(std::size_t threads) noexcept {
+	if (!threads) {
+		threads = std::thread::hardware_concurrency();
+	}
+	if (!threads) {
+		threads = 1;
+	}
+	for (std::size_t i = 0; i < threads; ++i) {
+		m_queues.emplace_back(std::make_unique<Queue>());
+	}
+	for (std::size_t i = 0; i < threads - 1; ++i) {
+		m_workers.emplace_back([this, i] { work(i); });
+	}
+}
+
+ThreadPool::~ThreadPool() noexcept {
+	{
+		std::lock_guard lk(m_mtx);
+		m_running = false;
+	}
+	m_wake.notify_all();
+	for (auto &w : m_workers) {
+		w.join();
+	}
+}
+
+std::size_t ThreadPool::threads() const noexcept {
+	return m_queues.size();
+}
+
+void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t)> &fn) noexcept {
+	if (!count) {
+		return;
+	}
+	std::lock_guard runLk(m_runMtx);
+	// hand each queue a contiguous run of tasks, neighbouring tasks tend to
+	// touch neighbouring memory
+	const auto queues = m_queues.size();
+	const auto caller = queues - 1;
+	{
+		std::lock_guard lk(m_mtx);
+		m_fn = &fn;
+		m_remaining = count;
+		for (std::size_t q = 0; q < queues; ++q) {
+			std::lock_guard qlk(m_queues[q]->mtx);
+			const auto begin = count * q / queues;
+			const auto end = count * (q + 1) / queues;
+			for (auto t = begin; t < end; ++t) {
+				m_queues[q]->tasks.push_back(t);
+			}
+		}
+		++m_generation;
+	}
+	m_wake.notify_all();
+	drain(caller);
+	std::unique_lock lk(m_mtx);
+	m_done.wait(lk, [this] { return m_remaining == 0; });
+	m_fn = nullptr;
+}
+
+void ThreadPool::work(std::size_t queue) noexcept {
+	uint64_t generation = 0;
+	while (true) {
+		{
+			std::unique_lock lk(m_mtx);
+			m_wake.wait(lk, [&] { return !m_running || m_generation != generation; });
+			if (!m_running) {
+				return;
+			}
+			generation = m_generation;
+		}
+		drain(queue);
+	}
+}
+
+void ThreadPool::drain(std::size_t queue) noexcept {
+	const auto queues = m_queues.size();
+	std::size_t task = 0;
+	while (true) {
+		auto found = pop(queue, false, &task);
+		for (std::size_t i = 1; !found && i < queues; ++i) {
+			found = pop((queue + i) % queues, true, &task);
+		}
+		if (!found) {
+			return;
+		}
+		(*m_fn)(task);
+		if (--m_remaining == 0) {
+			// lock so the notification can't land between the waiter's check and its wait
+			std::lock_guard lk(m_mtx);
+			m_done.notify_all();
+		}
+	}
+}
+
+bool ThreadPool::pop(std::size_t queue, bool steal, std::size_t *task) noexcept {
+	auto &q = *m_queues[queue];
+	std::lock_guard lk(q.mtx);
+	if (q.tasks.empty()) {
+		return false;
+	}
+	if (steal) {
+		*task = q.tasks.back();
+		q.tasks.pop_back();
+	} else {
+		*task = q.tasks.front();
+		q.tasks.pop_front();
+	}
+	return true;
+}
+
+}
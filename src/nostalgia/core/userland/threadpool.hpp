@@ -0,0 +1,89 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <ox/std/types.hpp>
+
+namespace nostalgia::core {
+
+/**
+ * Fixed set of worker threads running parallelFor batches. Each worker, and
+ * the calling thread, gets a queue of task indices to work through from the
+ * front, and steals from the back of the other queues once its own is empty,
+ * so unevenly sized tasks still keep every thread busy.
+ */
+class ThreadPool {
+
+	private:
+		struct Queue {
+			std::mutex mtx;
+			std::deque<std::size_t> tasks;
+		};
+
+		// one queue per worker, the last one belongs to the thread calling parallelFor
+		std::vector<std::unique_ptr<Queue>> m_queues;
+		std::vector<std::thread> m_workers;
+		// serializes parallelFor calls
+		std::mutex m_runMtx;
+		std::mutex m_mtx;
+		std::condition_variable m_wake;
+		std::condition_variable m_done;
+		uint64_t m_generation = 0;
+		bool m_running = true;
+		const std::function<void(std::size_t)> *m_fn = nullptr;
+		std::atomic<std::size_t> m_remaining = 0;
+
+	public:
+		/**
+		 * @param threads number of threads to run tasks on, including the one
+		 *                calling parallelFor, 0 for one per hardware thread
+		 */
+		explicit ThreadPool(std::size_t threads = 0) noexcept;
+
+		~ThreadPool() noexcept;
+
+		ThreadPool(const ThreadPool&) = delete;
+
+		ThreadPool &operator=(const ThreadPool&) = delete;
+
+		/**
+		 * @return number of threads tasks run on, including the caller's
+		 */
+		[[nodiscard]]
+		std::size_t threads() const noexcept;
+
+		/**
+		 * Runs fn once for each index in [0, count), returning once all have
+		 * finished. fn must not call parallelFor on the same pool.
+		 */
+		void parallelFor(std::size_t count, const std::function<void(std::size_t)> &fn) noexcept;
+
+	private:
+		void work(std::size_t queue) noexcept;
+
+		/**
+		 * Runs tasks from the given queue, then from the others, until all
+		 * queues are empty.
+		 */
+		void drain(std::size_t queue) noexcept;
+
+		bool pop(std::size_t queue, bool steal, std::size_t *task) noexcept;
+
+};
+
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <ox/std/hash.hpp>
+#include <ox/std/memops.hpp>
+
+#include "tileatlas.hpp"
+
+namespace nostalgia::core {
+
+TileAtlas::TileAtlas() noexcept: m_tiles(Slots * TileBytes), m_refs(Slots) {
+	ox_memset(m_tiles.data(), 0, m_tiles.size());
+	// slot 0 is the blank tile and is never freed
+	m_refs[0] = 1;
+	m_index.emplace(hash(m_tiles.data()), 0);
+	for (auto i = Slots - 1; i > 0; --i) {
+		m_freeSlots.push_back(static_cast<uint16_t>(i));
+	}
+}
+
+ox::Result<uint16_t> TileAtlas::add(const uint8_t *tile, bool *isNew) noexcept {
+	const auto h = hash(tile);
+	const auto [begin, end] = m_index.equal_range(h);
+	for (auto it = begin; it != end; ++it) {
+		const auto slot = it->second;
+		if (ox_memcmp(&m_tiles[slot * TileBytes], tile, TileBytes) == 0) {
+			++m_refs[slot];
+			*isNew = false;
+			return slot;
+		}
+	}
+	if (m_freeSlots.empty()) {
+		return OxError(1, "Tile atlas is full");
+	}
+	const auto slot = m_freeSlots[m_freeSlots.size() - 1];
+	m_freeSlots.pop_back();
+	ox_memcpy(&m_tiles[slot * TileBytes], tile, TileBytes);
+	m_refs[slot] = 1;
+	m_index.emplace(h, slot);
+	*isNew = true;
+	return slot;
+}
+
+void TileAtlas::release(uint16_t slot) noexcept {
+	if (slot == 0 || --m_refs[slot]) {
+		return;
+	}
+	const auto [begin, end] = m_index.equal_range(hash(&m_tiles[slot * TileBytes]));
+	for (auto it = begin; it != end; ++it) {
+		if (it->second == slot) {
+			m_index.erase(it);
+			break;
+		}
+	}
+	m_freeSlots.push_back(slot);
+}
+
+const uint8_t *TileAtlas::tile(uint16_t slot) const noexcept {
+	return &m_tiles[slot * TileBytes];
+}
+
+std::size_t TileAtlas::freeSlots() const noexcept {
+	return m_freeSlots.size();
+}
+
+uint64_t TileAtlas::hash(const uint8_t *tile) noexcept {
+	return ox::fnv1a64(tile, TileBytes);
+}
+
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <unordered_map>
+
+#include <ox/std/error.hpp>
+#include <ox/std/vector.hpp>
+
+namespace nostalgia::core {
+
+/**
+ * Bookkeeping for a square atlas of 8x8 tiles of 8 bit palette indices.
+ * Identical tiles share a slot, and slots are reference counted so that they
+ * can be reused once no tile sheet refers to them anymore.
+ * Slot 0 is always the blank tile.
+ */
+class TileAtlas {
+
+	public:
+		static constexpr auto TileWidth = 8;
+		static constexpr auto TileHeight = 8;
+		static constexpr auto TileBytes = TileWidth * TileHeight;
+		static constexpr auto Columns = 128;
+		static constexpr auto Rows = 128;
+		static constexpr auto Slots = Columns * Rows;
+		static constexpr auto Width = Columns * TileWidth;
+		static constexpr auto Height = Rows * TileHeight;
+
+	private:
+		// tile-major copy of the atlas contents, used to verify hash matches
+		ox::Vector<uint8_t> m_tiles;
+		ox::Vector<uint32_t> m_refs;
+		ox::Vector<uint16_t> m_freeSlots;
+		std::unordered_multimap<uint64_t, uint16_t> m_index;
+
+	public:
+		TileAtlas() noexcept;
+
+		/**
+		 * Adds a reference to the slot holding the given tile, allocating a
+		 * slot for it if it is not in the atlas yet.
+		 * @param tile TileBytes palette indices
+		 * @param isNew set to true if the tile was newly added and the atlas
+		 *              texture needs to be updated
+		 */
+		ox::Result<uint16_t> add(const uint8_t *tile, bool *isNew) noexcept;
+
+		/**
+		 * Drops a reference to the given slot, freeing it once unreferenced.
+		 */
+		void release(uint16_t slot) noexcept;
+
+		[[nodiscard]]
+		const uint8_t *tile(uint16_t slot) const noexcept;
+
+		[[nodiscard]]
+		std::size_t freeSlots() const noexcept;
+
+	private:
+		[[nodiscard]]
+		static uint64_t hash(const uint8_t *tile) noexcept;
+
+};
+
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <ox/claw/claw.hpp>
+#include <ox/std/math.hpp>
+
+#include <nostalgia/core/tilepixels.hpp>
+
+#include "gfx.hpp"
+#include "tilesheetloader.hpp"
+
+namespace nostalgia::core {
+
+TileSheetLoader::TileSheetLoader(Context *ctx, std::mutex *romMtx) noexcept: m_ctx(ctx), m_romMtx(romMtx) {
+	// leave a core for the game and render thread
+	const auto hwThreads = static_cast<int>(std::thread::hardware_concurrency());
+	const auto workers = ox::max(1, ox::min(hwThreads - 1, 4));
+	for (auto i = 0; i < workers; ++i) {
+		m_workers.emplace_back([this] { work(); });
+	}
+}
+
+TileSheetLoader::~TileSheetLoader() noexcept {
+	{
+		std::lock_guard lk(m_mtx);
+		m_running = false;
+	}
+	m_cond.notify_all();
+	for (auto &w : m_workers) {
+		w.join();
+	}
+}
+
+TileSheetLoadId TileSheetLoader::loadBg(int section, const ox::FileAddress &tilesheetAddr,
+                                        const ox::FileAddress &paletteAddr, bool commit) noexcept {
+	TileSheetLoadId id;
+	{
+		std::lock_guard lk(m_mtx);
+		id = m_nextId++;
+		auto job = new Job;
+		job->id = id;
+		job->section = section;
+		job->tilesheetAddr = tilesheetAddr;
+		job->paletteAddr = paletteAddr;
+		job->commit = commit;
+		m_jobs.emplace_back(job);
+		m_queue.push_back(job);
+	}
+	m_cond.notify_one();
+	return id;
+}
+
+TileSheetLoadStatus TileSheetLoader::status(TileSheetLoadId id) noexcept {
+	std::lock_guard lk(m_mtx);
+	if (const auto job = findJob(id)) {
+		return job->status;
+	}
+	if (findFailure(id) < m_failed.size()) {
+		return TileSheetLoadStatus::Failed;
+	}
+	return id && id < m_nextId ? TileSheetLoadStatus::Done : TileSheetLoadStatus::Failed;
+}
+
+ox::Error TileSheetLoader::error(TileSheetLoadId id) noexcept {
+	std::lock_guard lk(m_mtx);
+	if (const auto i = findFailure(id); i < m_failed.size()) {
+		const auto err = m_failed[i].error;
+		oxIgnoreError(m_failed.unordered_erase(i));
+		return err;
+	}
+	if (!id || id >= m_nextId) {
+		return OxError(1, "Invalid tile sheet load ID");
+	}
+	return OxError(0);
+}
+
+ox::Error TileSheetLoader::commit(TileSheetLoadId id) noexcept {
+	std::lock_guard lk(m_mtx);
+	const auto job = findJob(id);
+	if (!job) {
+		if (!id || id >= m_nextId) {
+			return OxError(1, "Invalid tile sheet load ID");
+		}
+		return OxError(0);
+	}
+	if (!job->commit) {
+		job->commit = true;
+		// loads still decoding are queued for upload by their worker
+		if (job->status == TileSheetLoadStatus::Decoded) {
+			m_ready.push_back(job);
+		}
+	}
+	return OxError(0);
+}
+
+void TileSheetLoader::uploadReady() noexcept {
+	{
+		std::lock_guard lk(m_mtx);
+		if (m_ready.empty()) {
+			return;
+		}
+		std::swap(m_ready, m_uploading);
+	}
+	// decoded jobs are only read by other threads, so upload without the lock
+	for (const auto job : m_uploading) {
+		constexpr int width = 8;
+		const int height = static_cast<int>(job->pixels.size() / width);
+		auto err = renderer::loadBgTexture(m_ctx, job->section, job->pixels.data(), width, height);
+		if (!err) {
+			err = renderer::loadBgPalette(m_ctx, job->section, job->colors.data(), job->colors.size());
+		}
+		oxTracef("nostalgia::core::gfx::loader", "uploaded load {}, section {}", job->id, job->section);
+		std::lock_guard lk(m_mtx);
+		finish(job, err);
+	}
+	m_uploading.clear();
+}
+
+void TileSheetLoader::work() noexcept {
+	while (true) {
+		Job *job = nullptr;
+		{
+			std::unique_lock lk(m_mtx);
+			m_cond.wait(lk, [this] { return !m_running || m_queueHead < m_queue.size(); });
+			if (!m_running) {
+				return;
+			}
+			job = m_queue[m_queueHead++];
+			if (m_queueHead == m_queue.size()) {
+				m_queue.clear();
+				m_queueHead = 0;
+			}
+		}
+		// job is not touched by other threads until its status changes
+		const auto err = decode(job);
+		std::lock_guard lk(m_mtx);
+		if (err) {
+			finish(job, err);
+			continue;
+		}
+		job->status = TileSheetLoadStatus::Decoded;
+		if (job->commit) {
+			m_ready.push_back(job);
+		}
+	}
+}
+
+TileSheetLoader::Job *TileSheetLoader::findJob(TileSheetLoadId id) noexcept {
+	for (auto &job : m_jobs) {
+		if (job->id == id) {
+			return job.get();
+		}
+	}
+	return nullptr;
+}
+
+std::size_t TileSheetLoader::findFailure(TileSheetLoadId id) const noexcept {
+	for (std::size_t i = 0; i < m_failed.size(); ++i) {
+		if (m_failed[i].id == id) {
+			return i;
+		}
+	}
+	return m_failed.size();
+}
+
+void TileSheetLoader::finish(Job *job, ox::Error err) noexcept {
+	if (err) {
+		m_failed.push_back({job->id, err});
+	}
+	for (std::size_t i = 0; i < m_jobs.size(); ++i) {
+		if (m_jobs[i].get() == job) {
+			oxIgnoreError(m_jobs.unordered_erase(i));
+			break;
+		}
+	}
+}
+
+template<typename T>
+static ox::Result<T> readObj(Context *ctx, std::mutex *romMtx, const ox::FileAddress &file) noexcept {
+	ox::Buffer buff;
+	{
+		std::lock_guard lk(*romMtx);
+		oxReturnError(ctx->rom->read(file).moveTo(&buff));
+	}
+	return ox::readClaw<T>(buff);
+}
+
+ox::Error TileSheetLoader::decode(Job *job) noexcept {
+	oxRequireM(tilesheet, readObj<NostalgiaGraphic>(m_ctx, m_romMtx, job->tilesheetAddr));
+	const auto &palAddr = job->paletteAddr ? job->paletteAddr : tilesheet.defaultPalette;
+	oxRequireM(palette, readObj<NostalgiaPalette>(m_ctx, m_romMtx, palAddr));
+	if (tilesheet.bpp == 8) {
+		job->pixels = ox::move(tilesheet.pixels);
+	} else {
+		job->pixels.resize(tilesheet.pixels.size() * 2);
+		unpack4bpp(tilesheet.pixels.data(), tilesheet.pixels.size(), job->pixels.data());
+	}
+	job->colors = ox::move(palette.colors);
+	return OxError(0);
+}
+
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <ox/std/memory.hpp>
+#include <ox/std/vector.hpp>
+
+#include <nostalgia/core/gfx.hpp>
+
+namespace nostalgia::core {
+
+/**
+ * Reads and decodes tile sheets on a pool of worker threads. Decoded sheets
+ * are handed to the renderer by uploadReady, which is to be called from the
+ * GL thread at a frame boundary.
+ */
+class TileSheetLoader {
+
+	private:
+		struct Job {
+			TileSheetLoadId id = 0;
+			TileSheetLoadStatus status = TileSheetLoadStatus::Pending;
+			int section = 0;
+			ox::FileAddress tilesheetAddr;
+			ox::FileAddress paletteAddr;
+			bool commit = true;
+			// decode output, freed once uploaded
+			ox::Vector<uint8_t> pixels;
+			ox::Vector<Color16> colors;
+		};
+
+		struct Failure {
+			TileSheetLoadId id = 0;
+			ox::Error error;
+		};
+
+		Context *m_ctx = nullptr;
+		// guards m_ctx->rom, which is not safe for concurrent use
+		std::mutex *m_romMtx = nullptr;
+		std::mutex m_mtx;
+		std::condition_variable m_cond;
+		// loads not yet uploaded or failed, on the heap so workers can hold on
+		// to them while the list changes
+		ox::Vector<ox::UniquePtr<Job>> m_jobs;
+		// loads waiting for a worker, from m_queueHead on
+		ox::Vector<Job*> m_queue;
+		std::size_t m_queueHead = 0;
+		// decoded, committed loads waiting for uploadReady
+		ox::Vector<Job*> m_ready;
+		// swapped with m_ready by uploadReady, kept to reuse its storage
+		ox::Vector<Job*> m_uploading;
+		// failed loads whose errors have not been reported yet, uploaded loads
+		// are not kept at all
+		ox::Vector<Failure> m_failed;
+		TileSheetLoadId m_nextId = 1;
+		bool m_running = true;
+		std::vector<std::thread> m_workers;
+
+	public:
+		/**
+		 * @param romMtx mutex held by all users of the Context's rom
+		 */
+		TileSheetLoader(Context *ctx, std::mutex *romMtx) noexcept;
+
+		~TileSheetLoader() noexcept;
+
+		TileSheetLoader(const TileSheetLoader&) = delete;
+
+		TileSheetLoader &operator=(const TileSheetLoader&) = delete;
+
+		/**
+		 * Queues a background tile sheet for loading. Paths held as const
+		 * char* by the FileAddresses must outlive the load.
+		 */
+		[[nodiscard]]
+		TileSheetLoadId loadBg(int section, const ox::FileAddress &tilesheetAddr,
+		                       const ox::FileAddress &paletteAddr, bool commit) noexcept;
+
+		[[nodiscard]]
+		TileSheetLoadStatus status(TileSheetLoadId id) noexcept;
+
+		/**
+		 * @return the error of a failed load, or 0 for any other load. A failed
+		 *         load is forgotten once its error has been returned, and is
+		 *         reported as Done from then on.
+		 */
+		[[nodiscard]]
+		ox::Error error(TileSheetLoadId id) noexcept;
+
+		/**
+		 * Marks a deferred load to be uploaded once decoded.
+		 */
+		ox::Error commit(TileSheetLoadId id) noexcept;
+
+		/**
+		 * Uploads all decoded, committed tile sheets. GL thread only.
+		 */
+		void uploadReady() noexcept;
+
+	private:
+		void work() noexcept;
+
+		/**
+		 * Call with m_mtx held.
+		 * @return the load with the given ID, or null if it is not in progress
+		 */
+		[[nodiscard]]
+		Job *findJob(TileSheetLoadId id) noexcept;
+
+		/**
+		 * Call with m_mtx held.
+		 * @return index of the load's entry in m_failed, or m_failed.size()
+		 */
+		[[nodiscard]]
+		std::size_t findFailure(TileSheetLoadId id) const noexcept;
+
+		/**
+		 * Drops the job, keeping its error if it has one. Call with m_mtx held.
+		 */
+		void finish(Job *job, ox::Error err) noexcept;
+
+		ox::Error decode(Job *job) noexcept;
+
+};
+
+}
@@ -7,6 +7,7 @@
  */
 
 #include <ox/std/bstring.hpp>
+#include <ox/std/strops.hpp>
 #include <ox/std/trace.hpp>
 
 #include "glutils.hpp"
@@ -58,4 +59,86 @@ ox::Result<GLProgram> buildShaderProgram(const GLchar *vert, const GLchar *frag)
 	return ox::move(prgm);
 }
 
+Program::Program(GLProgram &&prgm) noexcept: m_prgm(ox::move(prgm)) {
+}
+
+GLint Program::uniform(const char *name) noexcept {
+	for (const auto &u : m_uniforms) {
+		if (ox_strcmp(u.name.c_str(), name) == 0) {
+			return u.loc;
+		}
+	}
+	const auto loc = glGetUniformLocation(m_prgm, name);
+	m_uniforms.push_back({name, loc});
+	return loc;
+}
+
+GLint Program::attrib(const char *name) noexcept {
+	for (const auto &a : m_attribs) {
+		if (ox_strcmp(a.name.c_str(), name) == 0) {
+			return a.loc;
+		}
+	}
+	const auto loc = glGetAttribLocation(m_prgm, name);
+	m_attribs.push_back({name, loc});
+	return loc;
+}
+
+ox::Result<Program> buildProgram(const GLchar *vert, const GLchar *frag) noexcept {
+	oxRequireM(prgm, buildShaderProgram(vert, frag));
+	return Program(ox::move(prgm));
+}
+
+void GLState::useProgram(GLuint program) noexcept {
+	if (m_program != program) {
+		glUseProgram(program);
+		m_program = program;
+		++m_calls;
+	}
+}
+
+void GLState::bindVertexArray(GLuint vao) noexcept {
+	if (m_vertexArray != vao) {
+		glBindVertexArray(vao);
+		m_vertexArray = vao;
+		++m_calls;
+	}
+}
+
+void GLState::bindArrayBuffer(GLuint buff) noexcept {
+	if (m_arrayBuffer != buff) {
+		glBindBuffer(GL_ARRAY_BUFFER, buff);
+		m_arrayBuffer = buff;
+		++m_calls;
+	}
+}
+
+void GLState::activeTexture(unsigned unit) noexcept {
+	if (m_activeTexture != unit) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		m_activeTexture = unit;
+		++m_calls;
+	}
+}
+
+void GLState::bindTexture(unsigned unit, GLuint tex) noexcept {
+	if (m_textures[unit] != tex) {
+		activeTexture(unit);
+		glBindTexture(GL_TEXTURE_2D, tex);
+		m_textures[unit] = tex;
+		++m_calls;
+	}
+}
+
+void GLState::invalidate() noexcept {
+	// ~0 is never a valid object name, so every next bind goes through
+	m_program = ~GLuint(0);
+	m_vertexArray = ~GLuint(0);
+	m_arrayBuffer = ~GLuint(0);
+	m_activeTexture = ~0u;
+	for (auto &t : m_textures) {
+		t = ~GLuint(0);
+	}
+}
+
 }
@@ -16,7 +16,9 @@
 #include <GLES3/gl3.h>
 #endif
 
+#include <ox/std/bstring.hpp>
 #include <ox/std/error.hpp>
+#include <ox/std/vector.hpp>
 
 namespace nostalgia::glutils {
 
@@ -112,4 +114,104 @@ using GLVertexArray = GLObject<deleteVertexArray>;
 [[nodiscard]]
 ox::Result<GLProgram> buildShaderProgram(const GLchar *vert, const GLchar *frag) noexcept;
 
+/**
+ * Shader program that caches its uniform and attribute locations, so each
+ * name is only looked up with GL once.
+ */
+class Program {
+
+	private:
+		struct Location {
+			ox::BString<32> name;
+			GLint loc = -1;
+		};
+		GLProgram m_prgm;
+		ox::Vector<Location, 8> m_uniforms;
+		ox::Vector<Location, 8> m_attribs;
+
+	public:
+		Program() noexcept = default;
+
+		explicit Program(GLProgram &&prgm) noexcept;
+
+		[[nodiscard]]
+		GLint uniform(const char *name) noexcept;
+
+		[[nodiscard]]
+		GLint attrib(const char *name) noexcept;
+
+		[[nodiscard]]
+		constexpr GLuint id() const noexcept {
+			return m_prgm.id;
+		}
+
+		constexpr operator GLuint() const noexcept {
+			return m_prgm.id;
+		}
+
+};
+
+[[nodiscard]]
+ox::Result<Program> buildProgram(const GLchar *vert, const GLchar *frag) noexcept;
+
+/**
+ * Tracks bound GL state so redundant binds can be skipped, and counts the GL
+ * calls issued through it. Callers making GL calls directly can add them to
+ * the count with countCalls.
+ * Any GL code that binds objects without going through GLState must call
+ * invalidate afterward.
+ */
+class GLState {
+
+	public:
+		static constexpr auto TextureUnits = 4;
+
+	private:
+		GLuint m_program = 0;
+		GLuint m_vertexArray = 0;
+		GLuint m_arrayBuffer = 0;
+		unsigned m_activeTexture = 0;
+		GLuint m_textures[TextureUnits] = {};
+		uint64_t m_calls = 0;
+
+	public:
+		void useProgram(GLuint program) noexcept;
+
+		void bindVertexArray(GLuint vao) noexcept;
+
+		void bindArrayBuffer(GLuint buff) noexcept;
+
+		/**
+		 * Binds tex to GL_TEXTURE_2D of the given texture unit.
+		 */
+		void bindTexture(unsigned unit, GLuint tex) noexcept;
+
+		/**
+		 * Makes the given texture unit active, without binding anything.
+		 */
+		void activeTexture(unsigned unit) noexcept;
+
+		/**
+		 * Forgets all tracked bindings, forcing the next bind of each kind.
+		 */
+		void invalidate() noexcept;
+
+		constexpr void countCalls(uint64_t calls = 1) noexcept {
+			m_calls += calls;
+		}
+
+		/**
+		 * @return number of GL calls counted since the last resetCalls
+		 */
+		[[nodiscard]]
+		constexpr uint64_t calls() const noexcept {
+			return m_calls;
+		}
+
+		constexpr void resetCalls() noexcept {
+			m_calls = 0;
+		}
+
+};
+
 }
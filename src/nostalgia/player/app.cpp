@@ -14,14 +14,14 @@ static unsigned spriteX = 72;
 static unsigned spriteY = 64;
 
 static int eventHandler(core::Context *ctx) noexcept {
-	if (core::buttonDown(core::GamePad_Right)) {
+	if (core::buttonDown(ctx, core::GamePad_Right)) {
 		spriteX += 2;
-	} else if (core::buttonDown(core::GamePad_Left)) {
+	} else if (core::buttonDown(ctx, core::GamePad_Left)) {
 		spriteX -= 2;
 	}
-	if (core::buttonDown(core::GamePad_Down)) {
+	if (core::buttonDown(ctx, core::GamePad_Down)) {
 		spriteY += 2;
-	} else if (core::buttonDown(core::GamePad_Up)) {
+	} else if (core::buttonDown(ctx, core::GamePad_Up)) {
 		spriteY -= 2;
 	}
 	constexpr auto s = "nostalgia";
@@ -42,6 +42,8 @@ ox::Error run(ox::FileSystem *fs) noexcept {
 	oxReturnError(core::initConsole(&ctx));
 	core::puts(&ctx, 10, 9, "DOPENESS!!!");
 	core::setEventHandler(&ctx, eventHandler);
+	// 60 Hz simulation
+	core::setFixedStep(&ctx, 16667);
 	oxReturnError(core::run(&ctx));
 	oxReturnError(core::shutdownGfx(&ctx));
 	return OxError(0);
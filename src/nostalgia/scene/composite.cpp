@@ -0,0 +1,99 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <ox/claw/claw.hpp>
+#include <ox/std/math.hpp>
+
+#include "composite.hpp"
+
+namespace nostalgia::scene {
+
+core::CompositeScene toCompositeScene(const SceneDoc &doc, const core::NostalgiaGraphic *sheet,
+                                      const core::NostalgiaPalette *palette) noexcept {
+	core::CompositeScene out;
+	out.sheet = sheet;
+	out.palette = palette;
+	for (const auto &srcLayer : doc.tiles) {
+		core::TileLayer layer;
+		layer.rows = static_cast<int>(srcLayer.size());
+		for (const auto &row : srcLayer) {
+			layer.columns = ox::max(layer.columns, static_cast<int>(row.size()));
+		}
+		layer.tiles.resize(static_cast<std::size_t>(layer.columns * layer.rows));
+		auto dst = layer.tiles.data();
+		for (const auto &row : srcLayer) {
+			for (auto c = 0; c < layer.columns; ++c) {
+				const auto col = static_cast<std::size_t>(c);
+				*dst++ = col < row.size() ? row[col].sheetIdx : core::TileLayer::EmptyTile;
+			}
+		}
+		out.layers.push_back(ox::move(layer));
+	}
+	return out;
+}
+
+static ox::Error findScenes(ox::FileSystem *fs, const ox::String &dir,
+                            std::vector<ox::String> *paths, std::vector<SceneDoc> *docs) noexcept {
+	oxRequire(names, fs->ls(dir));
+	for (const auto &name : names) {
+		if (name.len() == 0 || name[0] == '.') {
+			continue;
+		}
+		auto path = dir;
+		if (path.len() == 0 || path[path.len() - 1] != '/') {
+			path += "/";
+		}
+		path += name;
+		oxRequire(stat, fs->stat(path.c_str()));
+		if (stat.fileType == ox::FileType::Directory) {
+			oxReturnError(findScenes(fs, path, paths, docs));
+			continue;
+		}
+		oxRequire(buff, fs->read(path.c_str()));
+		const auto hdr = ox::detail::readHeader(buff.data(), buff.size());
+		if (hdr.error || hdr.value.typeName != SceneDoc::TypeName) {
+			continue;
+		}
+		oxRequireM(doc, ox::readClaw<SceneDoc>(buff));
+		paths->push_back(ox::move(path));
+		docs->push_back(ox::move(doc));
+	}
+	return OxError(0);
+}
+
+ox::Error compositeScenes(ox::FileSystem *fs, const ox::String &dir,
+                          const ox::FileAddress &tilesheet,
+                          const ox::FileAddress &palette,
+                          core::Compositor *compositor,
+                          std::vector<SceneImage> *out, int scale) noexcept {
+	oxRequire(sheetBuff, fs->read(tilesheet));
+	oxRequire(sheet, ox::readClaw<core::NostalgiaGraphic>(sheetBuff));
+	core::NostalgiaPalette pal;
+	const auto palAddr = palette ? palette : sheet.defaultPalette;
+	if (palAddr) {
+		oxRequire(palBuff, fs->read(palAddr));
+		oxReturnError(ox::readClaw<core::NostalgiaPalette>(palBuff).moveTo(&pal));
+	} else {
+		pal = sheet.pal;
+	}
+	std::vector<ox::String> paths;
+	std::vector<SceneDoc> docs;
+	oxReturnError(findScenes(fs, dir, &paths, &docs));
+	std::vector<core::CompositeScene> scenes;
+	for (const auto &doc : docs) {
+		scenes.push_back(toCompositeScene(doc, &sheet, &pal));
+	}
+	auto images = compositor->compositeBatch(scenes, scale);
+	for (std::size_t i = 0; i < images.size(); ++i) {
+		oxReturnError(images[i].error);
+		out->push_back({ox::move(paths[i]), ox::move(images[i].value)});
+	}
+	return OxError(0);
+}
+
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <ox/fs/fs.hpp>
+#include <ox/std/string.hpp>
+
+#include <nostalgia/core/userland/compositor.hpp>
+
+#include "scene.hpp"
+
+namespace nostalgia::scene {
+
+struct SceneImage {
+	ox::String path;
+	core::Image image;
+};
+
+/**
+ * Converts the scene's tile map to Compositor layers, padding short rows
+ * with transparent tiles.
+ */
+[[nodiscard]]
+core::CompositeScene toCompositeScene(const SceneDoc &doc, const core::NostalgiaGraphic *sheet,
+                                      const core::NostalgiaPalette *palette = nullptr) noexcept;
+
+/**
+ * Renders every scene found under dir in one Compositor batch, for project
+ * thumbnails and golden image suites. Scenes are drawn with the given tile
+ * sheet, and the sheet's default palette unless one is given. Files that are
+ * not scenes are skipped, scenes that fail to load or render fail the batch.
+ * @param out receives the images, in the order the scenes were found
+ * @param scale integer downscale factor of the output images
+ */
+ox::Error compositeScenes(ox::FileSystem *fs, const ox::String &dir,
+                          const ox::FileAddress &tilesheet,
+                          const ox::FileAddress &palette,
+                          core::Compositor *compositor,
+                          std::vector<SceneImage> *out, int scale = 1) noexcept;
+
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2016 - 2021 gary@drinkingtea.net
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+// make sure asserts are enabled for the test file
+#undef NDEBUG
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <string_view>
+#include <vector>
+
+#include <ox/claw/claw.hpp>
+#include <ox/fs/fs.hpp>
+#include <ox/std/std.hpp>
+
+#include <nostalgia/scene/composite.hpp>
+
+using namespace nostalgia;
+using namespace nostalgia::scene;
+
+constexpr auto SheetPath = "/TileSheets/Sheet.ng";
+
+/**
+ * Two 8 bpp tiles, the first solid, the second striped with a transparent
+ * column.
+ */
+static core::NostalgiaGraphic testSheet() noexcept {
+	core::NostalgiaGraphic sheet;
+	sheet.bpp = 8;
+	sheet.pal.colors.push_back(0);
+	sheet.pal.colors.push_back(core::color16(31, 0, 0));
+	sheet.pal.colors.push_back(core::color16(0, 31, 0));
+	sheet.pixels.resize(2 * 64);
+	for (std::size_t i = 0; i < 64; ++i) {
+		sheet.pixels[i] = 1;
+		sheet.pixels[64 + i] = i % 8 == 0 ? 0 : static_cast<uint8_t>(1 + (i / 8) % 2);
+	}
+	return sheet;
+}
+
+static SceneDoc testScene(std::initializer_list<std::initializer_list<uint16_t>> rows) noexcept {
+	SceneDoc doc;
+	SceneDoc::TileMapLayer layer;
+	for (const auto &srcRow : rows) {
+		SceneDoc::TileMapRow row;
+		for (const auto tile : srcRow) {
+			row.push_back({tile, 0});
+		}
+		layer.push_back(ox::move(row));
+	}
+	doc.tiles.push_back(ox::move(layer));
+	return doc;
+}
+
+template<typename T>
+static ox::Error writeObj(ox::FileSystem *fs, const char *path, T *obj) noexcept {
+	oxRequire(buff, ox::writeClaw(obj, ox::ClawFormat::Metal));
+	return fs->write(path, buff.data(), buff.size(), ox::FileType::NormalFile);
+}
+
+const std::map<std::string_view, std::function<ox::Error(std::string_view)>> tests = {
+	{
+		{
+			"compositeScenes",
+			[](std::string_view) {
+				ox::Vector<char> image(64 * 1024);
+				oxReturnError(ox::FileSystem32::format(image.data(), image.size()));
+				ox::FileSystem32 fs(ox::FileStore32(image.data(), image.size()));
+				auto sheet = testSheet();
+				sheet.defaultPalette = "/Scenes/Pal.npal";
+				auto a = testScene({{0, 1}});
+				// a short row, padded with transparent tiles
+				auto b = testScene({{1}, {0, 1}});
+				const char notes[] = "not a scene";
+				oxReturnError(fs.mkdir("/TileSheets", true));
+				oxReturnError(fs.mkdir("/Scenes/Sub", true));
+				oxReturnError(writeObj(&fs, SheetPath, &sheet));
+				oxReturnError(writeObj(&fs, "/Scenes/A.nscn", &a));
+				oxReturnError(writeObj(&fs, "/Scenes/Sub/B.nscn", &b));
+				// the sheet's palette, which is also a claw file of another type,
+				// and a file that is not claw at all
+				oxReturnError(writeObj(&fs, "/Scenes/Pal.npal", &sheet.pal));
+				oxReturnError(fs.write("/Scenes/Notes.txt", notes, sizeof(notes), ox::FileType::NormalFile));
+				core::ThreadPool pool(2);
+				core::Compositor compositor(&pool);
+				std::vector<SceneImage> out;
+				oxReturnError(compositeScenes(&fs, "/Scenes", SheetPath, nullptr, &compositor, &out));
+				oxAssert(out.size() == 2, "compositeScenes returned the wrong number of scenes");
+				std::sort(out.begin(), out.end(), [](const SceneImage &l, const SceneImage &r) {
+					return ox_strcmp(l.path.c_str(), r.path.c_str()) < 0;
+				});
+				oxAssert(out[0].path == "/Scenes/A.nscn", "Wrong path for scene A");
+				oxAssert(out[1].path == "/Scenes/Sub/B.nscn", "Wrong path for scene B");
+				oxAssert(out[0].image.width == 16 && out[0].image.height == 8, "Scene A has the wrong size");
+				oxAssert(out[1].image.width == 16 && out[1].image.height == 16, "Scene B has the wrong size");
+				// each image matches its scene composited on its own
+				const SceneDoc *docs[] = {&a, &b};
+				for (std::size_t i = 0; i < out.size(); ++i) {
+					oxRequire(expected, compositor.composite(toCompositeScene(*docs[i], &sheet)));
+					oxAssert(core::imageHash(out[i].image) == core::imageHash(expected), "Scene image hash mismatch");
+				}
+				oxAssert(core::imageHash(out[0].image) != core::imageHash(out[1].image), "Different scenes hash equal");
+				// the padding past B's short first row is transparent
+				oxAssert(out[1].image.pixels[8] == 0, "Short row was not padded with transparent tiles");
+				return OxError(0);
+			}
+		},
+	},
+};
+
+int main(int argc, const char **args) {
+	int retval = -1;
+	if (argc > 1) {
+		std::string_view testName = args[1];
+		std::string_view testArg;
+		if (args[2]) {
+			testArg = args[2];
+		}
+		if (tests.find(testName) != tests.end()) {
+			retval = static_cast<int>(tests.at(testName)(testArg));
+		}
+	}
+	return retval;
+}
@@ -25,15 +25,27 @@ Zone::~Zone() {
 }
 
 void Zone::draw(Context *ctx) {
-	for (int x = 0; x < m_bounds.width; x++) {
-		for (int y = 0; y < m_bounds.height; y++) {
-			auto t = tile(x, y);
-			core::setTile(ctx, 0, x * 2, y * 2, t->bgTile);
-			core::setTile(ctx, 0, x * 2 + 1, y * 2, t->bgTile + 1);
-			core::setTile(ctx, 0, x * 2 + 1, y * 2 + 1, t->bgTile + 2);
-			core::setTile(ctx, 0, x * 2, y * 2 + 1, t->bgTile + 3);
+	// each zone tile is 2x2 map tiles, build the whole map and write it at once
+	core::ArenaScope scope(ctx->frameArena());
+	const auto columns = m_bounds.width * 2;
+	const auto rows = m_bounds.height * 2;
+	const auto map = ctx->frameArena()->alloc<uint8_t>(static_cast<std::size_t>(columns * rows));
+	if (!map) {
+		oxTrace("nostalgia::world::Zone::draw", "Out of memory for the tile map");
+		return;
+	}
+	for (int y = 0; y < m_bounds.height; y++) {
+		const auto top = map + y * 2 * columns;
+		const auto bottom = top + columns;
+		for (int x = 0; x < m_bounds.width; x++) {
+			const auto bgTile = tile(x, y)->bgTile;
+			top[x * 2] = bgTile;
+			top[x * 2 + 1] = static_cast<uint8_t>(bgTile + 1);
+			bottom[x * 2 + 1] = static_cast<uint8_t>(bgTile + 2);
+			bottom[x * 2] = static_cast<uint8_t>(bgTile + 3);
 		}
 	}
+	core::blitTileRect(ctx, 0, 0, 0, columns, rows, map, columns);
 }
 
 std::size_t Zone::size() {